@@ -9,6 +9,50 @@
 #include <random>
 #include <algorithm>
 #include <map>
+#include <tuple>
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstddef>
+#include <array>
+#include <utility>
+#include <limits>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <iterator>
+#include <bitset>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/inotify.h>
+#endif
 
 // Game states
 enum class GameState {
@@ -43,1442 +87,9039 @@ enum class PowerUpType {
     ScoreBoost
 };
 
-// Particle effect for explosions, etc.
-class Particle {
-public:
-    Particle(const sf::Vector2f& position, const sf::Color& color, float speed, float angle, float lifetime) 
-        : position(position), velocity(std::cos(angle) * speed, std::sin(angle) * speed), 
-          color(color), lifetime(lifetime), maxLifetime(lifetime) {
-        shape.setRadius(3.0f);
-        shape.setFillColor(color);
-        shape.setPosition(position);
-        shape.setOrigin(3.0f, 3.0f);
-    }
+// Texture IDs - every sprite texture the entities use
+enum class TextureId {
+    Player,
+    BasicEnemy,
+    FastEnemy,
+    TankyEnemy,
+    Boss,
+    Bullet,
+    RoundBullet,
+    LongBullet,
+    Laser,
+    Shield,
+    PowerUp,
+    Count
+};
 
-    bool update(float deltaTime) {
-        lifetime -= deltaTime;
-        if (lifetime <= 0) return false;
+const char* getTexturePath(TextureId id) {
+    static const char* const paths[] = {
+        "assets/images/player.png",
+        "assets/images/enemies/enemy1.png",
+        "assets/images/enemies/enemy2.png",
+        "assets/images/enemies/enemy3.png",
+        "assets/images/enemies/boss.png",
+        "assets/images/bullet.png",
+        "assets/images/weapons/bullet1.png",
+        "assets/images/weapons/bullet2.png",
+        "assets/images/weapons/laser.png",
+        "assets/images/effects/shield.png",
+        "assets/images/powerup.png"
+    };
+    static_assert(sizeof(paths) / sizeof(paths[0]) == static_cast<std::size_t>(TextureId::Count), "missing texture path");
+    return paths[static_cast<int>(id)];
+}
 
-        position += velocity * deltaTime;
-        shape.setPosition(position);
-        
-        // Fade out as lifetime decreases
-        float alpha = (lifetime / maxLifetime) * 255;
-        sf::Color newColor = color;
-        newColor.a = static_cast<sf::Uint8>(alpha);
-        shape.setFillColor(newColor);
-        
-        return true;
+// How many source pixels go into one uploaded texel. Sprites that are only ever drawn at half size
+// are halved at load time; the entity scale makes up for it so world sizes do not change.
+int getTextureDownscale(TextureId id) {
+    switch (id) {
+        case TextureId::Player:
+        case TextureId::BasicEnemy:
+        case TextureId::FastEnemy:
+        case TextureId::TankyEnemy:
+        case TextureId::Bullet:
+        case TextureId::RoundBullet:
+        case TextureId::LongBullet:
+        case TextureId::PowerUp:
+            return 2;
+        default:
+            return 1;
     }
+}
 
-    void draw(sf::RenderWindow& window) const {
-        window.draw(shape);
-    }
+// Textures drawn at a size that changes at runtime (the beam is stretched to its length) get mipmaps
+bool textureNeedsMipmaps(TextureId id) {
+    return id == TextureId::Laser;
+}
 
-private:
-    sf::Vector2f position;
-    sf::Vector2f velocity;
-    sf::Color color;
-    float lifetime;
-    float maxLifetime;
-    sf::CircleShape shape;
-};
+// Halves an RGBA image with a 2x2 box filter. Colour is averaged premultiplied by alpha so the
+// transparent texels around a sprite do not bleed a dark fringe into its edges. An odd last row
+// or column is averaged with itself.
+sf::Image downscaleHalf(const sf::Uint8* pixels, sf::Vector2u size) {
+    unsigned width = (size.x + 1) / 2;
+    unsigned height = (size.y + 1) / 2;
+    sf::Image result;
+    if (size.x == 0 || size.y == 0) return result;
 
-// Animation class for sprite animations
-class Animation {
-public:
-    Animation(sf::Texture& texture, int frameCount, float frameTime) 
-        : texture(texture), frameCount(frameCount), frameTime(frameTime), currentFrame(0), elapsedTime(0) {
-        frameSize = sf::Vector2i(texture.getSize().x / frameCount, texture.getSize().y);
-        sprite.setTexture(texture);
-        sprite.setTextureRect(sf::IntRect(0, 0, frameSize.x, frameSize.y));
-        sprite.setOrigin(frameSize.x / 2.0f, frameSize.y / 2.0f);
+    // Premultiply, padding odd sizes by repeating the last row and column
+    unsigned paddedWidth = width * 2;
+    std::vector<sf::Uint8> premultiplied(static_cast<std::size_t>(paddedWidth) * height * 2 * 4);
+    for (unsigned y = 0; y < height * 2; ++y) {
+        const sf::Uint8* row = pixels + static_cast<std::size_t>(std::min(y, size.y - 1)) * size.x * 4;
+        sf::Uint8* out = premultiplied.data() + static_cast<std::size_t>(y) * paddedWidth * 4;
+        for (unsigned x = 0; x < paddedWidth; ++x) {
+            const sf::Uint8* pixel = row + std::min(x, size.x - 1) * 4;
+            unsigned alpha = pixel[3];
+            out[x * 4 + 0] = static_cast<sf::Uint8>((pixel[0] * alpha + 127) / 255);
+            out[x * 4 + 1] = static_cast<sf::Uint8>((pixel[1] * alpha + 127) / 255);
+            out[x * 4 + 2] = static_cast<sf::Uint8>((pixel[2] * alpha + 127) / 255);
+            out[x * 4 + 3] = static_cast<sf::Uint8>(alpha);
+        }
     }
 
-    void update(float deltaTime) {
-        elapsedTime += deltaTime;
-        if (elapsedTime >= frameTime) {
-            elapsedTime = 0;
-            currentFrame = (currentFrame + 1) % frameCount;
-            sprite.setTextureRect(sf::IntRect(currentFrame * frameSize.x, 0, frameSize.x, frameSize.y));
+    // Average rows, then neighbouring pixels: rounded byte averages, four output pixels per step
+    std::vector<sf::Uint8> averaged(static_cast<std::size_t>(width) * height * 4);
+    for (unsigned y = 0; y < height; ++y) {
+        const sf::Uint8* row0 = premultiplied.data() + static_cast<std::size_t>(y * 2) * paddedWidth * 4;
+        const sf::Uint8* row1 = row0 + paddedWidth * 4;
+        sf::Uint8* out = averaged.data() + static_cast<std::size_t>(y) * width * 4;
+        unsigned x = 0;
+#if defined(__SSE2__)
+        for (; x + 4 <= width; x += 4) {
+            __m128i top0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+            __m128i top1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16));
+            __m128i bottom0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+            __m128i bottom1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16));
+            __m128 vertical0 = _mm_castsi128_ps(_mm_avg_epu8(top0, bottom0));
+            __m128 vertical1 = _mm_castsi128_ps(_mm_avg_epu8(top1, bottom1));
+            __m128i even = _mm_castps_si128(_mm_shuffle_ps(vertical0, vertical1, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i odd = _mm_castps_si128(_mm_shuffle_ps(vertical0, vertical1, _MM_SHUFFLE(3, 1, 3, 1)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_avg_epu8(even, odd));
+        }
+#elif defined(__ARM_NEON)
+        for (; x + 4 <= width; x += 4) {
+            uint8x16_t vertical0 = vrhaddq_u8(vld1q_u8(row0 + x * 8), vld1q_u8(row1 + x * 8));
+            uint8x16_t vertical1 = vrhaddq_u8(vld1q_u8(row0 + x * 8 + 16), vld1q_u8(row1 + x * 8 + 16));
+            uint32x4x2_t split = vuzpq_u32(vreinterpretq_u32_u8(vertical0), vreinterpretq_u32_u8(vertical1));
+            vst1q_u8(out + x * 4, vrhaddq_u8(vreinterpretq_u8_u32(split.val[0]), vreinterpretq_u8_u32(split.val[1])));
+        }
+#endif
+        for (; x < width; ++x) {
+            for (int c = 0; c < 4; ++c) {
+                unsigned left = (row0[x * 8 + c] + row1[x * 8 + c] + 1) / 2;
+                unsigned right = (row0[x * 8 + 4 + c] + row1[x * 8 + 4 + c] + 1) / 2;
+                out[x * 4 + c] = static_cast<sf::Uint8>((left + right + 1) / 2);
+            }
         }
     }
 
-    void setPosition(const sf::Vector2f& position) {
-        sprite.setPosition(position);
+    // Back to straight alpha
+    for (std::size_t i = 0; i < averaged.size(); i += 4) {
+        unsigned alpha = averaged[i + 3];
+        for (int c = 0; c < 3; ++c) {
+            averaged[i + c] = alpha == 0 ? 0 : static_cast<sf::Uint8>(std::min(255u, (averaged[i + c] * 255u + alpha / 2) / alpha));
+        }
     }
 
-    void setScale(float scaleX, float scaleY) {
-        sprite.setScale(scaleX, scaleY);
-    }
+    result.create(width, height, averaged.data());
+    return result;
+}
 
-    void setRotation(float angle) {
-        sprite.setRotation(angle);
-    }
+// Resamples an opaque image down to an arbitrary size by averaging the source area under each
+// output pixel. Used once for the background, so it stays scalar.
+sf::Image downscaleArea(const sf::Uint8* pixels, sf::Vector2u size, unsigned width, unsigned height) {
+    sf::Image result;
+    if (width == 0 || height == 0 || width > size.x || height > size.y) return result;
 
-    void draw(sf::RenderWindow& window) const {
-        window.draw(sprite);
-    }
+    float scaleX = static_cast<float>(size.x) / width;
+    float scaleY = static_cast<float>(size.y) / height;
 
-    bool isFinished() const {
-        return currentFrame == frameCount - 1 && elapsedTime >= frameTime;
+    // Horizontal pass into floats, then vertical
+    std::vector<float> horizontal(static_cast<std::size_t>(width) * size.y * 4, 0.0f);
+    for (unsigned y = 0; y < size.y; ++y) {
+        for (unsigned x = 0; x < width; ++x) {
+            float start = x * scaleX, end = start + scaleX;
+            for (unsigned sx = static_cast<unsigned>(start); sx < size.x && sx < end; ++sx) {
+                float weight = std::min(end, sx + 1.0f) - std::max(start, static_cast<float>(sx));
+                for (int c = 0; c < 4; ++c) {
+                    horizontal[(static_cast<std::size_t>(y) * width + x) * 4 + c] += pixels[(static_cast<std::size_t>(y) * size.x + sx) * 4 + c] * weight;
+                }
+            }
+        }
     }
 
-    void reset() {
-        currentFrame = 0;
-        elapsedTime = 0;
-        sprite.setTextureRect(sf::IntRect(0, 0, frameSize.x, frameSize.y));
+    std::vector<sf::Uint8> out(static_cast<std::size_t>(width) * height * 4);
+    for (unsigned y = 0; y < height; ++y) {
+        float start = y * scaleY, end = start + scaleY;
+        for (unsigned x = 0; x < width; ++x) {
+            float sum[4] = {};
+            for (unsigned sy = static_cast<unsigned>(start); sy < size.y && sy < end; ++sy) {
+                float weight = std::min(end, sy + 1.0f) - std::max(start, static_cast<float>(sy));
+                for (int c = 0; c < 4; ++c) {
+                    sum[c] += horizontal[(static_cast<std::size_t>(sy) * width + x) * 4 + c] * weight;
+                }
+            }
+            for (int c = 0; c < 4; ++c) {
+                out[(static_cast<std::size_t>(y) * width + x) * 4 + c] = static_cast<sf::Uint8>(std::min(255.0f, sum[c] / (scaleX * scaleY) + 0.5f));
+            }
+        }
     }
 
-private:
-    sf::Texture& texture;
-    sf::Sprite sprite;
-    int frameCount;
-    float frameTime;
-    int currentFrame;
-    float elapsedTime;
-    sf::Vector2i frameSize;
-};
+    result.create(width, height, out.data());
+    return result;
+}
 
-// Explosion effect
-class Explosion {
+// Texture cache - each texture is loaded once and shared by every entity that uses it
+class TextureCache {
 public:
-    Explosion(const sf::Vector2f& position, float scale = 1.0f) : position(position), isActive(true) {
-        // Create particles
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<float> angleDist(0, 2 * 3.14159f);
-        std::uniform_real_distribution<float> speedDist(50.0f, 200.0f);
-        std::uniform_real_distribution<float> lifetimeDist(0.5f, 1.5f);
-        
-        for (int i = 0; i < 30; ++i) {
-            float angle = angleDist(gen);
-            float speed = speedDist(gen);
-            float lifetime = lifetimeDist(gen);
-            
-            sf::Color color;
-            if (i % 3 == 0) color = sf::Color(255, 60, 0);  // Orange
-            else if (i % 3 == 1) color = sf::Color(255, 200, 0);  // Yellow
-            else color = sf::Color(255, 0, 0);  // Red
-            
-            particles.emplace_back(position, color, speed, angle, lifetime);
-        }
-    }
-
-    bool update(float deltaTime) {
-        for (auto it = particles.begin(); it != particles.end();) {
-            if (!it->update(deltaTime)) {
-                it = particles.erase(it);
+    static const sf::Texture& get(TextureId id) {
+        Slot& slot = getSlot(id);
+        if (!slot.loaded && !deferred()) {
+            slot.loaded = true;
+            sf::Image image;
+            if (image.loadFromFile(getTexturePath(id))) {
+                sf::Image prepared = prepare(id, image.getPixelsPtr(), image.getSize());
+                upload(id, prepared.getSize().x, prepared.getSize().y, prepared.getPixelsPtr(), image.getSize());
             } else {
-                ++it;
+                // Handle error
             }
         }
-        
-        return !particles.empty();
+        return *slot.texture;
     }
 
-    void draw(sf::RenderWindow& window) const {
-        for (const auto& particle : particles) {
-            particle.draw(window);
+    // Resamples source pixels to the size the texture is uploaded at; empty when no resampling is needed
+    static sf::Image prepare(TextureId id, const sf::Uint8* pixels, sf::Vector2u sourceSize) {
+        if (getTextureDownscale(id) == 2) {
+            return downscaleHalf(pixels, sourceSize);
         }
+        sf::Image image;
+        image.create(sourceSize.x, sourceSize.y, pixels);
+        return image;
     }
 
-private:
-    sf::Vector2f position;
-    std::vector<Particle> particles;
-    bool isActive;
-};
-
-// Entity class for game objects
-class Entity {
-public:
-    Entity(const std::string& texturePath) {
-        if (!texture.loadFromFile(texturePath)) {
-            // Handle error
+    // Uploads prepared RGBA pixels; the texture object stays the same, so sprites keep pointing at it
+    static bool upload(TextureId id, unsigned width, unsigned height, const sf::Uint8* pixels, sf::Vector2u sourceSize) {
+        Slot& slot = getSlot(id);
+        slot.loaded = true;
+        if (!slot.texture->create(width, height)) return false;
+        slot.texture->update(pixels);
+        if (textureNeedsMipmaps(id)) {
+            slot.texture->setSmooth(true);
+            slot.mipmapped = slot.texture->generateMipmap();
         }
-        sprite.setTexture(texture);
-        // Center the origin
-        sprite.setOrigin(texture.getSize().x / 2.0f, texture.getSize().y / 2.0f);
+        slot.sourceSize = sourceSize;
+        return true;
     }
 
-    virtual void update(float deltaTime) {}
-
-    void setPosition(float x, float y) {
-        sprite.setPosition(x, y);
+    // Uploaded texels per source pixel; entities divide their scale by it
+    static float getResolutionScale(TextureId id) {
+        return 1.0f / getTextureDownscale(id);
     }
 
-    void setPosition(const sf::Vector2f& position) {
-        sprite.setPosition(position);
+    // Bytes of every loaded texture as uploaded (with mipmaps) and as they would be at source size
+    static void getMemoryUsage(std::size_t& uploaded, std::size_t& source) {
+        for (int i = 0; i < static_cast<int>(TextureId::Count); ++i) {
+            const Slot& slot = getSlot(static_cast<TextureId>(i));
+            uploaded += getTextureBytes(slot.texture->getSize(), slot.mipmapped);
+            source += getTextureBytes(slot.sourceSize, false);
+        }
     }
 
-    void move(float x, float y) {
-        sprite.move(x, y);
+    static std::size_t getTextureBytes(sf::Vector2u size, bool mipmapped) {
+        std::size_t bytes = static_cast<std::size_t>(size.x) * size.y * 4;
+        // A full mip chain adds a third
+        return mipmapped ? bytes + bytes / 3 : bytes;
     }
 
-    sf::FloatRect getBounds() const {
-        return sprite.getGlobalBounds();
-    }
+    // While set, get() hands out textures without loading them from disk
+    static void setDeferred(bool value) { deferred() = value; }
 
-    sf::Vector2f getPosition() const {
-        return sprite.getPosition();
-    }
+private:
+    struct Slot {
+        std::unique_ptr<sf::Texture> texture;
+        bool loaded = false;
+        bool mipmapped = false;
+        sf::Vector2u sourceSize;
+    };
 
-    void setScale(float scaleX, float scaleY) {
-        sprite.setScale(scaleX, scaleY);
-    }
+    static Slot& getSlot(TextureId id) {
+        static Slot slots[static_cast<int>(TextureId::Count)];
 
-    void setRotation(float angle) {
-        sprite.setRotation(angle);
+        Slot& slot = slots[static_cast<int>(id)];
+        if (!slot.texture) {
+            slot.texture = std::make_unique<sf::Texture>();
+        }
+        return slot;
     }
 
-    void draw(sf::RenderWindow& window) const {
-        window.draw(sprite);
+    static bool& deferred() {
+        static bool value = false;
+        return value;
     }
-
-protected:
-    sf::Texture texture;
-    sf::Sprite sprite;
 };
 
-// Bullet class
-class Bullet : public Entity {
-public:
-    Bullet(const std::string& texturePath, float damage = 10.0f) 
-        : Entity(texturePath), damage(damage) {
-        setScale(0.5f, 0.5f);
-    }
-
-    void update(float deltaTime) override {
-        move(0.f, -speed * deltaTime);
-    }
-
-    bool isOffScreen() const {
-        return getPosition().y < 0;
-    }
+// Sound IDs - every effect the game plays
+enum class SoundId {
+    Shoot,
+    Explosion,
+    PowerUp,
+    Upgrade,
+    Boss,
+    Count
+};
 
-    float getDamage() const { return damage; }
+// Per-effect mixing rules: a higher priority may steal a voice from a lower one, and no effect
+// holds more than maxVoices voices at once
+struct SoundDef {
+    const char* path;
+    int priority;
+    int maxVoices;
+    float volume;
+};
 
-private:
-    float speed = 600.0f;
-    float damage;
+constexpr SoundDef soundTable[] = {
+    { "assets/sounds/shoot.wav",     0, 4, 60.0f },
+    { "assets/sounds/explosion.wav", 1, 6, 80.0f },
+    { "assets/sounds/powerup.wav",   2, 2, 100.0f },
+    { "assets/sounds/upgrade.wav",   2, 2, 100.0f },
+    { "assets/sounds/boss.wav",      3, 1, 100.0f }
 };
+static_assert(sizeof(soundTable) / sizeof(soundTable[0]) == static_cast<std::size_t>(SoundId::Count), "missing sound definition");
 
-// Laser class - special weapon
-class Laser : public Entity {
+// Audio service - play() only counts the request; at the end of each tick one entry per requested
+// sound goes into a lock-free single-producer queue. A mixer thread drains it, plays each sound
+// once per tick (louder the more requests were merged) and assigns it to a fixed pool of voices.
+class AudioService {
 public:
-    Laser() : Entity("assets/images/weapons/laser.png"), lifetime(0.5f), damage(1.0f) {
-        setScale(0.5f, 10.0f);
-    }
+    static constexpr std::size_t voiceCount = 16;
+    static constexpr std::size_t queueCapacity = 256; // Power of two
 
-    void update(float deltaTime) override {
-        lifetime -= deltaTime;
-    }
+    AudioService() : tick(0), pending{}, head(0), tail(0), running(false), dropped(0), merged(0), stolen(0) {}
 
-    bool isActive() const {
-        return lifetime > 0;
+    ~AudioService() {
+        stop();
     }
 
-    float getDamage() const { return damage; }
-
-private:
-    float lifetime;
-    float damage;
-};
+    // Takes decoded samples for one effect; must be called before start()
+    bool setBuffer(SoundId id, const sf::Int16* samples, std::size_t sampleCount, unsigned channelCount, unsigned sampleRate) {
+        return buffers[static_cast<int>(id)].loadFromSamples(samples, sampleCount, channelCount, sampleRate);
+    }
 
-// Shield class
-class Shield : public Entity {
-public:
-    Shield() : Entity("assets/images/effects/shield.png"), health(100.0f), active(false) {
-        setScale(1.2f, 1.2f);
+    void start() {
+        if (!running.exchange(true)) {
+            mixer = std::thread(&AudioService::mixerLoop, this);
+        }
     }
 
-    void update(float deltaTime) override {
-        if (active) {
-            health -= 10.0f * deltaTime; // Shield depletes over time
-            if (health <= 0) {
-                active = false;
-            }
+    void stop() {
+        if (running.exchange(false)) {
+            wake.notify_one();
+            mixer.join();
+        }
+        for (auto& voice : voices) {
+            voice.sound.stop();
         }
     }
 
-    void activate() {
-        health = 100.0f;
-        active = true;
+    // Called from the simulation thread only
+    void play(SoundId id) {
+        ++pending[static_cast<int>(id)];
     }
 
-    bool isActive() const { return active; }
-    float getHealth() const { return health; }
+    // Publishes this tick's requests to the mixer
+    void endTick() {
+        bool published = false;
+        for (int i = 0; i < static_cast<int>(SoundId::Count); ++i) {
+            if (pending[i] == 0) continue;
+
+            std::uint32_t currentTail = tail.load(std::memory_order_relaxed);
+            if (currentTail - head.load(std::memory_order_acquire) == queueCapacity) {
+                dropped.fetch_add(pending[i], std::memory_order_relaxed);
+            } else {
+                queue[currentTail & (queueCapacity - 1)] = Request{ static_cast<SoundId>(i), tick, pending[i] };
+                tail.store(currentTail + 1, std::memory_order_release);
+                published = true;
+            }
+            pending[i] = 0;
+        }
 
-    void takeDamage(float amount) {
-        health -= amount;
-        if (health <= 0) {
-            active = false;
+        ++tick;
+        if (published) {
+            wake.notify_one();
         }
     }
 
-private:
-    float health;
-    bool active;
-};
+    std::uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    std::uint64_t getMergedCount() const { return merged.load(std::memory_order_relaxed); }
+    std::uint64_t getStolenCount() const { return stolen.load(std::memory_order_relaxed); }
 
-// Player class
-class Player : public Entity {
-public:
-    Player() : Entity("assets/images/player.png"), health(100), score(0), 
-               weaponType(WeaponType::Basic), shieldActive(false) {
-        setScale(0.5f, 0.5f);
-        shield = std::make_unique<Shield>();
+    // Replaces an effect while the mixer is running; the swap happens on the mixer thread
+    void reloadBuffer(SoundId id, std::vector<sf::Int16> samples, unsigned channelCount, unsigned sampleRate) {
+        std::lock_guard<std::mutex> lock(reloadMutex);
+        reloads.push_back(BufferReload{ id, std::move(samples), channelCount, sampleRate });
+        reloadPending = true;
     }
 
-    void update(float deltaTime) override {
-        // Player movement
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left) && getPosition().x > 0) {
-            move(-speed * deltaTime, 0.f);
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right) && getPosition().x < 800) {
-            move(speed * deltaTime, 0.f);
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up) && getPosition().y > 0) {
-            move(0.f, -speed * deltaTime);
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down) && getPosition().y < 600) {
-            move(0.f, speed * deltaTime);
+    // Drains and mixes whatever is queued; the mixer thread does this on its own when running
+    void mix() {
+        if (reloadPending.load()) {
+            applyReloads();
         }
 
-        // Update shield
-        if (shield->isActive()) {
-            shield->setPosition(getPosition());
-            shield->update(deltaTime);
+        std::uint32_t currentHead = head.load(std::memory_order_relaxed);
+        std::uint32_t currentTail = tail.load(std::memory_order_acquire);
+
+        while (currentHead != currentTail) {
+            // Count every request for each sound in this tick
+            std::uint32_t requestTick = queue[currentHead & (queueCapacity - 1)].tick;
+            int counts[static_cast<int>(SoundId::Count)] = {};
+            while (currentHead != currentTail && queue[currentHead & (queueCapacity - 1)].tick == requestTick) {
+                const Request& request = queue[currentHead & (queueCapacity - 1)];
+                counts[static_cast<int>(request.id)] += request.count;
+                ++currentHead;
+            }
+            head.store(currentHead, std::memory_order_release);
+
+            // Most important sounds claim voices first
+            for (int priority = 3; priority >= 0; --priority) {
+                for (int i = 0; i < static_cast<int>(SoundId::Count); ++i) {
+                    if (counts[i] > 0 && soundTable[i].priority == priority) {
+                        merged.fetch_add(counts[i] - 1, std::memory_order_relaxed);
+                        startVoice(static_cast<SoundId>(i), counts[i]);
+                    }
+                }
+            }
+
+            currentTail = tail.load(std::memory_order_acquire);
         }
     }
 
-    bool canShoot() {
-        float cooldown = 0.0f;
-        switch (weaponType) {
-            case WeaponType::Basic: cooldown = 0.25f; break;
-            case WeaponType::Double: cooldown = 0.2f; break;
-            case WeaponType::Triple: cooldown = 0.15f; break;
-            case WeaponType::Laser: cooldown = 1.0f; break;
+private:
+    struct Request {
+        SoundId id;
+        std::uint32_t tick;
+        int count;
+    };
+
+    struct Voice {
+        sf::Sound sound;
+        SoundId id = SoundId::Count;
+        std::uint64_t startedAt = 0;
+    };
+
+    struct BufferReload {
+        SoundId id;
+        std::vector<sf::Int16> samples;
+        unsigned channelCount;
+        unsigned sampleRate;
+    };
+
+    void applyReloads() {
+        std::lock_guard<std::mutex> lock(reloadMutex);
+        for (const BufferReload& reload : reloads) {
+            // Voices must let go of a buffer before its samples change
+            for (auto& voice : voices) {
+                if (voice.id == reload.id) {
+                    voice.sound.stop();
+                    voice.sound.resetBuffer();
+                    voice.id = SoundId::Count;
+                }
+            }
+            if (!buffers[static_cast<int>(reload.id)].loadFromSamples(reload.samples.data(), reload.samples.size(),
+                                                                     reload.channelCount, reload.sampleRate)) {
+                std::cerr << "Failed to reload sound " << soundTable[static_cast<int>(reload.id)].path << std::endl;
+            }
         }
+        reloads.clear();
+        reloadPending = false;
+    }
 
-        if (shootClock.getElapsedTime().asSeconds() > cooldown) {
-            shootClock.restart();
-            return true;
+    void mixerLoop() {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        while (running.load()) {
+            // Notifications are sent without the lock, so a short timeout covers a missed wake-up
+            wake.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+                return !running.load() || tail.load(std::memory_order_acquire) != head.load(std::memory_order_relaxed);
+            });
+            mix();
         }
-        return false;
     }
 
-    std::vector<std::shared_ptr<Bullet>> shoot() {
-        std::vector<std::shared_ptr<Bullet>> newBullets;
-        
-        switch (weaponType) {
-            case WeaponType::Basic: {
-                auto bullet = std::make_shared<Bullet>("assets/images/bullet.png");
-                bullet->setPosition(getPosition().x, getPosition().y - 30.f);
-                newBullets.push_back(bullet);
-                break;
+    // count identical requests from one tick play as a single voice, louder the more there were
+    void startVoice(SoundId id, int count) {
+        const SoundDef& def = soundTable[static_cast<int>(id)];
+        Voice* chosen = nullptr;
+        Voice* oldestSame = nullptr;
+        Voice* victim = nullptr;
+        int sameCount = 0;
+
+        for (auto& voice : voices) {
+            if (voice.sound.getStatus() != sf::Sound::Playing) {
+                if (!chosen) chosen = &voice;
+                continue;
             }
-            case WeaponType::Double: {
-                auto bullet1 = std::make_shared<Bullet>("assets/images/weapons/bullet1.png", 15.0f);
-                auto bullet2 = std::make_shared<Bullet>("assets/images/weapons/bullet1.png", 15.0f);
-                bullet1->setPosition(getPosition().x - 20.f, getPosition().y - 20.f);
-                bullet2->setPosition(getPosition().x + 20.f, getPosition().y - 20.f);
-                newBullets.push_back(bullet1);
-                newBullets.push_back(bullet2);
-                break;
+            if (voice.id == id) {
+                ++sameCount;
+                if (!oldestSame || voice.startedAt < oldestSame->startedAt) oldestSame = &voice;
             }
-            case WeaponType::Triple: {
-                auto bullet1 = std::make_shared<Bullet>("assets/images/weapons/bullet2.png", 20.0f);
-                auto bullet2 = std::make_shared<Bullet>("assets/images/weapons/bullet2.png", 20.0f);
-                auto bullet3 = std::make_shared<Bullet>("assets/images/weapons/bullet2.png", 20.0f);
-                bullet1->setPosition(getPosition().x, getPosition().y - 30.f);
-                bullet2->setPosition(getPosition().x - 25.f, getPosition().y - 15.f);
-                bullet3->setPosition(getPosition().x + 25.f, getPosition().y - 15.f);
-                newBullets.push_back(bullet1);
-                newBullets.push_back(bullet2);
-                newBullets.push_back(bullet3);
-                break;
+            // Steal from the lowest priority, oldest voice that is not more important than this one
+            int voicePriority = soundTable[static_cast<int>(voice.id)].priority;
+            if (voicePriority <= def.priority) {
+                if (!victim || voicePriority < soundTable[static_cast<int>(victim->id)].priority ||
+                    (voicePriority == soundTable[static_cast<int>(victim->id)].priority && voice.startedAt < victim->startedAt)) {
+                    victim = &voice;
+                }
             }
-            case WeaponType::Laser:
-                // Laser is handled separately
-                break;
         }
-        
-        return newBullets;
-    }
 
-    std::shared_ptr<Laser> shootLaser() {
-        if (weaponType == WeaponType::Laser) {
-            auto laser = std::make_shared<Laser>();
-            laser->setPosition(getPosition().x, getPosition().y - 300.f);
-            return laser;
+        if (sameCount >= def.maxVoices) {
+            chosen = oldestSame;
+        } else if (!chosen) {
+            chosen = victim;
         }
-        return nullptr;
-    }
-
-    void takeDamage(int amount) {
-        if (shield->isActive()) {
-            shield->takeDamage(amount);
+        if (!chosen) {
             return;
         }
-        
-        health -= amount;
-        if (health < 0) health = 0;
-    }
+        if (chosen->sound.getStatus() == sf::Sound::Playing) {
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            chosen->sound.stop();
+        }
 
-    void heal(int amount) {
-        health += amount;
-        if (health > 100) health = 100;
+        chosen->id = id;
+        chosen->startedAt = ++voiceSerial;
+        chosen->sound.setBuffer(buffers[static_cast<int>(id)]);
+        chosen->sound.setVolume(std::min(100.0f, def.volume * (1.0f + 0.25f * std::log2(static_cast<float>(count)))));
+        chosen->sound.play();
     }
 
-    void activateShield() {
-        shield->activate();
-    }
+    sf::SoundBuffer buffers[static_cast<int>(SoundId::Count)];
+    Voice voices[voiceCount];
+    std::uint64_t voiceSerial = 0;
 
-    void upgradeWeapon() {
-        switch (weaponType) {
-            case WeaponType::Basic:
-                weaponType = WeaponType::Double;
-                break;
-            case WeaponType::Double:
-                weaponType = WeaponType::Triple;
-                break;
-            case WeaponType::Triple:
-                weaponType = WeaponType::Laser;
-                break;
-            case WeaponType::Laser:
-                // Already at max level
-                addScore(50); // Give bonus points instead
-                break;
-        }
-    }
+    // Single-producer, single-consumer ring: the simulation writes tail, the mixer writes head
+    std::uint32_t tick;
+    int pending[static_cast<int>(SoundId::Count)];
+    Request queue[queueCapacity];
+    std::atomic<std::uint32_t> head;
+    std::atomic<std::uint32_t> tail;
 
-    int getHealth() const { return health; }
-    int getScore() const { return score; }
-    void addScore(int points) { score += points; }
-    void resetScore() { score = 0; }
-    void resetHealth() { health = 100; }
-    WeaponType getWeaponType() const { return weaponType; }
-    void resetWeapon() { weaponType = WeaponType::Basic; }
-    bool hasShield() const { return shield->isActive(); }
-    float getShieldHealth() const { return shield->getHealth(); }
-    void drawShield(sf::RenderWindow& window) const {
-        if (shield->isActive()) {
-            shield->draw(window);
-        }
-    }
+    std::thread mixer;
+    std::atomic<bool> running;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
 
-private:
-    float speed = 300.0f;
-    int health;
-    int score;
-    WeaponType weaponType;
-    sf::Clock shootClock;
-    bool shieldActive;
-    std::unique_ptr<Shield> shield;
+    std::atomic<std::uint64_t> dropped;
+    std::atomic<std::uint64_t> merged;
+    std::atomic<std::uint64_t> stolen;
+
+    std::mutex reloadMutex;
+    std::vector<BufferReload> reloads;
+    std::atomic<bool> reloadPending{ false };
 };
 
-// Enemy base class
-class Enemy : public Entity {
+// Files loaded at startup besides the entity textures and the sound table
+const char* const fontPath = "assets/Arial.ttf";
+const char* const backgroundPath = "assets/images/background.jpg";
+const char* const explosionSheetPath = "assets/images/effects/explosion.png";
+const char* const assetPackPath = "assets/assets.pack";
+
+bool readFileBytes(const char* path, std::vector<char>& bytes) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !bytes.empty();
+}
+
+// Asset pack - one file holding every startup asset already decoded: RGBA8 pixels, 16-bit PCM
+// samples and raw font bytes, each 64-byte aligned. It is memory-mapped, and textures, sound
+// buffers and the font are created straight from the mapping. Written by --pack-assets in the
+// byte order of the machine that runs it.
+class AssetPack {
 public:
-    Enemy(const std::string& texturePath, EnemyType type, float health, float speed, int scoreValue)
-        : Entity(texturePath), type(type), health(health), speed(speed), scoreValue(scoreValue) {
-        setScale(0.5f, 0.5f);
-        setRotation(180.f); // Flip enemy to face down
-    }
+    enum class Kind : std::uint32_t {
+        Pixels,  // width x height RGBA8
+        Samples, // Int16 samples; width is the channel count, height the sample rate
+        Bytes
+    };
 
-    virtual void update(float deltaTime) override {
-        move(0.f, speed * deltaTime);
-    }
+    struct Entry {
+        char path[64];
+        Kind kind;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t reserved;
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+    static_assert(sizeof(Entry) == 96, "pack index entries are written as-is");
 
-    bool isOffScreen() const {
-        return getPosition().y > 600;
-    }
+    // Builds a pack in memory and writes it out in one go
+    class Writer {
+    public:
+        bool add(const char* path, Kind kind, std::uint32_t width, std::uint32_t height, const void* data, std::size_t size) {
+            if (std::strlen(path) >= sizeof(Entry::path)) return false;
 
-    void takeDamage(float amount) {
-        health -= amount;
-    }
+            Entry entry = {};
+            std::strcpy(entry.path, path);
+            entry.kind = kind;
+            entry.width = width;
+            entry.height = height;
+            entry.size = size;
+            entries.push_back(entry);
+            blobs.emplace_back(static_cast<const char*>(data), static_cast<const char*>(data) + size);
+            return true;
+        }
 
-    bool isDestroyed() const {
-        return health <= 0;
-    }
+        bool write(const char* outputPath) {
+            Header header = {};
+            std::memcpy(header.magic, packMagic, sizeof(header.magic));
+            header.version = packVersion;
+            header.entryCount = static_cast<std::uint32_t>(entries.size());
 
-    EnemyType getType() const { return type; }
-    int getScoreValue() const { return scoreValue; }
+            std::uint64_t offset = align(sizeof(Header) + entries.size() * sizeof(Entry));
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                entries[i].offset = offset;
+                offset = align(offset + entries[i].size);
+            }
 
-protected:
-    EnemyType type;
-    float health;
-    float speed;
-    int scoreValue;
-};
+            std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                pad(file, entries[i].offset);
+                file.write(blobs[i].data(), blobs[i].size());
+            }
+            pad(file, offset);
+            return static_cast<bool>(file);
+        }
 
-// Basic enemy - moves straight down
-class BasicEnemy : public Enemy {
-public:
-    BasicEnemy() : Enemy("assets/images/enemies/enemy1.png", EnemyType::Basic, 20.0f, 150.0f, 10) {}
-};
+        std::size_t getEntryCount() const { return entries.size(); }
 
-// Fast enemy - moves faster but has less health
-class FastEnemy : public Enemy {
-public:
-    FastEnemy() : Enemy("assets/images/enemies/enemy2.png", EnemyType::Fast, 10.0f, 250.0f, 15) {}
-};
+    private:
+        static void pad(std::ofstream& file, std::uint64_t offset) {
+            static const char zeros[dataAlignment] = {};
+            std::uint64_t position = static_cast<std::uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(offset - position));
+        }
 
-// Tanky enemy - moves slower but has more health
-class TankyEnemy : public Enemy {
-public:
-    TankyEnemy() : Enemy("assets/images/enemies/enemy3.png", EnemyType::Tanky, 40.0f, 100.0f, 20) {}
-};
+        std::vector<Entry> entries;
+        std::vector<std::vector<char>> blobs;
+    };
 
-// Boss enemy - special enemy with unique behavior
-class BossEnemy : public Enemy {
-public:
-    BossEnemy() : Enemy("assets/images/enemies/boss.png", EnemyType::Boss, 500.0f, 50.0f, 500),
-                  state(BossState::Entering), stateTime(0.0f), shootCooldown(0.0f) {
-        setScale(1.0f, 1.0f);
-    }
+    AssetPack() : data(nullptr), size(0) {}
+    ~AssetPack() { close(); }
 
-    void update(float deltaTime) override {
-        stateTime += deltaTime;
-        shootCooldown -= deltaTime;
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
 
-        switch (state) {
-            case BossState::Entering:
-                // Move down to position
-                if (getPosition().y < 100) {
-                    move(0.f, speed * deltaTime);
-                } else {
-                    state = BossState::MovingLeft;
-                    stateTime = 0.0f;
-                }
-                break;
-                
-            case BossState::MovingLeft:
-                move(-speed * 1.5f * deltaTime, 0.f);
-                if (stateTime > 2.0f || getPosition().x < 100) {
-                    state = BossState::MovingRight;
-                    stateTime = 0.0f;
-                }
-                break;
-                
-            case BossState::MovingRight:
-                move(speed * 1.5f * deltaTime, 0.f);
-                if (stateTime > 2.0f || getPosition().x > 700) {
-                    state = BossState::MovingLeft;
-                    stateTime = 0.0f;
-                }
-                break;
+    bool open(const char* path) {
+        close();
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data = static_cast<const char*>(mapped);
+                size = static_cast<std::size_t>(info.st_size);
+            }
+        }
+        ::close(fd);
+#else
+        if (readFileBytes(path, fallback)) {
+            data = fallback.data();
+            size = fallback.size();
+        }
+#endif
+        if (!data) return false;
+
+        if (!validate()) {
+            std::cerr << "Ignoring asset pack " << path << ": bad header or index" << std::endl;
+            close();
+            return false;
         }
+        return true;
     }
 
-    bool canShoot() {
-        if (shootCooldown <= 0.0f) {
-            shootCooldown = 0.5f; // Shoot every 0.5 seconds
-            return true;
+    void close() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (data) {
+            munmap(const_cast<char*>(data), size);
         }
-        return false;
+#else
+        fallback.clear();
+#endif
+        data = nullptr;
+        size = 0;
     }
 
-    std::vector<std::shared_ptr<Bullet>> shoot() {
-        std::vector<std::shared_ptr<Bullet>> bullets;
-        
-        // Boss shoots 3 bullets in a spread pattern
-        for (int i = -1; i <= 1; ++i) {
-            auto bullet = std::make_shared<Bullet>("assets/images/weapons/bullet2.png");
-            bullet->setPosition(getPosition().x + i * 30.f, getPosition().y + 50.f);
-            bullet->setRotation(180.f); // Bullets go down
-            bullets.push_back(bullet);
+    bool isOpen() const { return data != nullptr; }
+
+    const Entry* find(const char* path, Kind kind) const {
+        if (!data) return nullptr;
+        for (std::uint32_t i = 0; i < getHeader().entryCount; ++i) {
+            const Entry& entry = getEntries()[i];
+            if (entry.kind == kind && std::strncmp(entry.path, path, sizeof(entry.path)) == 0) {
+                return &entry;
+            }
         }
-        
-        return bullets;
+        return nullptr;
     }
 
+    const void* getData(const Entry& entry) const { return data + entry.offset; }
+
+    std::size_t getEntryCount() const { return data ? getHeader().entryCount : 0; }
+    const Entry& getEntry(std::size_t index) const { return getEntries()[index]; }
+
+    std::size_t getSize() const { return size; }
+
 private:
-    enum class BossState {
-        Entering,
-        MovingLeft,
-        MovingRight
-    };
-    
-    BossState state;
-    float stateTime;
-    float shootCooldown;
-};
+    static constexpr char packMagic[4] = { 'S', 'S', 'P', 'K' };
+    static constexpr std::uint32_t packVersion = 1;
+    static constexpr std::uint64_t dataAlignment = 64;
 
-// PowerUp class
-class PowerUp : public Entity {
-public:
-    PowerUp(PowerUpType type) : Entity(getTexturePath(type)), type(type) {
-        setScale(0.5f, 0.5f);
-    }
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t entryCount;
+        std::uint32_t reserved;
+    };
 
-    void update(float deltaTime) override {
-        move(0.f, speed * deltaTime);
+    static std::uint64_t align(std::uint64_t offset) {
+        return (offset + dataAlignment - 1) & ~(dataAlignment - 1);
     }
 
-    bool isOffScreen() const {
-        return getPosition().y > 600;
-    }
+    const Header& getHeader() const { return *reinterpret_cast<const Header*>(data); }
+    const Entry* getEntries() const { return reinterpret_cast<const Entry*>(data + sizeof(Header)); }
 
-    PowerUpType getType() const { return type; }
+    bool validate() const {
+        if (size < sizeof(Header)) return false;
+        const Header& header = getHeader();
+        if (std::memcmp(header.magic, packMagic, sizeof(packMagic)) != 0 || header.version != packVersion) return false;
+        if (sizeof(Header) + static_cast<std::uint64_t>(header.entryCount) * sizeof(Entry) > size) return false;
 
-private:
-    std::string getTexturePath(PowerUpType type) {
-        switch (type) {
-            case PowerUpType::Health: return "assets/images/powerup.png";
-            case PowerUpType::Shield: return "assets/images/effects/shield.png";
-            case PowerUpType::WeaponUpgrade: return "assets/images/weapons/bullet2.png";
-            case PowerUpType::ScoreBoost: return "assets/images/powerup.png";
-            default: return "assets/images/powerup.png";
+        for (std::uint32_t i = 0; i < header.entryCount; ++i) {
+            const Entry& entry = getEntries()[i];
+            if (entry.offset % dataAlignment != 0 || entry.offset > size || entry.size > size - entry.offset) return false;
+            if (entry.kind == Kind::Pixels && entry.size != static_cast<std::uint64_t>(entry.width) * entry.height * 4) return false;
+            if (entry.kind == Kind::Samples && (entry.size % sizeof(sf::Int16) != 0 || entry.width == 0)) return false;
         }
+        return true;
     }
 
-    PowerUpType type;
-    float speed = 150.0f;
+    const char* data;
+    std::size_t size;
+#if !defined(__unix__) && !defined(__APPLE__)
+    std::vector<char> fallback;
+#endif
 };
 
-// Level system
-class Level {
-public:
-    Level() : currentLevel(1), enemiesDefeated(0), bossSpawned(false) {}
+// Decodes every startup asset from loose files into a pack; returns false if any file was skipped
+bool packAssets(const char* outputPath, bool verbose) {
+    AssetPack::Writer writer;
+    bool ok = true;
 
-    void update(int defeatedEnemies) {
-        enemiesDefeated += defeatedEnemies;
-        
-        // Level up after defeating certain number of enemies
-        if (enemiesDefeated >= getEnemiesForNextLevel() && !bossSpawned) {
-            currentLevel++;
-            enemiesDefeated = 0;
-            bossSpawned = true;
+    auto addImage = [&](const char* path) {
+        sf::Image image;
+        if (image.loadFromFile(path) &&
+            writer.add(path, AssetPack::Kind::Pixels, image.getSize().x, image.getSize().y, image.getPixelsPtr(),
+                       static_cast<std::size_t>(image.getSize().x) * image.getSize().y * 4)) {
+            if (verbose) std::cout << "  " << path << ": " << image.getSize().x << "x" << image.getSize().y << " RGBA" << std::endl;
+        } else {
+            if (verbose) std::cerr << "  " << path << ": could not be decoded, skipped" << std::endl;
+            ok = false;
         }
-    }
+    };
 
-    int getCurrentLevel() const { return currentLevel; }
-    bool isBossLevel() const { return bossSpawned; }
-    void resetBossFlag() { bossSpawned = false; }
-    
-    float getEnemySpawnInterval() const {
-        return std::max(1.5f - (currentLevel - 1) * 0.1f, 0.5f);
-    }
-    
-    float getPowerUpSpawnInterval() const {
-        return std::max(10.0f - (currentLevel - 1) * 0.5f, 5.0f);
+    for (int i = 0; i < static_cast<int>(TextureId::Count); ++i) {
+        addImage(getTexturePath(static_cast<TextureId>(i)));
     }
-    
-    int getEnemiesForNextLevel() const {
-        return 20 + (currentLevel - 1) * 5;
+    addImage(backgroundPath);
+    addImage(explosionSheetPath);
+
+    for (const SoundDef& sound : soundTable) {
+        sf::InputSoundFile file;
+        std::vector<sf::Int16> samples;
+        if (file.openFromFile(sound.path)) {
+            samples.resize(static_cast<std::size_t>(file.getSampleCount()));
+            samples.resize(static_cast<std::size_t>(file.read(samples.data(), samples.size())));
+        }
+        if (!samples.empty() &&
+            writer.add(sound.path, AssetPack::Kind::Samples, file.getChannelCount(), file.getSampleRate(), samples.data(),
+                       samples.size() * sizeof(sf::Int16))) {
+            if (verbose) std::cout << "  " << sound.path << ": " << samples.size() << " samples" << std::endl;
+        } else {
+            if (verbose) std::cerr << "  " << sound.path << ": could not be decoded, skipped" << std::endl;
+            ok = false;
+        }
     }
-    
-    void reset() {
-        currentLevel = 1;
-        enemiesDefeated = 0;
-        bossSpawned = false;
+
+    std::vector<char> fontBytes;
+    if (readFileBytes(fontPath, fontBytes) && writer.add(fontPath, AssetPack::Kind::Bytes, 0, 0, fontBytes.data(), fontBytes.size())) {
+        if (verbose) std::cout << "  " << fontPath << ": " << fontBytes.size() << " bytes" << std::endl;
+    } else {
+        if (verbose) std::cerr << "  " << fontPath << ": could not be read, skipped" << std::endl;
+        ok = false;
     }
 
-private:
-    int currentLevel;
-    int enemiesDefeated;
-    bool bossSpawned;
-};
+    if (!writer.write(outputPath)) {
+        std::cerr << "Failed to write " << outputPath << std::endl;
+        return false;
+    }
+    if (verbose) std::cout << "Wrote " << writer.getEntryCount() << " assets to " << outputPath << std::endl;
+    return ok;
+}
 
-// Game class to manage the game state
-class Game {
+// Asset loader - decodes images, sounds and the font on worker threads while the render thread
+// shows a progress bar. Decoded assets are handed back and uploaded on the render thread, which
+// owns the GL context and the audio buffers. Assets found in the asset pack skip decoding and
+// are uploaded straight from the mapping.
+class AssetLoader {
 public:
-    Game() : window(sf::VideoMode(800, 600), "Space Shooter"), gameState(GameState::MainMenu), deltaTime(0.0f) {
-        window.setFramerateLimit(60);
-        
-        // Load resources
-        loadResources();
-        
-        // Initialize game objects
-        player.setPosition(400.f, 550.f);
-        
-        // Initialize UI elements
-        initializeUI();
+    AssetLoader() : pack(nullptr), nextJob(0), finishedJobs(0) {
+        // Entities created meanwhile get an empty texture until the decoded image is uploaded
+        TextureCache::setDeferred(true);
     }
-    
-    void run() {
-        sf::Clock clock;
-        
-        while (window.isOpen()) {
-            deltaTime = clock.restart().asSeconds();
-            
-            handleEvents();
-            update();
-            render();
+
+    ~AssetLoader() {
+        for (auto& worker : workers) {
+            worker.join();
         }
     }
 
-private:
-    void loadResources() {
-        // Load font
-        if (!font.loadFromFile("assets/arial.ttf")) {
-            // Handle error
+    // Must be set before any job is added
+    void setPack(const AssetPack* assetPack) { pack = assetPack; }
+
+    void addTexture(TextureId id) { addJob(Kind::CachedTexture, static_cast<int>(id), getTexturePath(id)); }
+    // A non-zero displaySize resamples the image down to the size it is drawn at
+    void addTexture(const char* path, sf::Texture& target, sf::Vector2u displaySize = sf::Vector2u()) {
+        Job& job = addJob(Kind::Texture, 0, path);
+        job.texture = &target;
+        job.displaySize = displaySize;
+    }
+    void addSound(SoundId id) { addJob(Kind::Sound, static_cast<int>(id), soundTable[static_cast<int>(id)].path); }
+    void addFont(const char* path, sf::Font& target) { addJob(Kind::Font, 0, path).font = &target; }
+
+    void start() {
+        std::size_t workerCount = std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<unsigned>(jobs.size())));
+        for (std::size_t i = 0; i < workerCount; ++i) {
+            workers.emplace_back(&AssetLoader::workerLoop, this);
         }
-        
-        // Load sounds
-        if (!shootBuffer.loadFromFile("assets/sounds/shoot.wav") ||
-            !explosionBuffer.loadFromFile("assets/sounds/explosion.wav") ||
-            !powerupBuffer.loadFromFile("assets/sounds/powerup.wav") ||
-            !upgradeBuffer.loadFromFile("assets/sounds/upgrade.wav") ||
-            !bossBuffer.loadFromFile("assets/sounds/boss.wav")) {
-            // Handle error
+    }
+
+    // Uploads every job that finished decoding since the last call; render thread only
+    void uploadFinished(AudioService& audio) {
+        for (auto& job : jobs) {
+            if (job->uploaded || !job->decoded.load(std::memory_order_acquire)) continue;
+
+            bool ok = job->ok;
+            switch (job->kind) {
+                case Kind::CachedTexture:
+                    ok = ok && TextureCache::upload(static_cast<TextureId>(job->id), job->width, job->height, job->pixels, job->sourceSize);
+                    break;
+                case Kind::Texture:
+                    ok = ok && job->texture->create(job->width, job->height);
+                    if (ok) job->texture->update(job->pixels);
+                    break;
+                case Kind::Sound:
+                    ok = ok && audio.setBuffer(static_cast<SoundId>(job->id), job->samples, job->sampleCount, job->channelCount, job->sampleRate);
+                    break;
+                case Kind::Font:
+                    // sf::Font reads from the buffer for as long as it lives, so the bytes stay around
+                    ok = ok && job->font->loadFromMemory(job->bytes, job->byteCount);
+                    break;
+            }
+            if (!ok) {
+                std::cerr << "Failed to load " << job->path << std::endl;
+            }
+
+            job->image = sf::Image();
+            job->decodedSamples = std::vector<sf::Int16>();
+            job->uploaded = true;
         }
-        
-        shootSound.setBuffer(shootBuffer);
-        explosionSound.setBuffer(explosionBuffer);
-        powerupSound.setBuffer(powerupBuffer);
-        upgradeSound.setBuffer(upgradeBuffer);
-        bossSound.setBuffer(bossBuffer);
-        
-        // Load background
-        if (!backgroundTexture.loadFromFile("assets/images/background.jpg")) {
-            // Handle error
+
+        if (isFinished()) {
+            TextureCache::setDeferred(false);
         }
-        background.setTexture(backgroundTexture);
-        
-        // Scale background to fit window
-        float scaleX = 800.0f / backgroundTexture.getSize().x;
-        float scaleY = 600.0f / backgroundTexture.getSize().y;
-        background.setScale(scaleX, scaleY);
-        
-        // Load explosion texture
-        if (!explosionTexture.loadFromFile("assets/images/effects/explosion.png")) {
-            // Handle error
+    }
+
+    float getProgress() const {
+        return jobs.empty() ? 1.0f : static_cast<float>(finishedJobs.load()) / jobs.size();
+    }
+
+    bool isFinished() const {
+        return finishedJobs.load() == jobs.size();
+    }
+
+    // Size of the image a texture job decoded, before any resampling
+    sf::Vector2u getSourceSize(const sf::Texture& target) const {
+        for (const auto& job : jobs) {
+            if (job->texture == &target) return job->sourceSize;
         }
+        return sf::Vector2u();
     }
-    
-    void initializeUI() {
-        // Score text
-        scoreText.setFont(font);
-        scoreText.setCharacterSize(24);
-        scoreText.setFillColor(sf::Color::White);
-        scoreText.setPosition(10.f, 10.f);
-        
-        // Level text
-        levelText.setFont(font);
-        levelText.setCharacterSize(24);
-        levelText.setFillColor(sf::Color::White);
-        levelText.setPosition(10.f, 40.f);
-        
-        // Health bar
-        healthBarBackground.setSize(sf::Vector2f(200.f, 20.f));
-        healthBarBackground.setFillColor(sf::Color(100, 100, 100));
-        healthBarBackground.setPosition(10.f, 70.f);
-        
-        healthBar.setSize(sf::Vector2f(200.f, 20.f));
-        healthBar.setFillColor(sf::Color::Green);
-        healthBar.setPosition(10.f, 70.f);
-        
-        // Shield bar
-        shieldBarBackground.setSize(sf::Vector2f(200.f, 10.f));
-        shieldBarBackground.setFillColor(sf::Color(100, 100, 100));
-        shieldBarBackground.setPosition(10.f, 95.f);
-        
-        shieldBar.setSize(sf::Vector2f(200.f, 10.f));
-        shieldBar.setFillColor(sf::Color::Cyan);
-        shieldBar.setPosition(10.f, 95.f);
-        
-        // Weapon indicator
-        weaponText.setFont(font);
-        weaponText.setCharacterSize(18);
-        weaponText.setFillColor(sf::Color::White);
-        weaponText.setPosition(10.f, 110.f);
-        
-        // Game over text
-        gameOverText.setFont(font);
-        gameOverText.setCharacterSize(64);
-        gameOverText.setFillColor(sf::Color::Red);
-        gameOverText.setString("GAME OVER");
-        gameOverText.setPosition(200.f, 200.f);
-        
-        // Victory text
-        victoryText.setFont(font);
-        victoryText.setCharacterSize(64);
-        victoryText.setFillColor(sf::Color::Green);
-        victoryText.setString("VICTORY!");
-        victoryText.setPosition(250.f, 200.f);
-        
-        // Restart text
-        restartText.setFont(font);
-        restartText.setCharacterSize(32);
-        restartText.setFillColor(sf::Color::White);
-        restartText.setString("Press R to restart");
-        restartText.setPosition(275.f, 300.f);
-        
-        // Main menu text
-        titleText.setFont(font);
-        titleText.setCharacterSize(64);
-        titleText.setFillColor(sf::Color::Yellow);
-        titleText.setString("SPACE SHOOTER");
-        titleText.setPosition(150.f, 100.f);
-        
-        startText.setFont(font);
-        startText.setCharacterSize(32);
-        startText.setFillColor(sf::Color::White);
-        startText.setString("Press ENTER to start");
-        startText.setPosition(250.f, 300.f);
-        
-        controlsText.setFont(font);
-        controlsText.setCharacterSize(24);
-        controlsText.setFillColor(sf::Color::White);
-        controlsText.setString("Controls:\nArrow Keys - Move\nSpace - Shoot");
-        controlsText.setPosition(250.f, 400.f);
-        
-        // Boss warning text
-        bossWarningText.setFont(font);
-        bossWarningText.setCharacterSize(48);
-        bossWarningText.setFillColor(sf::Color::Red);
-        bossWarningText.setString("WARNING: BOSS APPROACHING!");
-        bossWarningText.setPosition(75.f, 250.f);
-        bossWarningVisible = false;
-        bossWarningTime = 0.0f;
+
+    std::size_t getPackedCount() const {
+        return static_cast<std::size_t>(std::count_if(jobs.begin(), jobs.end(), [](const std::unique_ptr<Job>& job) { return job->packed != nullptr; }));
     }
-    
-    void handleEvents() {
-        sf::Event event;
-        while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed)
-                window.close();
-            
-            // Handle key presses
-            if (event.type == sf::Event::KeyPressed) {
-                if (gameState == GameState::MainMenu && event.key.code == sf::Keyboard::Return) {
-                    startGame();
-                }
-                else if ((gameState == GameState::GameOver || gameState == GameState::Victory) && 
-                         event.key.code == sf::Keyboard::R) {
-                    startGame();
-                }
+
+private:
+    enum class Kind {
+        CachedTexture,
+        Texture,
+        Sound,
+        Font
+    };
+
+    struct Job {
+        Kind kind;
+        int id;
+        const char* path;
+        sf::Texture* texture = nullptr;
+        sf::Font* font = nullptr;
+        const AssetPack::Entry* packed = nullptr;
+        sf::Vector2u displaySize;
+
+        // Filled in by a worker; the pointers refer to the storage below or into the pack
+        bool ok = false;
+        unsigned width = 0;
+        unsigned height = 0;
+        sf::Vector2u sourceSize;
+        const sf::Uint8* pixels = nullptr;
+        const sf::Int16* samples = nullptr;
+        std::size_t sampleCount = 0;
+        unsigned channelCount = 0;
+        unsigned sampleRate = 0;
+        const void* bytes = nullptr;
+        std::size_t byteCount = 0;
+        std::atomic<bool> decoded{ false };
+
+        sf::Image image;
+        std::vector<sf::Int16> decodedSamples;
+        std::vector<char> decodedBytes;
+
+        bool uploaded = false;
+    };
+
+    Job& addJob(Kind kind, int id, const char* path) {
+        jobs.push_back(std::make_unique<Job>());
+        Job& job = *jobs.back();
+        job.kind = kind;
+        job.id = id;
+        job.path = path;
+        if (pack) {
+            AssetPack::Kind packKind = kind == Kind::Sound ? AssetPack::Kind::Samples : kind == Kind::Font ? AssetPack::Kind::Bytes : AssetPack::Kind::Pixels;
+            job.packed = pack->find(path, packKind);
+        }
+        return job;
+    }
+
+    void workerLoop() {
+        for (std::size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+            if (jobs[i]->packed) {
+                usePacked(*jobs[i]);
+            } else {
+                decode(*jobs[i]);
             }
+            if (jobs[i]->ok && jobs[i]->pixels) {
+                resample(*jobs[i]);
+            }
+            jobs[i]->decoded.store(true, std::memory_order_release);
+            ++finishedJobs;
         }
     }
-    
-    void update() {
-        switch (gameState) {
-            case GameState::MainMenu:
-                // Nothing to update in main menu
-                break;
-                
-            case GameState::Playing:
-                updatePlaying();
+
+    // Brings decoded pixels down to the size they are uploaded at
+    static void resample(Job& job) {
+        job.sourceSize = sf::Vector2u(job.width, job.height);
+        sf::Image resampled;
+        if (job.kind == Kind::CachedTexture) {
+            resampled = TextureCache::prepare(static_cast<TextureId>(job.id), job.pixels, job.sourceSize);
+        } else if (job.displaySize.x > 0 && job.displaySize.x <= job.width && job.displaySize.y <= job.height &&
+                   job.displaySize != job.sourceSize) {
+            resampled = downscaleArea(job.pixels, job.sourceSize, job.displaySize.x, job.displaySize.y);
+        } else {
+            return;
+        }
+
+        job.image = std::move(resampled);
+        job.width = job.image.getSize().x;
+        job.height = job.image.getSize().y;
+        job.pixels = job.image.getPixelsPtr();
+    }
+
+    void usePacked(Job& job) const {
+        const AssetPack::Entry& entry = *job.packed;
+        const void* data = pack->getData(entry);
+        switch (entry.kind) {
+            case AssetPack::Kind::Pixels:
+                job.width = entry.width;
+                job.height = entry.height;
+                job.pixels = static_cast<const sf::Uint8*>(data);
                 break;
-                
-            case GameState::BossFight:
-                updateBossFight();
+            case AssetPack::Kind::Samples:
+                job.samples = static_cast<const sf::Int16*>(data);
+                job.sampleCount = static_cast<std::size_t>(entry.size / sizeof(sf::Int16));
+                job.channelCount = entry.width;
+                job.sampleRate = entry.height;
                 break;
-                
-            case GameState::GameOver:
-            case GameState::Victory:
-                // Update explosions
-                updateExplosions();
+            case AssetPack::Kind::Bytes:
+                job.bytes = data;
+                job.byteCount = static_cast<std::size_t>(entry.size);
                 break;
         }
+        job.ok = true;
     }
-    
-    void updatePlaying() {
-        // Update player
-        player.update(deltaTime);
-        
-        // Shooting
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Space) && player.canShoot()) {
-            if (player.getWeaponType() == WeaponType::Laser) {
-                auto laser = player.shootLaser();
-                if (laser) {
-                    lasers.push_back(laser);
-                    shootSound.play();
+
+    static void decode(Job& job) {
+        switch (job.kind) {
+            case Kind::CachedTexture:
+            case Kind::Texture:
+                job.ok = job.image.loadFromFile(job.path);
+                job.width = job.image.getSize().x;
+                job.height = job.image.getSize().y;
+                job.pixels = job.image.getPixelsPtr();
+                break;
+
+            case Kind::Sound: {
+                sf::InputSoundFile file;
+                if (file.openFromFile(job.path)) {
+                    job.decodedSamples.resize(static_cast<std::size_t>(file.getSampleCount()));
+                    job.channelCount = file.getChannelCount();
+                    job.sampleRate = file.getSampleRate();
+                    job.ok = file.read(job.decodedSamples.data(), job.decodedSamples.size()) == job.decodedSamples.size();
+                    job.samples = job.decodedSamples.data();
+                    job.sampleCount = job.decodedSamples.size();
                 }
-            } else {
-                auto newBullets = player.shoot();
-                bullets.insert(bullets.end(), newBullets.begin(), newBullets.end());
-                shootSound.play();
+                break;
             }
+
+            case Kind::Font:
+                job.ok = readFileBytes(job.path, job.decodedBytes);
+                job.bytes = job.decodedBytes.data();
+                job.byteCount = job.decodedBytes.size();
+                break;
         }
-        
-        // Spawn enemies
-        enemySpawnTimer += deltaTime;
-        if (enemySpawnTimer >= level.getEnemySpawnInterval()) {
-            spawnEnemy();
-            enemySpawnTimer = 0.0f;
+    }
+
+    const AssetPack* pack;
+    std::vector<std::unique_ptr<Job>> jobs;
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> nextJob;
+    std::atomic<std::size_t> finishedJobs;
+};
+
+// Asset watcher - optional hot reload (--watch-assets). A background thread watches the asset
+// directories with inotify and decodes images and sounds as soon as a write finishes; the render
+// thread takes the decoded results at a frame boundary and swaps them into the caches.
+class AssetWatcher {
+public:
+    struct Reload {
+        std::string path;
+        bool ok = false;
+        bool isSound = false;
+        sf::Image image;
+        std::vector<sf::Int16> samples;
+        unsigned channelCount = 0;
+        unsigned sampleRate = 0;
+        std::chrono::system_clock::time_point saved;    // The file's mtime, so latency includes the inotify wakeup
+    };
+
+    AssetWatcher() : running(false) {}
+
+    ~AssetWatcher() {
+        stop();
+    }
+
+    bool start(const std::vector<std::string>& directories) {
+#ifdef __linux__
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return false;
+
+        for (const std::string& directory : directories) {
+            int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd >= 0) {
+                watchedDirectories[wd] = directory;
+            }
         }
-        
-        // Spawn power-ups
-        powerupSpawnTimer += deltaTime;
-        if (powerupSpawnTimer >= level.getPowerUpSpawnInterval()) {
-            spawnPowerUp();
-            powerupSpawnTimer = 0.0f;
+        if (watchedDirectories.empty()) {
+            ::close(fd);
+            return false;
         }
-        
-        // Update bullets
-        updateBullets();
-        
-        // Update lasers
-        updateLasers();
-        
-        // Update enemies
-        updateEnemies();
-        
-        // Update power-ups
-        updatePowerUps();
-        
-        // Update explosions
-        updateExplosions();
-        
-        // Check if it's time to spawn a boss
-        if (level.isBossLevel()) {
-            startBossFight();
+
+        running = true;
+        watcher = std::thread(&AssetWatcher::watchLoop, this, fd);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void stop() {
+        if (running.exchange(false)) {
+            watcher.join();
         }
-        
-        // Update UI
-        updateUI();
     }
-    
-    void updateBossFight() {
-        // Update player
-        player.update(deltaTime);
-        
-        // Shooting
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Space) && player.canShoot()) {
-            if (player.getWeaponType() == WeaponType::Laser) {
-                auto laser = player.shootLaser();
-                if (laser) {
-                    lasers.push_back(laser);
-                    shootSound.play();
+
+    bool isRunning() const { return running.load(); }
+
+    // Render thread: everything decoded since the last call
+    std::vector<Reload> takePending() {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        std::vector<Reload> reloads;
+        reloads.swap(pending);
+        return reloads;
+    }
+
+private:
+#ifdef __linux__
+    void watchLoop(int fd) {
+        alignas(inotify_event) char buffer[4096];
+
+        while (running.load()) {
+            // Wake up now and then to notice stop()
+            pollfd descriptor = { fd, POLLIN, 0 };
+            if (poll(&descriptor, 1, 100) <= 0) continue;
+
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+
+            // An editor may touch the same file several times in one batch; decode it once
+            std::vector<std::string> changed;
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                auto directory = watchedDirectories.find(event->wd);
+                if (event->len == 0 || directory == watchedDirectories.end()) continue;
+
+                std::string path = directory->second + "/" + event->name;
+                if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+                    changed.push_back(path);
                 }
-            } else {
-                auto newBullets = player.shoot();
-                bullets.insert(bullets.end(), newBullets.begin(), newBullets.end());
-                shootSound.play();
-            }
-        }
-        
-        // Update boss
-        if (!boss) {
-            // Create boss if it doesn't exist
-            boss = std::make_shared<BossEnemy>();
-            boss->setPosition(400.f, -50.f);
-            bossSound.play();
-        } else {
-            boss->update(deltaTime);
-            
-            // Boss shooting
-            if (boss->canShoot()) {
-                auto bossBullets = boss->shoot();
-                enemyBullets.insert(enemyBullets.end(), bossBullets.begin(), bossBullets.end());
             }
-            
-            // Check if boss is destroyed
-            if (boss->isDestroyed()) {
-                // Create explosion
-                explosions.emplace_back(boss->getPosition(), 2.0f);
-                explosionSound.play();
-                
-                // Add score
-                player.addScore(boss->getScoreValue());
-                
-                // Clear boss
-                boss = nullptr;
-                
-                // Reset boss flag
-                level.resetBossFlag();
-                
-                // Check if this was the final boss (level 5)
-                if (level.getCurrentLevel() >= 5) {
-                    gameState = GameState::Victory;
+
+            for (const std::string& path : changed) {
+                Reload reload;
+                reload.path = path;
+                struct stat status;
+                if (stat(path.c_str(), &status) == 0) {
+                    reload.saved = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::seconds(status.st_mtim.tv_sec) + std::chrono::nanoseconds(status.st_mtim.tv_nsec)));
                 } else {
-                    gameState = GameState::Playing;
+                    reload.saved = std::chrono::system_clock::now();
                 }
+                if (!decode(reload)) continue;
+
+                std::lock_guard<std::mutex> lock(pendingMutex);
+                pending.push_back(std::move(reload));
             }
         }
-        
-        // Update bullets
-        updateBullets();
-        
-        // Update enemy bullets
-        for (auto it = enemyBullets.begin(); it != enemyBullets.end();) {
-            (*it)->move(0.f, 300.0f * deltaTime); // Enemy bullets move down
-            
-            // Check collision with player
-            if ((*it)->getBounds().intersects(player.getBounds())) {
-                player.takeDamage(10);
-                it = enemyBullets.erase(it);
-                
-                // Check if player is dead
-                if (player.getHealth() <= 0) {
-                    gameState = GameState::GameOver;
-                    explosions.emplace_back(player.getPosition());
-                    explosionSound.play();
-                }
-            }
-            // Remove off-screen bullets
-            else if ((*it)->getPosition().y > 600) {
-                it = enemyBullets.erase(it);
-            } else {
-                ++it;
+
+        ::close(fd);
+    }
+#endif
+
+    // Returns false for files that are neither images nor sounds
+    static bool decode(Reload& reload) {
+        std::string extension = reload.path.substr(reload.path.find_last_of('.') + 1);
+        if (extension == "wav") {
+            reload.isSound = true;
+            sf::InputSoundFile file;
+            if (file.openFromFile(reload.path)) {
+                reload.samples.resize(static_cast<std::size_t>(file.getSampleCount()));
+                reload.channelCount = file.getChannelCount();
+                reload.sampleRate = file.getSampleRate();
+                reload.ok = file.read(reload.samples.data(), reload.samples.size()) == reload.samples.size();
             }
+            return true;
         }
-        
-        // Update lasers
-        updateLasers();
-        
-        // Update explosions
-        updateExplosions();
-        
-        // Update UI
-        updateUI();
-        
-        // Update boss warning
-        if (bossWarningVisible) {
-            bossWarningTime += deltaTime;
-            if (bossWarningTime >= 3.0f) {
-                bossWarningVisible = false;
-            }
+        if (extension == "png" || extension == "jpg") {
+            reload.ok = reload.image.loadFromFile(reload.path);
+            return true;
         }
+        return false;
     }
-    
-    void updateBullets() {
-        for (auto it = bullets.begin(); it != bullets.end();) {
-            (*it)->update(deltaTime);
+
+    std::atomic<bool> running;
+    std::thread watcher;
+    std::map<int, std::string> watchedDirectories;
+    std::mutex pendingMutex;
+    std::vector<Reload> pending;
+};
+
+// Particle effect for explosions, etc.
+class Particle {
+public:
+    Particle(const sf::Vector2f& position, const sf::Color& color, float speed, float angle, float lifetime) 
+        : position(position), velocity(std::cos(angle) * speed, std::sin(angle) * speed), 
+          color(color), lifetime(lifetime), maxLifetime(lifetime) {
+        shape.setRadius(3.0f);
+        shape.setFillColor(color);
+        shape.setPosition(position);
+        shape.setOrigin(3.0f, 3.0f);
+    }
+
+    bool update(float deltaTime) {
+        lifetime -= deltaTime;
+        if (lifetime <= 0) return false;
+
+        position += velocity * deltaTime;
+        shape.setPosition(position);
+        
+        // Fade out as lifetime decreases
+        float alpha = (lifetime / maxLifetime) * 255;
+        sf::Color newColor = color;
+        newColor.a = static_cast<sf::Uint8>(alpha);
+        shape.setFillColor(newColor);
+        
+        return true;
+    }
+
+    void draw(sf::RenderWindow& window) const {
+        window.draw(shape);
+    }
+
+private:
+    sf::Vector2f position;
+    sf::Vector2f velocity;
+    sf::Color color;
+    float lifetime;
+    float maxLifetime;
+    sf::CircleShape shape;
+};
+
+// Explosion effect
+class Explosion {
+public:
+    Explosion(const sf::Vector2f& position, float scale = 1.0f, int particleCount = 30, float lifetimeScale = 1.0f)
+        : position(position), isActive(true) {
+        // Create particles
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_real_distribution<float> angleDist(0, 2 * 3.14159f);
+        std::uniform_real_distribution<float> speedDist(50.0f, 200.0f);
+        std::uniform_real_distribution<float> lifetimeDist(0.5f * lifetimeScale, 1.5f * lifetimeScale);
+        
+        for (int i = 0; i < particleCount; ++i) {
+            float angle = angleDist(gen);
+            float speed = speedDist(gen);
+            float lifetime = lifetimeDist(gen);
             
-            bool bulletRemoved = false;
+            sf::Color color;
+            if (i % 3 == 0) color = sf::Color(255, 60, 0);  // Orange
+            else if (i % 3 == 1) color = sf::Color(255, 200, 0);  // Yellow
+            else color = sf::Color(255, 0, 0);  // Red
             
-            // Check collision with enemies
-            for (auto enemyIt = enemies.begin(); enemyIt != enemies.end() && !bulletRemoved;) {
-                if ((*it)->getBounds().intersects((*enemyIt)->getBounds())) {
-                    // Enemy hit
-                    (*enemyIt)->takeDamage((*it)->getDamage());
-                    
-                    if ((*enemyIt)->isDestroyed()) {
-                        // Create explosion
-                        explosions.emplace_back((*enemyIt)->getPosition());
-                        explosionSound.play();
-                        
-                        // Add score
-                        player.addScore((*enemyIt)->getScoreValue());
-                        
-                        // Update level
-                        level.update(1);
-                        
-                        // Remove enemy
-                        enemyIt = enemies.erase(enemyIt);
-                    } else {
-                        ++enemyIt;
-                    }
-                    
-                    // Remove bullet
-                    it = bullets.erase(it);
-                    bulletRemoved = true;
-                } else {
-                    ++enemyIt;
+            particles.emplace_back(position, color, speed, angle, lifetime);
+        }
+    }
+
+    bool update(float deltaTime) {
+        for (auto it = particles.begin(); it != particles.end();) {
+            if (!it->update(deltaTime)) {
+                it = particles.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        
+        return !particles.empty();
+    }
+
+    void draw(sf::RenderWindow& window) const {
+        for (const auto& particle : particles) {
+            particle.draw(window);
+        }
+    }
+
+private:
+    sf::Vector2f position;
+    std::vector<Particle> particles;
+    bool isActive;
+};
+
+// Collision mask - 1-bit alpha mask of a texture at its in-game scale.
+// Rows are padded to whole 64-bit words so overlap tests can AND a word at a time.
+class CollisionMask {
+public:
+    CollisionMask() : width(0), height(0), wordsPerRow(0) {}
+
+    // Bake the mask from an image drawn at the given scale; flipped covers a 180 degree rotation
+    bool build(const sf::Image& image, float scaleX, float scaleY, bool flipped, sf::Uint8 alphaThreshold = 128) {
+        sf::Vector2u imageSize = image.getSize();
+        const sf::Uint8* pixels = image.getPixelsPtr();
+        if (imageSize.x == 0 || imageSize.y == 0 || !pixels || scaleX <= 0 || scaleY <= 0) {
+            return false;
+        }
+
+        width = std::max(1, static_cast<int>(std::ceil(imageSize.x * scaleX)));
+        height = std::max(1, static_cast<int>(std::ceil(imageSize.y * scaleY)));
+        wordsPerRow = (width + 63) / 64;
+        bits.assign(static_cast<std::size_t>(wordsPerRow) * height, 0);
+
+        for (int y = 0; y < height; ++y) {
+            // Sample the source pixel under the centre of each mask pixel
+            int srcY = std::min(static_cast<int>((y + 0.5f) / scaleY), static_cast<int>(imageSize.y) - 1);
+            if (flipped) srcY = imageSize.y - 1 - srcY;
+
+            for (int x = 0; x < width; ++x) {
+                int srcX = std::min(static_cast<int>((x + 0.5f) / scaleX), static_cast<int>(imageSize.x) - 1);
+                if (flipped) srcX = imageSize.x - 1 - srcX;
+
+                sf::Uint8 alpha = pixels[(static_cast<std::size_t>(srcY) * imageSize.x + srcX) * 4 + 3];
+                if (alpha >= alphaThreshold) {
+                    bits[static_cast<std::size_t>(y) * wordsPerRow + x / 64] |= std::uint64_t(1) << (x % 64);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Test against another mask whose top-left corner is offset by (dx, dy) pixels from ours
+    bool overlaps(const CollisionMask& other, int dx, int dy) const {
+        // Keep the right-hand mask as "b" so the shift is always non-negative
+        if (dx < 0) {
+            return other.overlaps(*this, -dx, -dy);
+        }
+
+        const CollisionMask& a = *this;
+        const CollisionMask& b = other;
+
+        int rowStart = std::max(0, dy);
+        int rowEnd = std::min(a.height, dy + b.height);
+        if (dx >= a.width || rowStart >= rowEnd) {
+            return false;
+        }
+
+        // Only b's words that land inside a need testing
+        int bWords = std::min(b.wordsPerRow, (a.width - dx + 63) / 64);
+
+        for (int ay = rowStart; ay < rowEnd; ++ay) {
+            const std::uint64_t* aRow = &a.bits[static_cast<std::size_t>(ay) * a.wordsPerRow];
+            const std::uint64_t* bRow = &b.bits[static_cast<std::size_t>(ay - dy) * b.wordsPerRow];
+
+            for (int k = 0; k < bWords; ++k) {
+                if (bRow[k] && (bRow[k] & a.extractWord(aRow, dx + k * 64))) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    std::size_t getMemoryUsage() const { return bits.size() * sizeof(std::uint64_t); }
+
+private:
+    // 64 bits of a row starting at an arbitrary bit offset
+    std::uint64_t extractWord(const std::uint64_t* row, int bitOffset) const {
+        int word = bitOffset / 64;
+        int shift = bitOffset % 64;
+        if (word >= wordsPerRow) return 0;
+
+        std::uint64_t value = row[word] >> shift;
+        if (shift != 0 && word + 1 < wordsPerRow) {
+            value |= row[word + 1] << (64 - shift);
+        }
+        return value;
+    }
+
+    int width;
+    int height;
+    int wordsPerRow;
+    std::vector<std::uint64_t> bits;
+};
+
+// Collision mask cache - one mask per texture, scale and rotation, baked on first use
+class CollisionMaskCache {
+public:
+    // Returns nullptr when no precise mask is available, in which case callers fall back to AABB
+    static const CollisionMask* get(TextureId textureId, float scaleX, float scaleY, float rotation) {
+        // Only upright and upside-down sprites are masked; anything else keeps the AABB test
+        long halfTurns = std::lround(rotation / 180.0f);
+        if (std::abs(rotation / 180.0f - halfTurns) > 0.001f) {
+            return nullptr;
+        }
+        bool flipped = halfTurns % 2 != 0;
+
+        auto key = std::make_tuple(textureId, scaleX, scaleY, flipped);
+        auto& masks = getMasks();
+        auto it = masks.find(key);
+        if (it != masks.end()) {
+            return it->second.get();
+        }
+
+        std::unique_ptr<CollisionMask> mask;
+        sf::Image image;
+        if (image.loadFromFile(getTexturePath(textureId))) {
+            mask = std::make_unique<CollisionMask>();
+            if (!mask->build(image, scaleX, scaleY, flipped)) {
+                mask = nullptr;
+            }
+        }
+
+        // Failed loads are cached too so a missing texture is only attempted once
+        const CollisionMask* result = mask.get();
+        masks.emplace(key, std::move(mask));
+        return result;
+    }
+
+    // Rebuilds every cached mask of a texture from a reloaded image. Masks are rebuilt in place
+    // because entities hold pointers to them; entities refresh to pick up masks that did not exist before.
+    static void reload(TextureId textureId, const sf::Image& image) {
+        for (auto& entry : getMasks()) {
+            if (std::get<0>(entry.first) != textureId) continue;
+
+            auto rebuilt = std::make_unique<CollisionMask>();
+            if (!rebuilt->build(image, std::get<1>(entry.first), std::get<2>(entry.first), std::get<3>(entry.first))) {
+                continue;
+            }
+            if (entry.second) {
+                *entry.second = std::move(*rebuilt);
+            } else {
+                entry.second = std::move(rebuilt);
+            }
+        }
+    }
+
+    static std::size_t getMemoryUsage() {
+        std::size_t total = 0;
+        for (const auto& entry : getMasks()) {
+            if (entry.second) total += entry.second->getMemoryUsage();
+        }
+        return total;
+    }
+
+private:
+    typedef std::tuple<TextureId, float, float, bool> Key;
+
+    static std::map<Key, std::unique_ptr<CollisionMask>>& getMasks() {
+        static std::map<Key, std::unique_ptr<CollisionMask>> masks;
+        return masks;
+    }
+};
+
+// Swept AABB - box a moves by 'motion' over the step while box b stays put (use relative motion
+// for two moving boxes). Returns the fraction of the step [enter, exit) during which they overlap.
+bool sweepAABB(const sf::FloatRect& a, const sf::FloatRect& b, const sf::Vector2f& motion, float& enter, float& exit) {
+    enter = 0.0f;
+    exit = 1.0f;
+
+    const float aMin[2] = { a.left, a.top };
+    const float aMax[2] = { a.left + a.width, a.top + a.height };
+    const float bMin[2] = { b.left, b.top };
+    const float bMax[2] = { b.left + b.width, b.top + b.height };
+    const float delta[2] = { motion.x, motion.y };
+
+    for (int axis = 0; axis < 2; ++axis) {
+        if (delta[axis] == 0.0f) {
+            // No motion on this axis - the boxes must already overlap on it
+            if (aMax[axis] <= bMin[axis] || aMin[axis] >= bMax[axis]) {
+                return false;
+            }
+            continue;
+        }
+
+        float t1 = (bMin[axis] - aMax[axis]) / delta[axis];
+        float t2 = (bMax[axis] - aMin[axis]) / delta[axis];
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+    }
+
+    return enter < exit;
+}
+
+// Snapshot layout check - a type copied into snapshots must hold no padding, or two snapshots of
+// the same state could differ in bytes nobody wrote. std::has_unique_object_representations
+// answers that for integer-only types but is false for anything holding a float, so those types
+// instead provide hasNoPadding(), comparing their size with the sum of their members.
+template <typename T, typename = void>
+struct IsPaddingFree : std::integral_constant<bool, std::has_unique_object_representations<T>::value> {};
+
+template <typename T>
+struct IsPaddingFree<T, decltype(void(T::hasNoPadding()))> : std::integral_constant<bool, T::hasNoPadding()> {};
+
+template <typename T, std::size_t N>
+struct IsPaddingFree<T[N]> : IsPaddingFree<T> {};
+
+template <typename T, std::size_t N>
+struct IsPaddingFree<std::array<T, N>> : std::integral_constant<bool, IsPaddingFree<T>::value && sizeof(std::array<T, N>) == N * sizeof(T)> {};
+
+// Snapshot copies - plain data in and out of a flat byte blob, advancing the cursor. Callers
+// size the blob first, so these never check bounds.
+template <typename T>
+std::uint8_t* writeSnapshot(std::uint8_t* out, const T* values, std::size_t count = 1) {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshots hold plain data only");
+    static_assert(IsPaddingFree<T>::value, "snapshot types spell out their padding as 'reserved' members");
+    if (count) std::memcpy(out, values, count * sizeof(T));
+    return out + count * sizeof(T);
+}
+
+template <typename T>
+const std::uint8_t* readSnapshot(const std::uint8_t* in, T* values, std::size_t count = 1) {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshots hold plain data only");
+    if (count) std::memcpy(values, in, count * sizeof(T));
+    return in + count * sizeof(T);
+}
+
+// A bool restored from a blob is whatever byte was there; only 0 and 1 are bools
+inline bool isValidSnapshotBool(const bool& value) {
+    std::uint8_t byte;
+    std::memcpy(&byte, &value, sizeof(byte));
+    return byte <= 1;
+}
+
+// FNV-1a over a byte range; snapshots are fully initialized, so equal states hash equal
+std::uint64_t hashBytes(const std::uint8_t* data, std::size_t size) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Timer handle - stays safe to use after its timer fires or is cancelled; it then simply
+// reports as not pending
+struct TimerHandle {
+    std::uint32_t index = 0;
+    std::uint32_t generation = 0;
+};
+
+// Timer wheel - simulation-time timers for cooldowns, spawns and state machines. It only moves
+// when advance() is called with the simulation's deltaTime, so timers follow pause, fast-forward
+// and headless runs. Four levels of 64 slots at 1 ms resolution cover about 4.6 hours; each level
+// keeps an occupancy bitmask so advancing skips empty slots and costs O(expired timers).
+// Timers carry an event code rather than a callback, so the wheel holds no pointers into its owner
+// and a simulation that owns one can be copied, saved and restored.
+class TimerWheel {
+public:
+    TimerWheel() : currentTick(0), elapsedTime(0.0), freeList(-1), pendingCount(0), pausedCount(0) {
+        clear();
+    }
+
+    // Expire after 'delay' seconds of simulation time, reporting 'event' to advance()'s handler
+    TimerHandle schedule(float delay, std::uint32_t event = 0) {
+        std::int32_t index = allocateNode();
+        Node& node = nodes[index];
+        node.event = event;
+        node.due = currentTick + toTicks(delay);
+        insert(index);
+        return TimerHandle{ static_cast<std::uint32_t>(index), node.generation };
+    }
+
+    // Re-arm a timer with its existing event; also works from inside the handler it expired into
+    void restart(TimerHandle handle, float delay) {
+        if (!isValid(handle)) return;
+
+        std::int32_t index = static_cast<std::int32_t>(handle.index);
+        Node& node = nodes[index];
+        if (node.state == NodeState::Scheduled) {
+            unlink(index);
+        } else if (node.state == NodeState::Paused) {
+            --pausedCount;
+        }
+        node.due = currentTick + toTicks(delay);
+        insert(index);
+    }
+
+    void cancel(TimerHandle handle) {
+        if (!isValid(handle)) return;
+
+        std::int32_t index = static_cast<std::int32_t>(handle.index);
+        Node& node = nodes[index];
+        if (node.state == NodeState::Scheduled) {
+            unlink(index);
+        } else if (node.state == NodeState::Paused) {
+            --pausedCount;
+        }
+        if (node.state != NodeState::Firing) {
+            releaseNode(index);
+        } else {
+            // Released once its handler returns
+            node.state = NodeState::Cancelled;
+        }
+    }
+
+    // Take a timer out of the wheel, keeping its remaining time for resume()
+    void pause(TimerHandle handle) {
+        if (!isValid(handle)) return;
+
+        std::int32_t index = static_cast<std::int32_t>(handle.index);
+        Node& node = nodes[index];
+        if (node.state == NodeState::Scheduled) {
+            unlink(index);
+            node.due -= currentTick;
+            node.state = NodeState::Paused;
+            ++pausedCount;
+        }
+    }
+
+    void resume(TimerHandle handle) {
+        if (!isValid(handle)) return;
+
+        std::int32_t index = static_cast<std::int32_t>(handle.index);
+        Node& node = nodes[index];
+        if (node.state == NodeState::Paused) {
+            --pausedCount;
+            node.due += currentTick;
+            insert(index);
+        }
+    }
+
+    // True while the timer is scheduled or paused
+    bool isPending(TimerHandle handle) const {
+        return isValid(handle) &&
+               (nodes[handle.index].state == NodeState::Scheduled || nodes[handle.index].state == NodeState::Paused);
+    }
+
+    float getRemaining(TimerHandle handle) const {
+        if (!isPending(handle)) return 0.0f;
+
+        const Node& node = nodes[handle.index];
+        std::int64_t ticks = node.state == NodeState::Paused ? node.due : node.due - currentTick;
+        return ticks * tickSeconds;
+    }
+
+    // Move simulation time forward; onExpire(handle, event) runs for each expired timer in due order
+    template <typename Handler>
+    void advance(float deltaTime, Handler&& onExpire) {
+        elapsedTime += deltaTime;
+        std::int64_t target = static_cast<std::int64_t>(elapsedTime / tickSeconds);
+
+        while (currentTick < target) {
+            // Level 0 has to be refilled from the levels above every 64 ticks
+            std::int64_t boundary = (currentTick | (slotCount - 1)) + 1;
+            std::int64_t limit = std::min(target, boundary);
+
+            std::int64_t next = nextOccupiedTick(limit);
+            currentTick = next;
+
+            if (currentTick == boundary) {
+                cascade();
+            }
+            fireSlot(static_cast<int>(currentTick & (slotCount - 1)), onExpire);
+        }
+    }
+
+    void advance(float deltaTime) {
+        advance(deltaTime, [](TimerHandle, std::uint32_t) {});
+    }
+
+    void clear() {
+        nodes.clear();
+        freeList = -1;
+        pendingCount = 0;
+        pausedCount = 0;
+        for (int level = 0; level < levelCount; ++level) {
+            occupied[level] = 0;
+            for (int slot = 0; slot < slotCount; ++slot) {
+                slots[level][slot] = -1;
+            }
+        }
+    }
+
+    // Back to an empty wheel at time zero, as if newly made, but keeping the node storage
+    void reset() {
+        clear();
+        currentTick = 0;
+        elapsedTime = 0.0;
+    }
+
+    void reserve(std::size_t timerCount) { nodes.reserve(timerCount); }
+    std::size_t getHeapBytes() const { return nodes.capacity() * sizeof(Node); }
+
+    std::size_t getPendingCount() const { return pendingCount + pausedCount; }
+    double getTime() const { return elapsedTime; }
+
+    // Snapshots: the wheel's fields, then its node array. Handles taken before a save stay valid
+    // after the matching restore.
+    std::size_t getNodeCount() const { return nodes.size(); }
+
+    static std::size_t getSnapshotSize(std::size_t nodeCount) {
+        return sizeof(Fields) + nodeCount * sizeof(Node);
+    }
+
+    std::uint8_t* save(std::uint8_t* out) const {
+        Fields fields = {};
+        fields.currentTick = currentTick;
+        fields.elapsedTime = elapsedTime;
+        fields.freeList = freeList;
+        fields.pendingCount = static_cast<std::uint32_t>(pendingCount);
+        fields.pausedCount = static_cast<std::uint32_t>(pausedCount);
+        std::memcpy(fields.slots, slots, sizeof(slots));
+        std::memcpy(fields.occupied, occupied, sizeof(occupied));
+        out = writeSnapshot(out, &fields);
+        return writeSnapshot(out, nodes.data(), nodes.size());
+    }
+
+    const std::uint8_t* restore(const std::uint8_t* in, std::size_t nodeCount) {
+        Fields fields;
+        in = readSnapshot(in, &fields);
+        currentTick = fields.currentTick;
+        elapsedTime = fields.elapsedTime;
+        freeList = fields.freeList;
+        pendingCount = fields.pendingCount;
+        pausedCount = fields.pausedCount;
+        std::memcpy(slots, fields.slots, sizeof(slots));
+        std::memcpy(occupied, fields.occupied, sizeof(occupied));
+        nodes.resize(nodeCount);
+        return readSnapshot(in, nodes.data(), nodeCount);
+    }
+
+    // A restored wheel is walked through the slot heads, prev, next and the free list, so a snapshot
+    // from a file is checked first: every index in range, every scheduled node once in the list its
+    // level and slot name, and every free node once on the free list. The walks stop after as many
+    // steps as there are nodes of their kind, so a loop fails the check instead of hanging it.
+    bool isConsistent() const {
+        if (nodes.size() >= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())) return false;
+        std::int32_t count = static_cast<std::int32_t>(nodes.size());
+
+        std::size_t scheduled = 0, paused = 0, free = 0;
+        for (const Node& node : nodes) {
+            if (node.state == NodeState::Scheduled) {
+                ++scheduled;
+            } else if (node.state == NodeState::Paused) {
+                ++paused;
+            } else if (node.state == NodeState::Free) {
+                ++free;
+            } else {
+                return false;   // Firing and Cancelled only exist inside advance()
+            }
+        }
+        if (scheduled != pendingCount || paused != pausedCount || freeList < -1 || freeList >= count) return false;
+
+        std::size_t steps = 0;
+        for (int level = 0; level < levelCount; ++level) {
+            for (int slot = 0; slot < slotCount; ++slot) {
+                std::int32_t previous = -1;
+                for (std::int32_t index = slots[level][slot]; index != -1; index = nodes[index].next) {
+                    if (index < 0 || index >= count || ++steps > scheduled) return false;
+                    const Node& node = nodes[index];
+                    if (node.state != NodeState::Scheduled || node.level != level || node.slot != slot || node.prev != previous) return false;
+                    previous = index;
+                }
+                if (((occupied[level] >> slot) & 1) != (slots[level][slot] != -1 ? 1u : 0u)) return false;
+            }
+        }
+        if (steps != scheduled) return false;
+
+        steps = 0;
+        for (std::int32_t index = freeList; index != -1; index = nodes[index].next) {
+            if (index < 0 || index >= count || ++steps > free || nodes[index].state != NodeState::Free) return false;
+        }
+        return steps == free;
+    }
+
+private:
+    static constexpr int levelBits = 6;
+    static constexpr int slotCount = 1 << levelBits;
+    static constexpr int levelCount = 4;
+    static constexpr float tickSeconds = 0.001f;
+    static constexpr std::int64_t maxDelta = (std::int64_t(1) << (levelBits * levelCount)) - 1;
+
+    enum class NodeState : std::uint8_t {
+        Free,
+        Scheduled,
+        Paused,
+        Firing,
+        Cancelled
+    };
+
+    struct Node {
+        std::int64_t due;               // Absolute tick, or remaining ticks while paused
+        std::uint32_t event;
+        std::uint32_t generation;
+        std::int32_t prev;
+        std::int32_t next;
+        std::uint8_t level;
+        std::uint8_t slot;
+        NodeState state;
+        std::uint8_t reserved[5];
+    };
+
+    struct Fields {
+        std::int64_t currentTick;
+        double elapsedTime;
+        std::int32_t freeList;
+        std::uint32_t pendingCount;
+        std::uint32_t pausedCount;
+        std::uint32_t reserved;
+        std::int32_t slots[levelCount][slotCount];
+        std::uint64_t occupied[levelCount];
+
+        static constexpr bool hasNoPadding() {
+            return sizeof(Fields) == 2 * sizeof(std::int64_t) + 4 * sizeof(std::int32_t) + sizeof(slots) + sizeof(occupied);
+        }
+    };
+
+    static std::int64_t toTicks(float delay) {
+        // At least one tick, so a timer re-armed from its own handler cannot fire twice in one tick
+        return std::max<std::int64_t>(1, static_cast<std::int64_t>(std::lround(delay / tickSeconds)));
+    }
+
+    static int lowestBit(std::uint64_t value) {
+        int bit = 0;
+        while (!(value & 1)) {
+            value >>= 1;
+            ++bit;
+        }
+        return bit;
+    }
+
+    bool isValid(TimerHandle handle) const {
+        return handle.generation != 0 && handle.index < nodes.size() && nodes[handle.index].generation == handle.generation &&
+               nodes[handle.index].state != NodeState::Free;
+    }
+
+    std::int32_t allocateNode() {
+        std::int32_t index;
+        if (freeList >= 0) {
+            index = freeList;
+            freeList = nodes[index].next;
+        } else {
+            index = static_cast<std::int32_t>(nodes.size());
+            nodes.push_back(Node());
+            nodes[index].generation = 0;
+        }
+        nodes[index].generation++;
+        if (nodes[index].generation == 0) nodes[index].generation = 1;
+        nodes[index].prev = -1;
+        nodes[index].next = -1;
+        return index;
+    }
+
+    void releaseNode(std::int32_t index) {
+        Node& node = nodes[index];
+        node.state = NodeState::Free;
+        node.generation++;
+        node.next = freeList;
+        freeList = index;
+    }
+
+    // Place a node in the lowest level whose span covers its distance from now
+    void insert(std::int32_t index) {
+        Node& node = nodes[index];
+        std::int64_t delta = std::min(std::max<std::int64_t>(node.due - currentTick, 0), maxDelta);
+        std::int64_t due = currentTick + delta;
+
+        int level = 0;
+        while (level < levelCount - 1 && delta >= (std::int64_t(1) << (levelBits * (level + 1)))) {
+            ++level;
+        }
+        int slot = static_cast<int>((due >> (levelBits * level)) & (slotCount - 1));
+
+        node.level = static_cast<std::uint8_t>(level);
+        node.slot = static_cast<std::uint8_t>(slot);
+        node.state = NodeState::Scheduled;
+        node.prev = -1;
+        node.next = slots[level][slot];
+        if (node.next >= 0) nodes[node.next].prev = index;
+        slots[level][slot] = index;
+        occupied[level] |= std::uint64_t(1) << slot;
+        ++pendingCount;
+    }
+
+    void unlink(std::int32_t index) {
+        Node& node = nodes[index];
+        if (node.prev >= 0) {
+            nodes[node.prev].next = node.next;
+        } else {
+            slots[node.level][node.slot] = node.next;
+        }
+        if (node.next >= 0) nodes[node.next].prev = node.prev;
+        if (slots[node.level][node.slot] < 0) {
+            occupied[node.level] &= ~(std::uint64_t(1) << node.slot);
+        }
+        node.prev = -1;
+        node.next = -1;
+        --pendingCount;
+    }
+
+    // First tick in (currentTick, limit] with a level-0 timer, or limit if there is none
+    std::int64_t nextOccupiedTick(std::int64_t limit) const {
+        int first = static_cast<int>((currentTick + 1) & (slotCount - 1));
+        std::uint64_t candidates = first == 0 ? occupied[0] : occupied[0] & (~std::uint64_t(0) << first);
+        if (!candidates) return limit;
+
+        // No wrap-around here: limit never crosses the next 64-tick boundary
+        std::int64_t tick = (currentTick & ~std::int64_t(slotCount - 1)) + lowestBit(candidates);
+        if (first == 0) tick += slotCount;
+        return std::min(tick, limit);
+    }
+
+    // On a 64-tick boundary, pull the due slot of each higher level down, highest first
+    void cascade() {
+        int top = 1;
+        while (top < levelCount - 1 && ((currentTick >> (levelBits * top)) & (slotCount - 1)) == 0) {
+            ++top;
+        }
+        for (int level = top; level >= 1; --level) {
+            int slot = static_cast<int>((currentTick >> (levelBits * level)) & (slotCount - 1));
+            while (slots[level][slot] >= 0) {
+                std::int32_t index = slots[level][slot];
+                unlink(index);
+                insert(index);
+            }
+        }
+    }
+
+    template <typename Handler>
+    void fireSlot(int slot, Handler& onExpire) {
+        while (slots[0][slot] >= 0) {
+            std::int32_t index = slots[0][slot];
+            unlink(index);
+
+            // The handler may schedule timers and grow the node array, so nodes are re-read after it
+            nodes[index].state = NodeState::Firing;
+            onExpire(TimerHandle{ static_cast<std::uint32_t>(index), nodes[index].generation }, nodes[index].event);
+
+            // Unless the handler re-armed it, the timer is done
+            Node& node = nodes[index];
+            if (node.state == NodeState::Firing || node.state == NodeState::Cancelled) {
+                releaseNode(index);
+            }
+        }
+    }
+
+    std::int64_t currentTick;
+    double elapsedTime;
+    std::vector<Node> nodes;
+    std::int32_t freeList;
+    std::size_t pendingCount;
+    std::size_t pausedCount;
+    std::int32_t slots[levelCount][slotCount];
+    std::uint64_t occupied[levelCount];
+};
+
+// Shapes - every kind of body the simulation moves, with the texture, scale and rotation it is
+// drawn with. Bounds and collision masks are baked from the source images, so the simulation
+// needs no window or GPU textures.
+enum class ShapeId : std::uint8_t {
+    Player,
+    BasicEnemy,
+    FastEnemy,
+    TankyEnemy,
+    Boss,
+    Bullet,
+    RoundBullet,
+    LongBullet,
+    BossBullet,
+    Shield,
+    HealthPowerUp,
+    ShieldPowerUp,
+    UpgradePowerUp,
+    ScoreBoostPowerUp,
+    Count
+};
+
+struct ShapeDef {
+    TextureId texture;
+    float scale;
+    float rotation;
+};
+
+constexpr ShapeDef shapeTable[] = {
+    { TextureId::Player,     0.5f, 0.0f },
+    { TextureId::BasicEnemy, 0.5f, 180.0f },    // Enemies are flipped to face down
+    { TextureId::FastEnemy,  0.5f, 180.0f },
+    { TextureId::TankyEnemy, 0.5f, 180.0f },
+    { TextureId::Boss,       1.0f, 180.0f },
+    { TextureId::Bullet,      0.5f, 0.0f },
+    { TextureId::RoundBullet, 0.5f, 0.0f },
+    { TextureId::LongBullet,  0.5f, 0.0f },
+    { TextureId::LongBullet,  0.5f, 180.0f },
+    { TextureId::Shield,      1.2f, 0.0f },
+    { TextureId::PowerUp,     0.5f, 0.0f },
+    { TextureId::Shield,      0.5f, 0.0f },
+    { TextureId::LongBullet,  0.5f, 0.0f },
+    { TextureId::PowerUp,     0.5f, 0.0f }
+};
+
+constexpr std::size_t shapeCount = static_cast<std::size_t>(ShapeId::Count);
+static_assert(sizeof(shapeTable) / sizeof(shapeTable[0]) == shapeCount, "shape table must match ShapeId");
+
+inline const ShapeDef& getShapeDef(ShapeId id) {
+    return shapeTable[static_cast<std::size_t>(id)];
+}
+
+// Shape table - size and collision mask of every shape, baked on first use and shared by every
+// simulation instance
+class ShapeTable {
+public:
+    struct Shape {
+        sf::Vector2f size;
+        const CollisionMask* mask;
+    };
+
+    static const Shape& get(ShapeId id) {
+        return getShapes()[static_cast<std::size_t>(id)];
+    }
+
+    // Picks up masks rebuilt (or first created) by a hot reload
+    static void refresh() {
+        getShapes() = build();
+    }
+
+private:
+    // Bounds used for images that cannot be loaded
+    static constexpr float fallbackImageSize = 64.0f;
+
+    static std::array<Shape, shapeCount> build() {
+        std::array<Shape, shapeCount> shapes;
+        for (std::size_t i = 0; i < shapeCount; ++i) {
+            const ShapeDef& def = shapeTable[i];
+            const CollisionMask* mask = CollisionMaskCache::get(def.texture, def.scale, def.scale, def.rotation);
+            shapes[i].mask = mask;
+            shapes[i].size = mask ? sf::Vector2f(static_cast<float>(mask->getWidth()), static_cast<float>(mask->getHeight()))
+                                  : sf::Vector2f(fallbackImageSize * def.scale, fallbackImageSize * def.scale);
+        }
+        return shapes;
+    }
+
+    static std::array<Shape, shapeCount>& getShapes() {
+        static std::array<Shape, shapeCount> shapes = build();
+        return shapes;
+    }
+};
+
+// Bounds of a shape centred on 'position'
+inline sf::FloatRect getShapeBounds(ShapeId id, const sf::Vector2f& position) {
+    const sf::Vector2f& size = ShapeTable::get(id).size;
+    return sf::FloatRect(position.x - size.x / 2.0f, position.y - size.y / 2.0f, size.x, size.y);
+}
+
+// Pixel-perfect collision: AABB broadphase first, then the alpha masks when both sides have one
+bool shapesCollide(ShapeId a, const sf::Vector2f& aPosition, ShapeId b, const sf::Vector2f& bPosition) {
+    sf::FloatRect bounds = getShapeBounds(a, aPosition);
+    sf::FloatRect otherBounds = getShapeBounds(b, bPosition);
+    if (!bounds.intersects(otherBounds)) {
+        return false;
+    }
+
+    const CollisionMask* mask = ShapeTable::get(a).mask;
+    const CollisionMask* otherMask = ShapeTable::get(b).mask;
+    if (!mask || !otherMask) {
+        return true;
+    }
+
+    int dx = static_cast<int>(std::floor(otherBounds.left)) - static_cast<int>(std::floor(bounds.left));
+    int dy = static_cast<int>(std::floor(otherBounds.top)) - static_cast<int>(std::floor(bounds.top));
+    return mask->overlaps(*otherMask, dx, dy);
+}
+
+// Continuous collision over one step of deltaTime seconds. Both shapes start the step at the given
+// positions and then move with their velocities, so fast movers cannot tunnel through small targets.
+bool shapesSweptCollide(ShapeId a, const sf::Vector2f& aStart, const sf::Vector2f& aVelocity,
+                        ShapeId b, const sf::Vector2f& bStart, const sf::Vector2f& bVelocity, float deltaTime) {
+    sf::FloatRect bounds = getShapeBounds(a, aStart);
+    sf::FloatRect otherBounds = getShapeBounds(b, bStart);
+
+    // Work in the other shape's frame so only the relative velocity matters
+    sf::Vector2f motion = (aVelocity - bVelocity) * deltaTime;
+
+    float enter, exit;
+    if (!sweepAABB(bounds, otherBounds, motion, enter, exit)) {
+        return false;
+    }
+
+    const CollisionMask* mask = ShapeTable::get(a).mask;
+    const CollisionMask* otherMask = ShapeTable::get(b).mask;
+    if (!mask || !otherMask) {
+        return true;
+    }
+
+    // Step through the AABB overlap window about one pixel of relative motion at a time
+    float distance = std::max(std::abs(motion.x), std::abs(motion.y)) * (exit - enter);
+    int samples = std::min(64, static_cast<int>(std::ceil(distance)) + 1);
+    int otherLeft = static_cast<int>(std::floor(otherBounds.left));
+    int otherTop = static_cast<int>(std::floor(otherBounds.top));
+
+    for (int i = 0; i < samples; ++i) {
+        float t = samples > 1 ? enter + (exit - enter) * i / (samples - 1) : enter;
+        int dx = otherLeft - static_cast<int>(std::floor(bounds.left + motion.x * t));
+        int dy = otherTop - static_cast<int>(std::floor(bounds.top + motion.y * t));
+        if (mask->overlaps(*otherMask, dx, dy)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Bullet - plain data, moved and tested by the simulation
+struct Bullet {
+    sf::Vector2f position;
+    sf::Vector2f velocity;
+    float damage;
+    ShapeId shape;
+    std::uint8_t reserved[3];
+
+    static constexpr bool hasNoPadding() {
+        return sizeof(Bullet) == 2 * sizeof(sf::Vector2f) + sizeof(float) + sizeof(ShapeId) + sizeof(reserved);
+    }
+
+    bool isOffScreen() const {
+        return position.y < 0 || position.y > 600;
+    }
+};
+
+// Bullet pool - fixed-capacity storage reused across shots so firing never allocates.
+// Removal swaps the last live bullet into the freed slot.
+class BulletPool {
+public:
+    explicit BulletPool(std::size_t capacity) : bullets(capacity), count(0) {}
+
+    // Next free bullet, or nullptr when the pool is full and the shot is dropped
+    Bullet* emit() {
+        return count < bullets.size() ? &bullets[count++] : nullptr;
+    }
+
+    void remove(std::size_t index) {
+        if (index != count - 1) {
+            bullets[index] = bullets[count - 1];
+        }
+        --count;
+    }
+
+    void clear() { count = 0; }
+    std::size_t size() const { return count; }
+    std::size_t capacity() const { return bullets.size(); }
+
+    Bullet& operator[](std::size_t index) { return bullets[index]; }
+    const Bullet& operator[](std::size_t index) const { return bullets[index]; }
+    const Bullet* data() const { return bullets.data(); }
+
+    // Set the live count directly, for restoring snapshots; grows the pool if it has to
+    Bullet* resize(std::size_t newCount) {
+        if (newCount > bullets.size()) {
+            bullets.resize(newCount);
+        }
+        count = newCount;
+        return bullets.data();
+    }
+    std::vector<Bullet>::const_iterator begin() const { return bullets.begin(); }
+    std::vector<Bullet>::const_iterator end() const { return bullets.begin() + count; }
+
+private:
+    std::vector<Bullet> bullets;
+    std::size_t count;
+};
+
+// Weapon definitions - one table row per weapon. Muzzle offsets are relative to the ship's
+// centre and angles are clockwise from straight up.
+struct Muzzle {
+    float offsetX;
+    float offsetY;
+    float angle;
+};
+
+struct WeaponDef {
+    const char* name;
+    float cooldown;
+    int projectileCount;
+    Muzzle muzzles[3];
+    float damage;
+    ShapeId projectile;
+    float projectileSpeed;
+    bool beam;
+    bool stopsAtFirstTarget;    // Beams only: the beam ends at the nearest target rather than passing through
+};
+
+constexpr WeaponDef weaponTable[] = {
+    // name      cooldown  count  muzzles                                                  damage  projectile              speed   beam   stops
+    { "Basic",   0.25f,    1,     { { 0.f, -30.f, 0.f } },                                  10.0f,  ShapeId::Bullet,        600.0f, false, false },
+    { "Double",  0.2f,     2,     { { -20.f, -20.f, 0.f }, { 20.f, -20.f, 0.f } },          15.0f,  ShapeId::RoundBullet,   600.0f, false, false },
+    { "Triple",  0.15f,    3,     { { 0.f, -30.f, 0.f }, { -25.f, -15.f, 0.f }, { 25.f, -15.f, 0.f } }, 20.0f, ShapeId::LongBullet, 600.0f, false, false },
+    { "Laser",   1.0f,     0,     {},                                                       0.0f,   ShapeId::Count,         0.0f,   true,  false }
+};
+
+constexpr std::size_t weaponCount = sizeof(weaponTable) / sizeof(weaponTable[0]);
+static_assert(weaponCount == static_cast<std::size_t>(WeaponType::Laser) + 1, "weapon table must match WeaponType");
+
+// The boss's three-way spread, aimed straight down
+constexpr WeaponDef bossWeapon = {
+    "Boss", 0.5f, 3, { { -30.f, 50.f, 180.f }, { 0.f, 50.f, 180.f }, { 30.f, 50.f, 180.f } },
+    10.0f, ShapeId::BossBullet, 300.0f, false, false
+};
+
+// Write one volley straight into the pool
+inline void emitVolley(BulletPool& pool, const WeaponDef& weapon, const sf::Vector2f& origin) {
+    for (int i = 0; i < weapon.projectileCount; ++i) {
+        Bullet* bullet = pool.emit();
+        if (!bullet) return;
+
+        const Muzzle& muzzle = weapon.muzzles[i];
+        float radians = muzzle.angle * 3.14159265f / 180.0f;
+        bullet->position = sf::Vector2f(origin.x + muzzle.offsetX, origin.y + muzzle.offsetY);
+        bullet->velocity = sf::Vector2f(std::sin(radians) * weapon.projectileSpeed, -std::cos(radians) * weapon.projectileSpeed);
+        bullet->damage = weapon.damage;
+        bullet->shape = weapon.projectile;
+    }
+}
+
+// One emitter per table row, generated at compile time; each sees its row as a constant so
+// the volley loop unrolls and the firing path never switches on the weapon type
+typedef void (*WeaponEmitter)(BulletPool& pool, const sf::Vector2f& origin);
+
+template <std::size_t Index>
+void emitWeapon(BulletPool& pool, const sf::Vector2f& origin) {
+    constexpr WeaponDef weapon = weaponTable[Index];
+    emitVolley(pool, weapon, origin);
+}
+
+template <std::size_t... Indices>
+constexpr std::array<WeaponEmitter, sizeof...(Indices)> makeWeaponEmitters(std::index_sequence<Indices...>) {
+    return {{ &emitWeapon<Indices>... }};
+}
+
+constexpr std::array<WeaponEmitter, weaponCount> weaponEmitters = makeWeaponEmitters(std::make_index_sequence<weaponCount>());
+
+// Laser - special weapon, modelled as a vertical beam segment with a width.
+// Hits come from an X-interval query and damage is applied per second of beam time.
+struct Laser {
+    static constexpr float width = 10.0f;
+    static constexpr float duration = 0.5f;
+    static constexpr float damagePerSecond = 60.0f;
+
+    float x;
+    float bottom;
+    float top;
+    float lifetime;
+    std::uint8_t weapon;        // WeaponType that fired it
+    std::uint8_t reserved[3];
+
+    static constexpr bool hasNoPadding() {
+        return sizeof(Laser) == 4 * sizeof(float) + sizeof(weapon) + sizeof(reserved);
+    }
+
+    // Advance the beam and return how many seconds of it fall inside this step
+    float update(float deltaTime) {
+        float activeTime = std::max(0.0f, std::min(deltaTime, lifetime));
+        lifetime -= deltaTime;
+        return activeTime;
+    }
+
+    bool isActive() const { return lifetime > 0; }
+    float getLeft() const { return x - width / 2.0f; }
+    float getRight() const { return x + width / 2.0f; }
+    const WeaponDef& getWeapon() const { return weaponTable[weapon]; }
+
+    // Cut the beam short at a blocking target
+    void setTop(float newTop) {
+        top = std::min(std::max(newTop, 0.0f), bottom);
+    }
+};
+
+// Enemy definitions - one row per EnemyType
+struct EnemyDef {
+    ShapeId shape;
+    float health;
+    float speed;
+    int scoreValue;
+};
+
+constexpr EnemyDef enemyTable[] = {
+    { ShapeId::BasicEnemy, 20.0f,  150.0f, 10 },     // Moves straight down
+    { ShapeId::FastEnemy,  10.0f,  250.0f, 15 },     // Faster but has less health
+    { ShapeId::TankyEnemy, 40.0f,  100.0f, 20 },     // Slower but has more health
+    { ShapeId::Boss,       500.0f, 50.0f,  500 }
+};
+
+static_assert(sizeof(enemyTable) / sizeof(enemyTable[0]) == static_cast<std::size_t>(EnemyType::Boss) + 1, "enemy table must match EnemyType");
+
+inline const EnemyDef& getEnemyDef(EnemyType type) {
+    return enemyTable[static_cast<std::size_t>(type)];
+}
+
+// Enemy - regular enemies move straight down at their type's speed
+struct Enemy {
+    sf::Vector2f position;
+    float health;
+    EnemyType type;
+
+    static constexpr bool hasNoPadding() {
+        return sizeof(Enemy) == sizeof(sf::Vector2f) + sizeof(float) + sizeof(EnemyType);
+    }
+
+    sf::Vector2f getVelocity() const { return sf::Vector2f(0.f, getEnemyDef(type).speed); }
+    bool isOffScreen() const { return position.y > 600; }
+    bool isDestroyed() const { return health <= 0; }
+};
+
+// Boss - enters from the top, then sweeps left and right, turning at the edges or after 2 seconds
+struct Boss {
+    enum class State : std::uint8_t {
+        Entering,
+        MovingLeft,
+        MovingRight
+    };
+
+    bool active;
+    State state;
+    std::uint16_t reserved;
+    sf::Vector2f position;
+    sf::Vector2f velocity;      // Velocity of the last update, so collision can rewind to the start of the step
+    float health;
+    TimerHandle turnTimer;
+    TimerHandle shootCooldown;
+
+    static constexpr bool hasNoPadding() {
+        return sizeof(Boss) == sizeof(bool) + sizeof(State) + sizeof(reserved) + 2 * sizeof(sf::Vector2f) + sizeof(float) +
+                               2 * sizeof(TimerHandle);
+    }
+};
+
+// PowerUp - drifts down until collected or off screen
+struct PowerUp {
+    static constexpr float speed = 150.0f;
+
+    sf::Vector2f position;
+    PowerUpType type;
+
+    static constexpr bool hasNoPadding() {
+        return sizeof(PowerUp) == sizeof(sf::Vector2f) + sizeof(PowerUpType);
+    }
+
+    bool isOffScreen() const { return position.y > 600; }
+};
+
+inline ShapeId getPowerUpShape(PowerUpType type) {
+    static constexpr ShapeId shapes[] = { ShapeId::HealthPowerUp, ShapeId::ShieldPowerUp, ShapeId::UpgradePowerUp, ShapeId::ScoreBoostPowerUp };
+    return shapes[static_cast<std::size_t>(type)];
+}
+
+// Player ship. The shield depletes over time, so its health is the time left on its expiry timer.
+struct Player {
+    static constexpr float speed = 300.0f;
+    static constexpr float maxShieldHealth = 100.0f;
+    static constexpr float shieldDecayPerSecond = 10.0f;
+
+    sf::Vector2f position;
+    sf::Vector2f velocity;
+    int health;
+    int score;
+    WeaponType weaponType;
+    TimerHandle shootCooldown;
+    TimerHandle shieldExpiry;
+
+    static constexpr bool hasNoPadding() {
+        return sizeof(Player) == 2 * sizeof(sf::Vector2f) + 2 * sizeof(int) + sizeof(WeaponType) + 2 * sizeof(TimerHandle);
+    }
+
+    const WeaponDef& getWeapon() const { return weaponTable[static_cast<std::size_t>(weaponType)]; }
+};
+
+// Broadphase - enemy bounds sorted by their left edge, so X-interval queries only touch
+// entries that can overlap instead of every enemy
+class Broadphase {
+public:
+    struct Entry {
+        sf::FloatRect bounds;
+        std::size_t index;
+    };
+
+    Broadphase() : maxWidth(0.0f) {}
+
+    void build(const std::vector<Enemy>& enemies) {
+        entries.clear();
+        maxWidth = 0.0f;
+        for (std::size_t i = 0; i < enemies.size(); ++i) {
+            sf::FloatRect bounds = getShapeBounds(getEnemyDef(enemies[i].type).shape, enemies[i].position);
+            entries.push_back({ bounds, i });
+            maxWidth = std::max(maxWidth, bounds.width);
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.bounds.left < b.bounds.left;
+        });
+    }
+
+    // Append every entry whose horizontal extent overlaps (left, right)
+    void queryX(float left, float right, std::vector<const Entry*>& result) const {
+        // Nothing that starts further left than the widest entry can still reach 'left'
+        auto it = std::lower_bound(entries.begin(), entries.end(), left - maxWidth, [](const Entry& entry, float value) {
+            return entry.bounds.left < value;
+        });
+        for (; it != entries.end() && it->bounds.left < right; ++it) {
+            if (it->bounds.left + it->bounds.width > left) {
+                result.push_back(&*it);
+            }
+        }
+    }
+
+    void reserve(std::size_t count) { entries.reserve(count); }
+    std::size_t getHeapBytes() const { return entries.capacity() * sizeof(Entry); }
+
+private:
+    std::vector<Entry> entries;
+    float maxWidth;
+};
+
+// Level system
+class Level {
+public:
+    Level() : currentLevel(1), enemiesDefeated(0), bossSpawned(false), reserved() {}
+
+    void update(int defeatedEnemies) {
+        enemiesDefeated += defeatedEnemies;
+        
+        // Level up after defeating certain number of enemies
+        if (enemiesDefeated >= getEnemiesForNextLevel() && !bossSpawned) {
+            currentLevel++;
+            enemiesDefeated = 0;
+            bossSpawned = true;
+        }
+    }
+
+    int getCurrentLevel() const { return currentLevel; }
+    int getEnemiesDefeated() const { return enemiesDefeated; }
+    bool isBossLevel() const { return bossSpawned; }
+    void resetBossFlag() { bossSpawned = false; }
+    bool isValid() const { return currentLevel >= 1 && enemiesDefeated >= 0 && isValidSnapshotBool(bossSpawned); }
+    
+    float getEnemySpawnInterval() const {
+        return std::max(1.5f - (currentLevel - 1) * 0.1f, 0.5f);
+    }
+    
+    float getPowerUpSpawnInterval() const {
+        return std::max(10.0f - (currentLevel - 1) * 0.5f, 5.0f);
+    }
+    
+    int getEnemiesForNextLevel() const {
+        return 20 + (currentLevel - 1) * 5;
+    }
+    
+    void reset() {
+        currentLevel = 1;
+        enemiesDefeated = 0;
+        bossSpawned = false;
+    }
+
+private:
+    int currentLevel;
+    int enemiesDefeated;
+    bool bossSpawned;
+    std::uint8_t reserved[3];
+};
+
+// Small deterministic random stream (xorshift64*). It is plain data, so it is saved and restored
+// along with the simulation that owns it.
+class SimRandom {
+public:
+    explicit SimRandom(std::uint64_t seed = 1) {
+        reseed(seed);
+    }
+
+    void reseed(std::uint64_t seed) {
+        // splitmix64 spreads nearby seeds apart and never leaves the state at zero
+        std::uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        state = (z ^ (z >> 31)) | 1;
+    }
+
+    std::uint32_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return static_cast<std::uint32_t>((state * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+
+    // Uniform enough in [0, range) for spawn rolls
+    int nextInt(int range) {
+        return static_cast<int>(next() % static_cast<std::uint32_t>(range));
+    }
+
+private:
+    std::uint64_t state;
+};
+
+// Simulation - the game rules on plain data at a fixed 60 Hz tick. A step reads nothing but its
+// input bits and the simulation's own seeded random stream, so the same seed and inputs always
+// play out the same game, with or without a window. Sounds and explosions are reported as events
+// for the caller to present. Up to two players can share a game; in co-op the score is the team's
+// and is kept by the first player, and the game is over once every player is down.
+class Simulation {
+public:
+    static constexpr float tickSeconds = 1.0f / 60.0f;
+    static constexpr int maxPlayers = 2;
+
+    // Input bits for one tick
+    enum Input : std::uint8_t {
+        InputLeft = 1 << 0,
+        InputRight = 1 << 1,
+        InputUp = 1 << 2,
+        InputDown = 1 << 3,
+        InputFire = 1 << 4
+    };
+
+    struct Event {
+        enum class Type : std::uint8_t {
+            Sound,
+            Explosion
+        };
+
+        Type type;
+        SoundId sound;
+        sf::Vector2f position;
+        float scale;
+    };
+
+    // Snapshots are one flat blob: this header, the fixed-size state, the timer wheel, then the
+    // player bullets, enemy bullets, lasers, enemies and power-ups as plain arrays. The version
+    // changes whenever any of those layouts does. Snapshots of the same state are byte-identical,
+    // so every type in them spells out its padding as zeroed 'reserved' members.
+    struct SnapshotHeader {
+        static constexpr std::uint32_t magic = 0x4E535353;     // "SSSN"
+        static constexpr std::uint32_t version = 4;
+
+        std::uint32_t snapshotMagic;
+        std::uint32_t snapshotVersion;
+        std::uint32_t size;             // Bytes in the whole snapshot, header included
+        std::uint32_t timerNodeCount;
+        std::uint32_t bulletCount;
+        std::uint32_t enemyBulletCount;
+        std::uint32_t laserCount;
+        std::uint32_t enemyCount;
+        std::uint32_t powerupCount;
+        std::uint32_t reserved;
+    };
+
+    Simulation() : state(GameState::GameOver), tick(0), playerCount(1), bullets(512), enemyBullets(256), bossWarningVisible(false) {
+        players.fill(Player());
+        boss = Boss();
+    }
+
+    // Start a new game; the seed decides every spawn
+    void reset(std::uint64_t seed, int count = 1) {
+        state = GameState::Playing;
+        tick = 0;
+        random.reseed(seed);
+
+        // A fresh wheel, so timing never depends on what ran before the reset
+        timers.reset();
+
+        // Side by side in co-op
+        playerCount = static_cast<std::uint32_t>(std::min(std::max(count, 1), maxPlayers));
+        players.fill(Player());
+        for (std::uint32_t i = 0; i < playerCount; ++i) {
+            Player& player = players[i];
+            player.position = sf::Vector2f(playerCount == 1 ? 400.f : 300.f + 200.f * i, 550.f);
+            player.health = 100;
+            player.score = 0;
+            player.weaponType = WeaponType::Basic;
+        }
+
+        bullets.clear();
+        enemyBullets.clear();
+        lasers.clear();
+        enemies.clear();
+        powerups.clear();
+        boss = Boss();
+        events.clear();
+
+        level.reset();
+        bossWarningVisible = false;
+        // A handle left from the last game could name a timer of the new wheel
+        bossWarningTimer = TimerHandle();
+        enemySpawnTimer = timers.schedule(level.getEnemySpawnInterval(), static_cast<std::uint32_t>(TimerEvent::EnemySpawn));
+        powerupSpawnTimer = timers.schedule(level.getPowerUpSpawnInterval(), static_cast<std::uint32_t>(TimerEvent::PowerUpSpawn));
+    }
+
+    // Room for 'enemyCount' enemies and everything else that grows during a game, so a host
+    // keeping many simulations alive allocates once up front rather than mid-game
+    void reserve(std::size_t enemyCount) {
+        enemies.reserve(enemyCount);
+        enemyBroadphase.reserve(enemyCount);
+        laserHits.reserve(enemyCount);
+        bulletHits.reserve(enemyCount);
+        enemiesKilled.reserve(enemyCount);
+        lasers.reserve(8);
+        powerups.reserve(16);
+        events.reserve(64);
+        timers.reserve(32);
+    }
+
+    // Heap memory held by the simulation's lists and pools, used or not
+    std::size_t getHeapBytes() const {
+        return (bullets.capacity() + enemyBullets.capacity()) * sizeof(Bullet) + lasers.capacity() * sizeof(Laser) +
+               enemies.capacity() * sizeof(Enemy) + powerups.capacity() * sizeof(PowerUp) + events.capacity() * sizeof(Event) +
+               timers.getHeapBytes() + enemyBroadphase.getHeapBytes() +
+               (laserHits.capacity() + bulletHits.capacity()) * sizeof(const Broadphase::Entry*) + enemiesKilled.capacity();
+    }
+
+    // Advance one tick; does nothing once the game is over
+    void step(std::uint8_t input) {
+        std::uint8_t inputs[maxPlayers] = { input };
+        step(inputs);
+    }
+
+    // One input byte per player, in player order
+    void step(const std::uint8_t* inputs) {
+        events.clear();
+        if (state != GameState::Playing && state != GameState::BossFight) {
+            return;
+        }
+        ++tick;
+
+        // Fire cooldowns, spawn timers, the shield expiry and boss state changes
+        timers.advance(tickSeconds, [this](TimerHandle handle, std::uint32_t event) {
+            onTimer(handle, static_cast<TimerEvent>(event));
+        });
+
+        for (std::uint32_t i = 0; i < playerCount; ++i) {
+            Player& player = players[i];
+            if (player.health <= 0) continue;
+            updatePlayer(player, inputs[i]);
+            if (inputs[i] & InputFire) {
+                fire(player);
+            }
+        }
+
+        if (state == GameState::Playing) {
+            updateBullets();
+            updateLasers();
+            updateEnemies();
+            updatePowerUps();
+
+            // Check if it's time to spawn a boss
+            if (state == GameState::Playing && level.isBossLevel()) {
+                startBossFight();
+            }
+        } else {
+            updateBoss();
+            updateBullets();
+            updateEnemyBullets();
+            updateLasers();
+        }
+    }
+
+    GameState getState() const { return state; }
+    std::uint64_t getTick() const { return tick; }
+    int getPlayerCount() const { return static_cast<int>(playerCount); }
+    const Player& getPlayer(int index = 0) const { return players[index]; }
+    bool hasShield(int index = 0) const { return timers.isPending(players[index].shieldExpiry); }
+    float getShieldHealth(int index = 0) const { return timers.getRemaining(players[index].shieldExpiry) * Player::shieldDecayPerSecond; }
+    bool canShoot(int index = 0) const { return !timers.isPending(players[index].shootCooldown); }
+    const BulletPool& getBullets() const { return bullets; }
+    const BulletPool& getEnemyBullets() const { return enemyBullets; }
+    const std::vector<Laser>& getLasers() const { return lasers; }
+    const std::vector<Enemy>& getEnemies() const { return enemies; }
+    const std::vector<PowerUp>& getPowerUps() const { return powerups; }
+    const Boss& getBoss() const { return boss; }
+    const Level& getLevel() const { return level; }
+    bool isBossWarningVisible() const { return bossWarningVisible; }
+
+    // Sounds and explosions of the last step
+    const std::vector<Event>& getEvents() const { return events; }
+
+    std::size_t getSnapshotSize() const {
+        return makeSnapshotHeader().size;
+    }
+
+    // Writes getSnapshotSize() bytes; the events of the last step are not part of the state
+    void save(std::uint8_t* out) const {
+        SnapshotHeader header = makeSnapshotHeader();
+        out = writeSnapshot(out, &header);
+        visitSnapshotFields([&](auto field) { out = writeSnapshot(out, &(this->*field)); });
+        out = timers.save(out);
+        out = writeSnapshot(out, bullets.data(), bullets.size());
+        out = writeSnapshot(out, enemyBullets.data(), enemyBullets.size());
+        out = writeSnapshot(out, lasers.data(), lasers.size());
+        out = writeSnapshot(out, enemies.data(), enemies.size());
+        writeSnapshot(out, powerups.data(), powerups.size());
+    }
+
+    // Reuses the vector's memory, so saving into the same one every tick does not allocate
+    void save(std::vector<std::uint8_t>& out) const {
+        out.resize(getSnapshotSize());
+        save(out.data());
+    }
+
+    // Replace the whole state with a snapshot from save(). Returns false, leaving the simulation
+    // as it was, unless 'data' is a complete snapshot of this version; beyond that the contents
+    // are trusted.
+    bool restore(const std::uint8_t* data, std::size_t size) {
+        SnapshotHeader header;
+        if (!readSnapshotHeader(data, size, header)) {
+            return false;
+        }
+
+        const std::uint8_t* in = data + sizeof(SnapshotHeader);
+        visitSnapshotFields([&](auto field) { in = readSnapshot(in, &(this->*field)); });
+        in = timers.restore(in, header.timerNodeCount);
+        in = readSnapshot(in, bullets.resize(header.bulletCount), header.bulletCount);
+        in = readSnapshot(in, enemyBullets.resize(header.enemyBulletCount), header.enemyBulletCount);
+        lasers.resize(header.laserCount);
+        in = readSnapshot(in, lasers.data(), lasers.size());
+        enemies.resize(header.enemyCount);
+        in = readSnapshot(in, enemies.data(), enemies.size());
+        powerups.resize(header.powerupCount);
+        readSnapshot(in, powerups.data(), powerups.size());
+
+        events.clear();
+
+        // Keyframes come from files, so nothing they hold may index past a table; a rejected snapshot
+        // leaves a finished, empty game rather than the half-copied one
+        if (!isValidRestore()) {
+            reset(0);
+            state = GameState::GameOver;
+            return false;
+        }
+        return true;
+    }
+
+    bool restore(const std::vector<std::uint8_t>& snapshot) {
+        return restore(snapshot.data(), snapshot.size());
+    }
+
+    // Hash of the whole snapshot, for checking that two runs ended in exactly the same state
+    std::uint64_t getStateHash() const {
+        std::vector<std::uint8_t> snapshot;
+        save(snapshot);
+        return hashBytes(snapshot.data(), snapshot.size());
+    }
+
+    // Checks the magic, version and that the array lengths add up to exactly 'size'
+    static bool readSnapshotHeader(const std::uint8_t* data, std::size_t size, SnapshotHeader& header) {
+        if (size < sizeof(SnapshotHeader)) {
+            return false;
+        }
+        readSnapshot(data, &header);
+        return header.snapshotMagic == SnapshotHeader::magic && header.snapshotVersion == SnapshotHeader::version &&
+               header.size == size && getSnapshotSize(header) == size;
+    }
+
+private:
+    // Every restored value that selects a table row, an array entry or a timer node
+    bool isValidRestore() const {
+        if (static_cast<std::size_t>(state) > static_cast<std::size_t>(GameState::Victory) || playerCount < 1 ||
+            playerCount > static_cast<std::uint32_t>(maxPlayers) || !level.isValid() || !isValidSnapshotBool(bossWarningVisible) ||
+            !isValidSnapshotBool(boss.active) || static_cast<std::size_t>(boss.state) > static_cast<std::size_t>(Boss::State::MovingRight)) {
+            return false;
+        }
+        for (const Player& player : players) {
+            if (static_cast<std::size_t>(player.weaponType) >= weaponCount) return false;
+        }
+        for (const BulletPool* pool : { &bullets, &enemyBullets }) {
+            for (const Bullet& bullet : *pool) {
+                if (static_cast<std::size_t>(bullet.shape) >= shapeCount) return false;
+            }
+        }
+        for (const Laser& laser : lasers) {
+            if (laser.weapon >= weaponCount || !laser.getWeapon().beam) return false;
+        }
+        for (const Enemy& enemy : enemies) {
+            if (static_cast<std::size_t>(enemy.type) > static_cast<std::size_t>(EnemyType::Boss)) return false;
+        }
+        for (const PowerUp& powerup : powerups) {
+            if (static_cast<std::size_t>(powerup.type) > static_cast<std::size_t>(PowerUpType::ScoreBoost)) return false;
+        }
+        return timers.isConsistent();
+    }
+
+    // Every fixed-size field a snapshot holds, as member pointers in snapshot order
+    template <typename Visit>
+    static void visitSnapshotFields(Visit&& visit) {
+        visit(&Simulation::state);
+        visit(&Simulation::tick);
+        visit(&Simulation::random);
+        visit(&Simulation::level);
+        visit(&Simulation::playerCount);
+        visit(&Simulation::players);
+        visit(&Simulation::boss);
+        visit(&Simulation::enemySpawnTimer);
+        visit(&Simulation::powerupSpawnTimer);
+        visit(&Simulation::bossWarningTimer);
+        visit(&Simulation::bossWarningVisible);
+    }
+
+    static std::size_t getSnapshotSize(const SnapshotHeader& header) {
+        std::size_t size = sizeof(SnapshotHeader);
+        visitSnapshotFields([&](auto field) { size += sizeof(std::declval<Simulation&>().*field); });
+        return size + TimerWheel::getSnapshotSize(header.timerNodeCount) +
+               (static_cast<std::size_t>(header.bulletCount) + header.enemyBulletCount) * sizeof(Bullet) +
+               header.laserCount * sizeof(Laser) + header.enemyCount * sizeof(Enemy) + header.powerupCount * sizeof(PowerUp);
+    }
+
+    SnapshotHeader makeSnapshotHeader() const {
+        SnapshotHeader header = {};
+        header.snapshotMagic = SnapshotHeader::magic;
+        header.snapshotVersion = SnapshotHeader::version;
+        header.timerNodeCount = static_cast<std::uint32_t>(timers.getNodeCount());
+        header.bulletCount = static_cast<std::uint32_t>(bullets.size());
+        header.enemyBulletCount = static_cast<std::uint32_t>(enemyBullets.size());
+        header.laserCount = static_cast<std::uint32_t>(lasers.size());
+        header.enemyCount = static_cast<std::uint32_t>(enemies.size());
+        header.powerupCount = static_cast<std::uint32_t>(powerups.size());
+        header.size = static_cast<std::uint32_t>(getSnapshotSize(header));
+        return header;
+    }
+
+    enum class TimerEvent : std::uint32_t {
+        None,
+        EnemySpawn,
+        PowerUpSpawn,
+        BossTurn,
+        BossWarning
+    };
+
+    void onTimer(TimerHandle handle, TimerEvent event) {
+        switch (event) {
+            case TimerEvent::EnemySpawn:
+                spawnEnemy();
+                timers.restart(handle, level.getEnemySpawnInterval());
+                break;
+            case TimerEvent::PowerUpSpawn:
+                spawnPowerUp();
+                timers.restart(handle, level.getPowerUpSpawnInterval());
+                break;
+            case TimerEvent::BossTurn:
+                setBossState(boss.state == Boss::State::MovingLeft ? Boss::State::MovingRight : Boss::State::MovingLeft);
+                break;
+            case TimerEvent::BossWarning:
+                bossWarningVisible = false;
+                break;
+            case TimerEvent::None:
+                break;
+        }
+    }
+
+    void playSound(SoundId sound) {
+        events.push_back({ Event::Type::Sound, sound, sf::Vector2f(), 0.0f });
+    }
+
+    void explode(const sf::Vector2f& position, float scale = 1.0f) {
+        events.push_back({ Event::Type::Explosion, SoundId::Count, position, scale });
+    }
+
+    void updatePlayer(Player& player, std::uint8_t input) {
+        player.velocity = sf::Vector2f(0.f, 0.f);
+        if ((input & InputLeft) && player.position.x > 0) {
+            player.velocity.x -= Player::speed;
+        }
+        if ((input & InputRight) && player.position.x < 800) {
+            player.velocity.x += Player::speed;
+        }
+        if ((input & InputUp) && player.position.y > 0) {
+            player.velocity.y -= Player::speed;
+        }
+        if ((input & InputDown) && player.position.y < 600) {
+            player.velocity.y += Player::speed;
+        }
+        player.position += player.velocity * tickSeconds;
+    }
+
+    void fire(Player& player) {
+        if (timers.isPending(player.shootCooldown)) {
+            return;
+        }
+        const WeaponDef& weapon = player.getWeapon();
+        player.shootCooldown = timers.schedule(weapon.cooldown);
+
+        if (weapon.beam) {
+            // The beam runs from the ship's nose to the top of the screen
+            float bottom = player.position.y - 30.f;
+            lasers.push_back({ player.position.x, bottom, 0.0f, Laser::duration, static_cast<std::uint8_t>(player.weaponType), {} });
+        } else {
+            weaponEmitters[static_cast<std::size_t>(player.weaponType)](bullets, player.position);
+        }
+        playSound(SoundId::Shoot);
+    }
+
+    void damagePlayer(Player& player, int amount) {
+        // The shield soaks damage by bringing its expiry forward
+        if (timers.isPending(player.shieldExpiry)) {
+            float shieldHealth = timers.getRemaining(player.shieldExpiry) * Player::shieldDecayPerSecond - amount;
+            if (shieldHealth <= 0) {
+                timers.cancel(player.shieldExpiry);
+            } else {
+                timers.restart(player.shieldExpiry, shieldHealth / Player::shieldDecayPerSecond);
+            }
+            return;
+        }
+
+        player.health = std::max(0, player.health - amount);
+    }
+
+    bool isAnyPlayerAlive() const {
+        for (std::uint32_t i = 0; i < playerCount; ++i) {
+            if (players[i].health > 0) return true;
+        }
+        return false;
+    }
+
+    void killEnemy(const Enemy& enemy) {
+        explode(enemy.position);
+        playSound(SoundId::Explosion);
+        players[0].score += getEnemyDef(enemy.type).scoreValue;
+        level.update(1);
+    }
+
+    void updateBullets() {
+        // The boss has already moved this tick, so rewind it to where its step began
+        sf::Vector2f bossStart = boss.position - boss.velocity * tickSeconds;
+
+        // Enemies are only looked up through the broadphase, so the ones killed here stay in
+        // place, flagged, until every bullet has moved
+        if (bullets.size() > 0 && !enemies.empty()) {
+            enemyBroadphase.build(enemies);
+        }
+        enemiesKilled.assign(enemies.size(), 0);
+        bool anyKilled = false;
+
+        for (std::size_t i = 0; i < bullets.size();) {
+            Bullet& bullet = bullets[i];
+            sf::Vector2f bulletStart = bullet.position;
+            bullet.position += bullet.velocity * tickSeconds;
+
+            bool bulletRemoved = false;
+
+            // Check collision with enemies; they move after bullets, so their step starts where they are now.
+            // Candidates overlap the bullet's path with a pixel to spare and are tried in enemy order,
+            // so the bullet hits the same enemy as when it was tested against all of them.
+            if (!enemies.empty()) {
+                sf::FloatRect bounds = getShapeBounds(bullet.shape, bulletStart);
+                sf::Vector2f motion = bullet.velocity * tickSeconds;
+                float left = bounds.left + std::min(motion.x, 0.0f) - 1.0f;
+                float right = bounds.left + bounds.width + std::max(motion.x, 0.0f) + 1.0f;
+                float top = bounds.top + std::min(motion.y, 0.0f) - 1.0f;
+                float bottom = bounds.top + bounds.height + std::max(motion.y, 0.0f) + 1.0f;
+
+                bulletHits.clear();
+                enemyBroadphase.queryX(left, right, bulletHits);
+                bulletHits.erase(std::remove_if(bulletHits.begin(), bulletHits.end(), [&](const Broadphase::Entry* entry) {
+                    float fall = enemies[entry->index].getVelocity().y * tickSeconds;
+                    return enemiesKilled[entry->index] || entry->bounds.top + std::min(fall, 0.0f) >= bottom ||
+                           entry->bounds.top + entry->bounds.height + std::max(fall, 0.0f) <= top;
+                }), bulletHits.end());
+                std::sort(bulletHits.begin(), bulletHits.end(), [](const Broadphase::Entry* a, const Broadphase::Entry* b) {
+                    return a->index < b->index;
+                });
+
+                for (const Broadphase::Entry* entry : bulletHits) {
+                    Enemy& enemy = enemies[entry->index];
+                    if (!shapesSweptCollide(bullet.shape, bulletStart, bullet.velocity, getEnemyDef(enemy.type).shape,
+                                            enemy.position, enemy.getVelocity(), tickSeconds)) {
+                        continue;
+                    }
+                    enemy.health -= bullet.damage;
+                    if (enemy.isDestroyed()) {
+                        killEnemy(enemy);
+                        enemiesKilled[entry->index] = 1;
+                        anyKilled = true;
+                    }
+
+                    // Remove bullet; the last live bullet moves into this slot
+                    bullets.remove(i);
+                    bulletRemoved = true;
+                    break;
+                }
+            }
+
+            // Check collision with boss
+            if (!bulletRemoved && boss.active &&
+                shapesSweptCollide(bullet.shape, bulletStart, bullet.velocity, ShapeId::Boss, bossStart, boss.velocity, tickSeconds)) {
+                boss.health -= bullet.damage;
+                bullets.remove(i);
+                bulletRemoved = true;
+            }
+
+            // Remove off-screen bullets
+            if (!bulletRemoved) {
+                if (bullet.isOffScreen()) {
+                    bullets.remove(i);
+                } else {
+                    ++i;
+                }
+            }
+        }
+
+        if (anyKilled) {
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < enemies.size(); ++i) {
+                if (!enemiesKilled[i]) {
+                    enemies[kept++] = enemies[i];
+                }
+            }
+            enemies.resize(kept);
+        }
+    }
+
+    void updateEnemyBullets() {
+        sf::Vector2f playerStarts[maxPlayers];
+        for (std::uint32_t p = 0; p < playerCount; ++p) {
+            playerStarts[p] = players[p].position - players[p].velocity * tickSeconds;
+        }
+
+        for (std::size_t i = 0; i < enemyBullets.size();) {
+            Bullet& bullet = enemyBullets[i];
+            sf::Vector2f bulletStart = bullet.position;
+            bullet.position += bullet.velocity * tickSeconds;
+
+            // Check collision with the players, swept over the whole step; a bullet hits one at most
+            Player* hit = nullptr;
+            for (std::uint32_t p = 0; p < playerCount && !hit; ++p) {
+                if (players[p].health > 0 && shapesSweptCollide(bullet.shape, bulletStart, bullet.velocity, ShapeId::Player,
+                                                                 playerStarts[p], players[p].velocity, tickSeconds)) {
+                    hit = &players[p];
+                }
+            }
+            if (hit) {
+                damagePlayer(*hit, 10);
+                enemyBullets.remove(i);
+
+                if (hit->health <= 0 && state != GameState::GameOver) {
+                    if (!isAnyPlayerAlive()) {
+                        state = GameState::GameOver;
+                    }
+                    explode(hit->position);
+                    playSound(SoundId::Explosion);
+                }
+            } else if (bullet.isOffScreen()) {
+                enemyBullets.remove(i);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    void updateLasers() {
+        if (lasers.empty()) {
+            return;
+        }
+
+        // Enemy bounds are gathered once per tick and shared by every beam
+        enemyBroadphase.build(enemies);
+
+        for (auto it = lasers.begin(); it != lasers.end();) {
+            float damage = Laser::damagePerSecond * it->update(tickSeconds);
+
+            // Candidates overlap the beam horizontally and sit above its bottom end
+            laserHits.clear();
+            enemyBroadphase.queryX(it->getLeft(), it->getRight(), laserHits);
+            laserHits.erase(std::remove_if(laserHits.begin(), laserHits.end(), [&](const Broadphase::Entry* entry) {
+                return entry->bounds.top >= it->bottom || entry->bounds.top + entry->bounds.height <= 0.0f;
+            }), laserHits.end());
+
+            // The boss counts once it is on screen, like the enemies
+            sf::FloatRect bossBounds = boss.active ? getShapeBounds(ShapeId::Boss, boss.position) : sf::FloatRect();
+            bool bossHit = boss.active && bossBounds.left < it->getRight() && bossBounds.left + bossBounds.width > it->getLeft() &&
+                           bossBounds.top < it->bottom && bossBounds.top + bossBounds.height > 0.0f;
+
+            if (it->getWeapon().stopsAtFirstTarget) {
+                // Only the target nearest the ship takes damage, and the beam ends at it
+                const Broadphase::Entry* nearest = nullptr;
+                for (const Broadphase::Entry* entry : laserHits) {
+                    if (!nearest || entry->bounds.top + entry->bounds.height > nearest->bounds.top + nearest->bounds.height) {
+                        nearest = entry;
+                    }
+                }
+
+                float nearestBottom = nearest ? nearest->bounds.top + nearest->bounds.height : 0.0f;
+                if (bossHit && bossBounds.top + bossBounds.height > nearestBottom) {
+                    nearest = nullptr;
+                    nearestBottom = bossBounds.top + bossBounds.height;
+                } else {
+                    bossHit = false;
+                }
+
+                laserHits.clear();
+                if (nearest) laserHits.push_back(nearest);
+                it->setTop(nearestBottom);
+            }
+
+            for (const Broadphase::Entry* entry : laserHits) {
+                enemies[entry->index].health -= damage;
+            }
+            if (bossHit) {
+                boss.health -= damage;
+            }
+
+            // Remove inactive lasers
+            if (!it->isActive()) {
+                it = lasers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // Destroyed enemies are removed after all beams so broadphase indices stay valid
+        for (auto enemyIt = enemies.begin(); enemyIt != enemies.end();) {
+            if (enemyIt->isDestroyed()) {
+                killEnemy(*enemyIt);
+                enemyIt = enemies.erase(enemyIt);
+            } else {
+                ++enemyIt;
+            }
+        }
+    }
+
+    void updateEnemies() {
+        sf::Vector2f playerStarts[maxPlayers];
+        for (std::uint32_t p = 0; p < playerCount; ++p) {
+            playerStarts[p] = players[p].position - players[p].velocity * tickSeconds;
+        }
+
+        for (auto it = enemies.begin(); it != enemies.end();) {
+            sf::Vector2f enemyStart = it->position;
+            it->position += it->getVelocity() * tickSeconds;
+
+            // Check collision with the players
+            Player* hit = nullptr;
+            for (std::uint32_t p = 0; p < playerCount && !hit; ++p) {
+                if (players[p].health > 0 && shapesSweptCollide(getEnemyDef(it->type).shape, enemyStart, it->getVelocity(), ShapeId::Player,
+                                                                 playerStarts[p], players[p].velocity, tickSeconds)) {
+                    hit = &players[p];
+                }
+            }
+            if (hit) {
+                // Player hit by enemy
+                damagePlayer(*hit, 25);
+                playSound(SoundId::Explosion);
+                explode(it->position);
+                it = enemies.erase(it);
+
+                if (hit->health <= 0 && state != GameState::GameOver) {
+                    if (!isAnyPlayerAlive()) {
+                        state = GameState::GameOver;
+                    }
+                    explode(hit->position);
+                }
+            }
+            // Remove off-screen enemies
+            else if (it->isOffScreen()) {
+                it = enemies.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void updatePowerUps() {
+        sf::FloatRect playerBounds[maxPlayers];
+        for (std::uint32_t p = 0; p < playerCount; ++p) {
+            playerBounds[p] = getShapeBounds(ShapeId::Player, players[p].position);
+        }
+
+        for (auto it = powerups.begin(); it != powerups.end();) {
+            it->position.y += PowerUp::speed * tickSeconds;
+
+            // Check collision with the players; the first one touching it takes it
+            sf::FloatRect bounds = getShapeBounds(getPowerUpShape(it->type), it->position);
+            Player* collector = nullptr;
+            for (std::uint32_t p = 0; p < playerCount && !collector; ++p) {
+                if (players[p].health > 0 && bounds.intersects(playerBounds[p])) {
+                    collector = &players[p];
+                }
+            }
+            if (collector) {
+                applyPowerUp(*collector, it->type);
+                it = powerups.erase(it);
+            }
+            // Remove off-screen power-ups
+            else if (it->isOffScreen()) {
+                it = powerups.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void applyPowerUp(Player& player, PowerUpType type) {
+        switch (type) {
+            case PowerUpType::Health:
+                player.health = std::min(100, player.health + 25);
+                playSound(SoundId::PowerUp);
+                break;
+
+            case PowerUpType::Shield:
+                timers.cancel(player.shieldExpiry);
+                player.shieldExpiry = timers.schedule(Player::maxShieldHealth / Player::shieldDecayPerSecond);
+                playSound(SoundId::PowerUp);
+                break;
+
+            case PowerUpType::WeaponUpgrade: {
+                std::size_t next = static_cast<std::size_t>(player.weaponType) + 1;
+                if (next < weaponCount) {
+                    player.weaponType = static_cast<WeaponType>(next);
+                } else {
+                    // Already at max level; give bonus points instead
+                    players[0].score += 50;
+                }
+                playSound(SoundId::Upgrade);
+                break;
+            }
+
+            case PowerUpType::ScoreBoost:
+                players[0].score += 50;
+                playSound(SoundId::PowerUp);
+                break;
+        }
+    }
+
+    void updateBoss() {
+        if (!boss.active) {
+            // The boss arrives on the first tick of the fight
+            const EnemyDef& def = getEnemyDef(EnemyType::Boss);
+            boss = Boss();
+            boss.active = true;
+            boss.state = Boss::State::Entering;
+            boss.position = sf::Vector2f(400.f, -50.f);
+            boss.health = def.health;
+            playSound(SoundId::Boss);
+            return;
+        }
+
+        float speed = getEnemyDef(EnemyType::Boss).speed;
+        boss.velocity = sf::Vector2f(0.f, 0.f);
+        switch (boss.state) {
+            case Boss::State::Entering:
+                // Move down to position
+                if (boss.position.y < 100) {
+                    boss.velocity.y = speed;
+                } else {
+                    setBossState(Boss::State::MovingLeft);
+                }
+                break;
+
+            case Boss::State::MovingLeft:
+                boss.velocity.x = -speed * 1.5f;
+                if (boss.position.x < 100) {
+                    setBossState(Boss::State::MovingRight);
+                }
+                break;
+
+            case Boss::State::MovingRight:
+                boss.velocity.x = speed * 1.5f;
+                if (boss.position.x > 700) {
+                    setBossState(Boss::State::MovingLeft);
+                }
+                break;
+        }
+        boss.position += boss.velocity * tickSeconds;
+
+        if (!timers.isPending(boss.shootCooldown)) {
+            boss.shootCooldown = timers.schedule(bossWeapon.cooldown);
+            emitVolley(enemyBullets, bossWeapon, boss.position);
+        }
+
+        if (boss.health <= 0) {
+            explode(boss.position, 2.0f);
+            playSound(SoundId::Explosion);
+            players[0].score += getEnemyDef(EnemyType::Boss).scoreValue;
+
+            timers.cancel(boss.turnTimer);
+            timers.cancel(boss.shootCooldown);
+            boss = Boss();
+            level.resetBossFlag();
+
+            // The level 5 boss is the last one
+            if (level.getCurrentLevel() >= 5) {
+                state = GameState::Victory;
+            } else {
+                state = GameState::Playing;
+                timers.resume(enemySpawnTimer);
+                timers.resume(powerupSpawnTimer);
+            }
+        }
+    }
+
+    // Each sweep lasts at most 2 seconds before the boss turns around
+    void setBossState(Boss::State newState) {
+        boss.state = newState;
+        timers.cancel(boss.turnTimer);
+        boss.turnTimer = timers.schedule(2.0f, static_cast<std::uint32_t>(TimerEvent::BossTurn));
+    }
+
+    void startBossFight() {
+        state = GameState::BossFight;
+
+        // No regular spawns during the fight; they pick up where they left off afterwards
+        timers.pause(enemySpawnTimer);
+        timers.pause(powerupSpawnTimer);
+
+        bossWarningVisible = true;
+        timers.cancel(bossWarningTimer);
+        bossWarningTimer = timers.schedule(3.0f, static_cast<std::uint32_t>(TimerEvent::BossWarning));
+    }
+
+    void spawnEnemy() {
+        // Random enemy type based on level
+        int maxEnemyType = std::min(3, level.getCurrentLevel());
+        EnemyType type = static_cast<EnemyType>(random.nextInt(maxEnemyType));
+        float x = static_cast<float>(random.nextInt(750) + 25);
+        enemies.push_back({ sf::Vector2f(x, -50.f), getEnemyDef(type).health, type });
+    }
+
+    void spawnPowerUp() {
+        PowerUpType type = static_cast<PowerUpType>(random.nextInt(4));
+        float x = static_cast<float>(random.nextInt(750) + 25);
+        powerups.push_back({ sf::Vector2f(x, -50.f), type });
+    }
+
+    GameState state;
+    std::uint64_t tick;
+    SimRandom random;
+    TimerWheel timers;
+    Level level;
+
+    std::uint32_t playerCount;
+    std::array<Player, maxPlayers> players;     // Unused entries stay default-constructed
+    BulletPool bullets;
+    BulletPool enemyBullets;
+    std::vector<Laser> lasers;
+    std::vector<Enemy> enemies;
+    std::vector<PowerUp> powerups;
+    Boss boss;
+
+    TimerHandle enemySpawnTimer;
+    TimerHandle powerupSpawnTimer;
+    TimerHandle bossWarningTimer;
+    bool bossWarningVisible;
+
+    std::vector<Event> events;
+
+    // Scratch space for laser and bullet queries, kept to avoid per-tick allocations
+    Broadphase enemyBroadphase;
+    std::vector<const Broadphase::Entry*> laserHits;
+    std::vector<const Broadphase::Entry*> bulletHits;
+    std::vector<std::uint8_t> enemiesKilled;
+};
+
+// State export - a compact copy of the simulation published into POSIX shared memory after every
+// tick, for overlays, bots and stream tools running in other processes. A seqlock guards it: the
+// writer never waits on readers, and readers retry if a tick was published while they copied.
+// Entities beyond the fixed capacity are counted but not exported, so publishing is bounded.
+struct ExportedEntity {
+    enum Kind : std::uint8_t {
+        Enemy,          // type is the EnemyType
+        PlayerBullet,   // type is the ShapeId
+        EnemyBullet,
+        Laser,          // y is the top of the beam
+        PowerUp         // type is the PowerUpType
+    };
+
+    float x;
+    float y;
+    std::uint8_t kind;
+    std::uint8_t type;
+    std::uint16_t reserved;
+};
+
+struct ExportedPlayer {
+    float x;
+    float y;
+    std::int32_t health;
+    std::int32_t score;
+    float shieldHealth;
+    std::uint8_t weaponType;        // WeaponType
+    std::uint8_t reserved[3];
+};
+
+struct ExportedState {
+    static constexpr std::uint32_t maxEntities = 1024;
+
+    std::uint64_t tick;
+    std::uint8_t gameState;         // GameState
+    std::uint8_t playerCount;       // Entries used in 'players'; 2 in co-op
+    std::uint8_t bossActive;
+    std::uint8_t bossState;         // Boss::State
+    std::int32_t level;
+    std::int32_t enemiesDefeated;
+    std::int32_t enemiesForNextLevel;
+    float bossX;
+    float bossY;
+    float bossHealth;
+    ExportedPlayer players[Simulation::maxPlayers];
+    std::uint32_t entityCount;      // Entries used in 'entities'
+    std::uint32_t droppedCount;     // Entities past the capacity
+    ExportedEntity entities[maxEntities];
+};
+
+struct StateExportSegment {
+    static constexpr std::uint32_t magic = 0x58455353;    // "SSEX"
+    static constexpr std::uint32_t version = 2;
+
+    std::uint32_t segmentMagic;
+    std::uint32_t segmentVersion;
+    std::atomic<std::uint32_t> sequence;    // Odd while the writer is mid-update
+    std::uint32_t reserved;
+    ExportedState state;
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "the seqlock counter must be lock-free to work across processes");
+
+const char* const stateExportName = "/space-shooter-state";
+
+class StateExport {
+public:
+    StateExport() : segment(nullptr) {}
+
+    ~StateExport() {
+        close();
+    }
+
+    // Create (or take over) the named segment; false where POSIX shared memory is unavailable
+    bool open(const char* name = stateExportName) {
+        close();
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        if (ftruncate(fd, sizeof(StateExportSegment)) != 0) {
+            ::close(fd);
+            return false;
+        }
+        void* address = mmap(nullptr, sizeof(StateExportSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+
+        segmentName = name;
+        segment = static_cast<StateExportSegment*>(address);
+
+        // A writer that died mid-update left the count odd
+        std::uint32_t sequence = segment->sequence.load(std::memory_order_relaxed);
+        if (sequence & 1) {
+            segment->sequence.store(sequence + 1, std::memory_order_release);
+        }
+        segment->segmentVersion = StateExportSegment::version;
+        // Readers check the magic last, so it goes in once the rest is valid
+        std::atomic_thread_fence(std::memory_order_release);
+        segment->segmentMagic = StateExportSegment::magic;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Unmaps and removes the segment; readers that still have it mapped keep their last copy
+    void close() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (segment) {
+            munmap(segment, sizeof(StateExportSegment));
+            shm_unlink(segmentName.c_str());
+            segment = nullptr;
+        }
+#endif
+    }
+
+    bool isOpen() const { return segment != nullptr; }
+
+    void publish(const Simulation& simulation) {
+        publish(simulation, simulation.getEnemies(), simulation.getBullets(), simulation.getEnemyBullets(), simulation.getLasers(),
+                simulation.getPowerUps());
+    }
+
+    // At most maxEntities entities are written, so the cost has a fixed ceiling
+    void publish(const Simulation& simulation, const std::vector<Enemy>& enemies, const BulletPool& bullets, const BulletPool& enemyBullets,
+                 const std::vector<Laser>& lasers, const std::vector<PowerUp>& powerups) {
+        if (!segment) return;
+
+        std::uint32_t sequence = segment->sequence.load(std::memory_order_relaxed);
+        segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        ExportedState& state = segment->state;
+        const Level& level = simulation.getLevel();
+        const Boss& boss = simulation.getBoss();
+        state.tick = simulation.getTick();
+        state.gameState = static_cast<std::uint8_t>(simulation.getState());
+        state.playerCount = static_cast<std::uint8_t>(simulation.getPlayerCount());
+        state.bossActive = boss.active ? 1 : 0;
+        state.bossState = static_cast<std::uint8_t>(boss.state);
+        state.level = level.getCurrentLevel();
+        state.enemiesDefeated = level.getEnemiesDefeated();
+        state.enemiesForNextLevel = level.getEnemiesForNextLevel();
+        state.bossX = boss.position.x;
+        state.bossY = boss.position.y;
+        state.bossHealth = boss.health;
+        for (int i = 0; i < Simulation::maxPlayers; ++i) {
+            // Seats past the player count are zeroed rather than left holding an earlier game's ship
+            ExportedPlayer& exported = state.players[i];
+            exported = ExportedPlayer();
+            if (i >= simulation.getPlayerCount()) continue;
+            const Player& player = simulation.getPlayer(i);
+            exported.x = player.position.x;
+            exported.y = player.position.y;
+            exported.health = player.health;
+            exported.score = player.score;
+            exported.shieldHealth = simulation.hasShield(i) ? simulation.getShieldHealth(i) : 0.0f;
+            exported.weaponType = static_cast<std::uint8_t>(player.weaponType);
+        }
+
+        // Once the export is full the rest are only counted, so a crowded tick costs no more to publish
+        std::uint32_t count = 0;
+        auto add = [&](const sf::Vector2f& position, ExportedEntity::Kind kind, int type) {
+            if (count == ExportedState::maxEntities) {
+                return false;
+            }
+            ExportedEntity& entity = state.entities[count++];
+            entity.x = position.x;
+            entity.y = position.y;
+            entity.kind = kind;
+            entity.type = static_cast<std::uint8_t>(type);
+            entity.reserved = 0;
+            return true;
+        };
+
+        for (const Enemy& enemy : enemies) {
+            if (!add(enemy.position, ExportedEntity::Enemy, static_cast<int>(enemy.type))) break;
+        }
+        for (const PowerUp& powerup : powerups) {
+            if (!add(powerup.position, ExportedEntity::PowerUp, static_cast<int>(powerup.type))) break;
+        }
+        for (const Laser& laser : lasers) {
+            if (!add(sf::Vector2f(laser.x, laser.top), ExportedEntity::Laser, 0)) break;
+        }
+        for (const Bullet& bullet : enemyBullets) {
+            if (!add(bullet.position, ExportedEntity::EnemyBullet, static_cast<int>(bullet.shape))) break;
+        }
+        for (const Bullet& bullet : bullets) {
+            if (!add(bullet.position, ExportedEntity::PlayerBullet, static_cast<int>(bullet.shape))) break;
+        }
+        std::size_t total = enemies.size() + powerups.size() + lasers.size() + enemyBullets.size() + bullets.size();
+        state.entityCount = count;
+        state.droppedCount = static_cast<std::uint32_t>(total - count);
+
+        segment->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+private:
+    StateExportSegment* segment;
+    std::string segmentName;
+};
+
+// Reader side of the state export, used by --read-state and by tools linking this file
+class StateExportReader {
+public:
+    StateExportReader() : segment(nullptr) {}
+
+    ~StateExportReader() {
+        close();
+    }
+
+    bool open(const char* name = stateExportName) {
+        close();
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        bool sizeOk = fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= sizeof(StateExportSegment);
+        void* address = sizeOk ? mmap(nullptr, sizeof(StateExportSegment), PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+
+        segment = static_cast<const StateExportSegment*>(address);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void close() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (segment) {
+            munmap(const_cast<StateExportSegment*>(segment), sizeof(StateExportSegment));
+            segment = nullptr;
+        }
+#endif
+    }
+
+    // Copies the latest complete tick; false if the segment is not (yet) valid, or if no complete
+    // copy could be taken within readTimeout, as when the writer died mid-update
+    bool read(ExportedState& state) const {
+        if (!segment || segment->segmentMagic != StateExportSegment::magic || segment->segmentVersion != StateExportSegment::version) {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        auto deadline = std::chrono::steady_clock::now() + readTimeout;
+        for (;;) {
+            std::uint32_t before = segment->sequence.load(std::memory_order_acquire);
+            if (!(before & 1)) {
+                // The count may be torn mid-update; clamping keeps the copy in bounds until the retry
+                std::memcpy(&state, &segment->state, offsetof(ExportedState, entities));
+                state.entityCount = std::min(state.entityCount, ExportedState::maxEntities);
+                state.playerCount = std::min<std::uint8_t>(state.playerCount, Simulation::maxPlayers);
+                std::memcpy(state.entities, segment->state.entities, state.entityCount * sizeof(ExportedEntity));
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (segment->sequence.load(std::memory_order_relaxed) == before) {
+                    return true;
+                }
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    // A publish takes microseconds, so this only runs out when the writer is gone
+    static constexpr std::chrono::milliseconds readTimeout{5};
+
+    const StateExportSegment* segment;
+};
+
+// --read-state: prints the exported stats of a running game about twice a second
+int runStateReader() {
+    StateExportReader reader;
+    if (!reader.open()) {
+        std::cerr << "No state export found; start the game with --export-state" << std::endl;
+        return 1;
+    }
+
+    static const char* const stateNames[] = { "menu", "playing", "boss fight", "game over", "victory" };
+    std::unique_ptr<ExportedState> state(new ExportedState());
+    std::uint64_t lastTick = ~std::uint64_t(0);
+    int unchangedReads = 0;
+
+    for (;;) {
+        if (!reader.read(*state)) {
+            std::cout << "waiting for the game..." << std::endl;
+        } else if (state->tick == lastTick) {
+            // Paused, in a menu or gone; a restarted game publishes into a new segment
+            if (++unchangedReads % 4 == 0 && !reader.open()) {
+                std::cout << "the game has exited" << std::endl;
+                return 0;
+            }
+        } else {
+            unchangedReads = 0;
+            int counts[5] = {};
+            for (std::uint32_t i = 0; i < state->entityCount; ++i) {
+                ++counts[std::min<int>(state->entities[i].kind, 4)];
+            }
+
+            std::cout << "tick " << state->tick << "  " << stateNames[std::min<int>(state->gameState, 4)] << "  level " << state->level
+                      << " (" << state->enemiesDefeated << "/" << state->enemiesForNextLevel << ")";
+            for (int i = 0; i < state->playerCount; ++i) {
+                const ExportedPlayer& player = state->players[i];
+                std::cout << (state->playerCount > 1 ? "  P" + std::to_string(i + 1) + " score " : "  score ") << player.score
+                          << "  health " << player.health << "  shield " << static_cast<int>(player.shieldHealth)
+                          << "  weapon " << weaponTable[std::min<std::size_t>(player.weaponType, weaponCount - 1)].name;
+            }
+            std::cout << "  enemies " << counts[ExportedEntity::Enemy] << "  bullets " << counts[ExportedEntity::PlayerBullet]
+                      << "/" << counts[ExportedEntity::EnemyBullet] << "  power-ups " << counts[ExportedEntity::PowerUp];
+            if (state->bossActive) {
+                std::cout << "  boss " << static_cast<int>(state->bossHealth) << " hp";
+            }
+            if (state->droppedCount) {
+                std::cout << "  (" << state->droppedCount << " not exported)";
+            }
+            std::cout << std::endl;
+            lastTick = state->tick;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+}
+
+// Rewind buffer - the last stretch of simulation ticks, for stepping back to the exact tick of a
+// bug. Every captured tick is stored as the XOR of its snapshot with the tick before, with runs
+// of unchanged bytes skipped; every keyframeInterval ticks a keyframe is stored the same way
+// against nothing. Records live in one ring of fixed size and the oldest keyframe and its
+// deltas are dropped together when room is needed, so memory never grows past the budget.
+class RewindBuffer {
+public:
+    RewindBuffer(std::size_t budgetBytes = 4 << 20, std::size_t maxTicks = 3600, std::uint32_t keyframeInterval = 60)
+        : storage(budgetBytes), records(maxTicks), keyframeInterval(keyframeInterval) {
+        clear();
+    }
+
+    void clear() {
+        firstRecord = 0;
+        recordCount = 0;
+        firstTick = 0;
+        writeOffset = 0;
+        cursorTick = noTick;
+        previous.clear();
+    }
+
+    // Store the simulation's current tick. Ticks have to follow on from the last one captured;
+    // anything else starts the buffer over.
+    void capture(const Simulation& simulation) {
+        std::uint64_t tick = simulation.getTick();
+        if (recordCount && tick != getLastTick() + 1) {
+            clear();
+        }
+        simulation.save(current);
+
+        bool keyframe = recordCount == 0 || tick % keyframeInterval == 0;
+        if (!keyframe) {
+            encodeDelta(current, previous, encoded);
+            if (!append(tick, false)) {
+                // Only the group this delta belongs to was left to drop
+                clear();
+                keyframe = true;
+            }
+        }
+        if (keyframe) {
+            encodeDelta(current, std::vector<std::uint8_t>(), encoded);
+            if (!append(tick, true)) {
+                clear();
+                return;
+            }
+        }
+        previous.swap(current);
+    }
+
+    // Rebuild the snapshot of 'tick' into 'out'; false if the tick is not held. Stepping forward
+    // from the last tick sought only decodes the deltas in between.
+    bool seek(std::uint64_t tick, std::vector<std::uint8_t>& out) {
+        if (!contains(tick)) {
+            return false;
+        }
+
+        std::size_t index = static_cast<std::size_t>(tick - firstTick);
+        std::size_t keyframeIndex = index;
+        while (!getRecord(keyframeIndex).keyframe) {
+            --keyframeIndex;
+        }
+
+        std::size_t next = keyframeIndex;
+        if (cursorTick != noTick && cursorTick <= tick && cursorTick >= firstTick + keyframeIndex) {
+            next = static_cast<std::size_t>(cursorTick - firstTick) + 1;
+        } else {
+            cursor.clear();
+        }
+        for (; next <= index; ++next) {
+            const Record& record = getRecord(next);
+            applyDelta(storage.data() + record.offset, record.storedSize, record.snapshotSize, cursor);
+        }
+        cursorTick = tick;
+        out = cursor;
+        return true;
+    }
+
+    // Forget every tick after 'tick', so capturing carries on from it; used when play resumes from
+    // a rewound tick
+    void truncateAfter(std::uint64_t tick) {
+        if (!contains(tick) || tick == getLastTick()) {
+            return;
+        }
+        seek(tick, previous);
+        recordCount = static_cast<std::size_t>(tick - firstTick) + 1;
+        const Record& last = getRecord(recordCount - 1);
+        writeOffset = last.offset + last.storedSize;
+    }
+
+    bool contains(std::uint64_t tick) const {
+        return recordCount && tick >= firstTick && tick <= getLastTick();
+    }
+
+    bool empty() const { return recordCount == 0; }
+    std::uint64_t getFirstTick() const { return firstTick; }
+    std::uint64_t getLastTick() const { return firstTick + recordCount - 1; }
+    std::size_t getTickCount() const { return recordCount; }
+
+    // Bytes held by records, against the fixed ring and index sizes
+    std::size_t getUsedBytes() const {
+        if (!recordCount) return 0;
+        std::size_t head = getRecord(0).offset;
+        return writeOffset > head ? writeOffset - head : storage.size() - head + writeOffset;
+    }
+    std::size_t getBudgetBytes() const { return storage.size() + records.size() * sizeof(Record); }
+
+    std::size_t getKeyframeCount() const {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < recordCount; ++i) {
+            count += getRecord(i).keyframe ? 1 : 0;
+        }
+        return count;
+    }
+
+private:
+    static constexpr std::uint64_t noTick = ~std::uint64_t(0);
+
+    struct Record {
+        std::uint32_t offset;
+        std::uint32_t storedSize;
+        std::uint32_t snapshotSize;
+        bool keyframe;
+    };
+
+    Record& getRecord(std::size_t index) { return records[(firstRecord + index) % records.size()]; }
+    const Record& getRecord(std::size_t index) const { return records[(firstRecord + index) % records.size()]; }
+
+    // Copy 'encoded' into the ring as the record of 'tick', dropping the oldest groups to make room.
+    // Fails if that would mean dropping the group a delta belongs to.
+    bool append(std::uint64_t tick, bool keyframe) {
+        std::size_t size = encoded.size();
+        if (size >= storage.size()) {
+            return false;
+        }
+
+        std::size_t offset;
+        while (!findRoom(size, offset) || recordCount == records.size()) {
+            if (!dropOldestGroup(keyframe)) {
+                return false;
+            }
+        }
+
+        if (recordCount == 0) {
+            firstTick = tick;
+        }
+        Record& record = getRecord(recordCount++);
+        record.offset = static_cast<std::uint32_t>(offset);
+        record.storedSize = static_cast<std::uint32_t>(size);
+        record.snapshotSize = static_cast<std::uint32_t>(current.size());
+        record.keyframe = keyframe;
+        std::memcpy(storage.data() + offset, encoded.data(), size);
+        writeOffset = offset + size;
+        return true;
+    }
+
+    // Free space is after the newest record up to the ring's end or the oldest record, or from the
+    // ring's start up to the oldest record. A record never wraps, and the write position never
+    // catches up with the oldest record exactly, so equal offsets always mean an empty ring.
+    bool findRoom(std::size_t size, std::size_t& offset) const {
+        if (!recordCount) {
+            offset = 0;
+            return true;
+        }
+        std::size_t head = getRecord(0).offset;
+        if (writeOffset > head) {
+            if (storage.size() - writeOffset >= size) {
+                offset = writeOffset;
+                return true;
+            }
+            if (head > size) {
+                offset = 0;
+                return true;
+            }
+            return false;
+        }
+        if (head - writeOffset > size) {
+            offset = writeOffset;
+            return true;
+        }
+        return false;
+    }
+
+    // Deltas need every record back to their keyframe, so records go a keyframe group at a time
+    bool dropOldestGroup(bool appendingKeyframe) {
+        std::size_t count = 1;
+        while (count < recordCount && !getRecord(count).keyframe) {
+            ++count;
+        }
+        if (count == recordCount && !appendingKeyframe) {
+            return false;
+        }
+
+        firstRecord = (firstRecord + count) % records.size();
+        recordCount -= count;
+        firstTick += count;
+        if (cursorTick != noTick && cursorTick < firstTick) {
+            cursorTick = noTick;
+        }
+        if (!recordCount) {
+            writeOffset = 0;
+        }
+        return true;
+    }
+
+    static void writeVarint(std::vector<std::uint8_t>& out, std::size_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    static std::size_t readVarint(const std::uint8_t*& in) {
+        std::size_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            std::uint8_t byte = *in++;
+            value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+    }
+
+    // Pairs of (unchanged run, changed run) lengths as varints, each changed run followed by its
+    // bytes XORed with the base. Bytes past the end of the base count as zero.
+    static void encodeDelta(const std::vector<std::uint8_t>& snapshot, const std::vector<std::uint8_t>& base,
+                            std::vector<std::uint8_t>& out) {
+        const std::size_t size = snapshot.size();
+        const std::size_t common = std::min(size, base.size());
+        auto baseAt = [&](std::size_t i) -> std::uint8_t { return i < common ? base[i] : 0; };
+        out.clear();
+
+        std::size_t i = 0;
+        while (i < size) {
+            std::size_t start = i;
+            // Whole words first; most of a tick's snapshot is what it was a tick ago
+            while (i + 8 <= common && std::memcmp(&snapshot[i], &base[i], 8) == 0) {
+                i += 8;
+            }
+            while (i < size && snapshot[i] == baseAt(i)) {
+                ++i;
+            }
+            std::size_t unchanged = i - start;
+
+            // A changed run ends at four unchanged bytes, the least worth a new pair of lengths
+            std::size_t changedStart = i;
+            std::size_t end = i;
+            for (int same = 0; i < size && same < 4; ++i) {
+                if (snapshot[i] == baseAt(i)) {
+                    ++same;
+                } else {
+                    same = 0;
+                    end = i + 1;
+                }
+            }
+            i = end;
+
+            writeVarint(out, unchanged);
+            writeVarint(out, end - changedStart);
+            for (std::size_t j = changedStart; j < end; ++j) {
+                out.push_back(snapshot[j] ^ baseAt(j));
+            }
+        }
+    }
+
+    // Turns 'snapshot' from the base into the snapshot the delta was taken of
+    static void applyDelta(const std::uint8_t* in, std::size_t size, std::size_t snapshotSize, std::vector<std::uint8_t>& snapshot) {
+        snapshot.resize(snapshotSize);
+        const std::uint8_t* end = in + size;
+        std::size_t position = 0;
+        while (in < end) {
+            position += readVarint(in);
+            std::size_t changed = readVarint(in);
+            for (std::size_t j = 0; j < changed; ++j) {
+                snapshot[position + j] ^= in[j];
+            }
+            in += changed;
+            position += changed;
+        }
+    }
+
+    std::vector<std::uint8_t> storage;
+    std::vector<Record> records;
+    std::uint32_t keyframeInterval;
+    std::size_t firstRecord;
+    std::size_t recordCount;
+    std::uint64_t firstTick;
+    std::size_t writeOffset;
+
+    // Snapshot of the newest tick, the base of the next delta, and scratch for encoding
+    std::vector<std::uint8_t> previous;
+    std::vector<std::uint8_t> current;
+    std::vector<std::uint8_t> encoded;
+
+    // Last tick rebuilt by seek()
+    std::uint64_t cursorTick;
+    std::vector<std::uint8_t> cursor;
+};
+
+// Replay files - a game is its seed plus one input byte per tick, so replaying those re-creates it
+// exactly. Snapshot keyframes every keyframeInterval ticks let a viewer reach any tick by restoring
+// the keyframe before it and simulating at most one interval, instead of playing from the start.
+// Layout: header, keyframe snapshots, the inputs, the keyframe index, and a footer at the very end
+// that points back at the inputs and the index. The file is read through a memory mapping.
+// Collision shapes come from the images, so a replay only plays back the same with the same assets.
+class ReplayFile {
+public:
+    static constexpr std::uint32_t defaultKeyframeInterval = 300;
+
+    struct Keyframe {
+        std::uint64_t tick;
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    // Records a game in memory while it is played; write() saves it once the game is over
+    class Recorder {
+    public:
+        explicit Recorder(std::uint32_t keyframeInterval = defaultKeyframeInterval)
+            : keyframeInterval(std::max(1u, keyframeInterval)), seed(0) {}
+
+        // 'simulation' has just been reset with 'seed'
+        void start(std::uint64_t gameSeed, const Simulation& simulation) {
+            seed = gameSeed;
+            inputs.clear();
+            keyframes.clear();
+            snapshots.clear();
+            addKeyframe(simulation);
+        }
+
+        // The input of the step just taken and the state it led to
+        void record(std::uint8_t input, const Simulation& simulation) {
+            inputs.push_back(input);
+            if (simulation.getTick() % keyframeInterval == 0) {
+                addKeyframe(simulation);
+            }
+        }
+
+        // Forget every tick after 'tick', for play that carries on from a rewound tick
+        void truncate(std::uint64_t tick) {
+            if (tick >= inputs.size()) return;
+            inputs.resize(static_cast<std::size_t>(tick));
+            while (!keyframes.empty() && keyframes.back().tick > tick) {
+                snapshots.resize(static_cast<std::size_t>(keyframes.back().offset));
+                keyframes.pop_back();
+            }
+        }
+
+        std::uint64_t getTickCount() const { return inputs.size(); }
+
+        // 'simulation' is the game in its final state, which the footer records
+        bool write(const char* path, const Simulation& simulation) const {
+            Header header = {};
+            std::memcpy(header.magic, replayMagic, sizeof(header.magic));
+            header.version = replayVersion;
+            header.keyframeInterval = keyframeInterval;
+            header.seed = seed;
+
+            Footer footer = {};
+            footer.inputsOffset = sizeof(Header) + snapshots.size();
+            footer.tickCount = inputs.size();
+            footer.indexOffset = footer.inputsOffset + inputs.size();
+            footer.keyframeCount = static_cast<std::uint32_t>(keyframes.size());
+            footer.finalScore = simulation.getPlayer().score;
+            footer.finalLevel = simulation.getLevel().getCurrentLevel();
+            footer.finalState = static_cast<std::uint32_t>(simulation.getState());
+            footer.finalStateHash = simulation.getStateHash();
+            std::memcpy(footer.magic, replayMagic, sizeof(footer.magic));
+            footer.version = replayVersion;
+
+            std::vector<Keyframe> index(keyframes);
+            for (Keyframe& keyframe : index) {
+                keyframe.offset += sizeof(Header);
+            }
+
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(snapshots.data()), snapshots.size());
+            file.write(reinterpret_cast<const char*>(inputs.data()), inputs.size());
+            file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Keyframe));
+            file.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+            return static_cast<bool>(file);
+        }
+
+    private:
+        void addKeyframe(const Simulation& simulation) {
+            std::size_t offset = snapshots.size();
+            std::size_t size = simulation.getSnapshotSize();
+            snapshots.resize(offset + size);
+            simulation.save(snapshots.data() + offset);
+            keyframes.push_back({ simulation.getTick(), offset, size });
+        }
+
+        std::uint32_t keyframeInterval;
+        std::uint64_t seed;
+        std::vector<std::uint8_t> inputs;
+        std::vector<Keyframe> keyframes;     // Offsets into 'snapshots' until written
+        std::vector<std::uint8_t> snapshots;
+    };
+
+    ReplayFile() : data(nullptr), size(0) {}
+    ~ReplayFile() { close(); }
+
+    ReplayFile(const ReplayFile&) = delete;
+    ReplayFile& operator=(const ReplayFile&) = delete;
+
+    bool open(const char* path) {
+        close();
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data = static_cast<const std::uint8_t*>(mapped);
+                size = static_cast<std::size_t>(info.st_size);
+            }
+        }
+        ::close(fd);
+#else
+        if (readFileBytes(path, fallback)) {
+            data = reinterpret_cast<const std::uint8_t*>(fallback.data());
+            size = fallback.size();
+        }
+#endif
+        if (!data) return false;
+
+        if (!validate()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (data) {
+            munmap(const_cast<std::uint8_t*>(data), size);
+        }
+#else
+        fallback.clear();
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    bool isOpen() const { return data != nullptr; }
+
+    std::uint64_t getSeed() const { return header.seed; }
+    std::uint32_t getKeyframeInterval() const { return header.keyframeInterval; }
+    std::uint64_t getTickCount() const { return footer.tickCount; }
+    std::size_t getFileSize() const { return size; }
+
+    // Input of the step from 'tick' to the next one
+    std::uint8_t getInput(std::uint64_t tick) const { return data[footer.inputsOffset + tick]; }
+
+    std::size_t getKeyframeCount() const { return footer.keyframeCount; }
+
+    Keyframe getKeyframe(std::size_t index) const {
+        Keyframe keyframe;
+        std::memcpy(&keyframe, data + footer.indexOffset + index * sizeof(Keyframe), sizeof(Keyframe));
+        return keyframe;
+    }
+
+    // What the recording game ended with
+    int getFinalScore() const { return footer.finalScore; }
+    int getFinalLevel() const { return footer.finalLevel; }
+    GameState getFinalState() const { return static_cast<GameState>(footer.finalState); }
+    std::uint64_t getFinalStateHash() const { return footer.finalStateHash; }
+
+    // Bytes of a keyframe's snapshot, inside the mapping
+    const std::uint8_t* getKeyframeData(const Keyframe& keyframe) const { return data + keyframe.offset; }
+
+    // Put 'simulation' at 'tick', clamped to the replay: restore the last keyframe at or before it,
+    // then step the recorded inputs from there. Returns the number of ticks simulated.
+    std::uint64_t seek(std::uint64_t tick, Simulation& simulation) const {
+        tick = std::min(tick, getTickCount());
+
+        // Last keyframe at or before 'tick'; the index is in tick order
+        std::size_t low = 0, high = getKeyframeCount();
+        while (low < high) {
+            std::size_t middle = (low + high) / 2;
+            if (getKeyframe(middle).tick <= tick) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+
+        bool restored = false;
+        if (low > 0) {
+            Keyframe keyframe = getKeyframe(low - 1);
+            restored = simulation.restore(data + keyframe.offset, static_cast<std::size_t>(keyframe.size)) &&
+                       simulation.getTick() == keyframe.tick;
+        }
+        if (!restored) {
+            simulation.reset(getSeed());
+        }
+
+        // A game that is over stops ticking, which only a damaged file runs into here
+        std::uint64_t from = simulation.getTick();
+        while (simulation.getTick() < tick &&
+               (simulation.getState() == GameState::Playing || simulation.getState() == GameState::BossFight)) {
+            simulation.step(getInput(simulation.getTick()));
+        }
+        return simulation.getTick() - from;
+    }
+
+private:
+    static constexpr char replayMagic[4] = { 'S', 'S', 'R', 'P' };
+    static constexpr std::uint32_t replayVersion = 5;
+
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t keyframeInterval;
+        std::uint32_t reserved;
+        std::uint64_t seed;
+    };
+
+    struct Footer {
+        std::uint64_t inputsOffset;
+        std::uint64_t tickCount;
+        std::uint64_t indexOffset;
+        std::uint64_t finalStateHash;   // hashBytes() of the final snapshot
+        std::uint32_t keyframeCount;
+        std::int32_t finalScore;
+        std::int32_t finalLevel;
+        std::uint32_t finalState;
+        char magic[4];
+        std::uint32_t version;
+    };
+
+    bool validate() {
+        if (size < sizeof(Header) + sizeof(Footer)) return false;
+        std::memcpy(&header, data, sizeof(Header));
+        std::memcpy(&footer, data + size - sizeof(Footer), sizeof(Footer));
+        if (std::memcmp(header.magic, replayMagic, sizeof(replayMagic)) != 0 || header.version != replayVersion) return false;
+        if (std::memcmp(footer.magic, replayMagic, sizeof(replayMagic)) != 0 || footer.version != replayVersion) return false;
+
+        std::uint64_t indexEnd = size - sizeof(Footer);
+        if (footer.inputsOffset < sizeof(Header) || footer.inputsOffset > indexEnd || footer.tickCount > indexEnd - footer.inputsOffset) return false;
+        if (footer.indexOffset != footer.inputsOffset + footer.tickCount) return false;
+        if (static_cast<std::uint64_t>(footer.keyframeCount) * sizeof(Keyframe) != indexEnd - footer.indexOffset) return false;
+
+        // Keyframes sit between the header and the inputs, in tick order
+        for (std::size_t i = 0; i < footer.keyframeCount; ++i) {
+            Keyframe keyframe = getKeyframe(i);
+            if (keyframe.offset < sizeof(Header) || keyframe.offset > footer.inputsOffset ||
+                keyframe.size > footer.inputsOffset - keyframe.offset || keyframe.tick > footer.tickCount) return false;
+            if (i > 0 && keyframe.tick <= getKeyframe(i - 1).tick) return false;
+        }
+        return true;
+    }
+
+    const std::uint8_t* data;
+    std::size_t size;
+    Header header;
+    Footer footer;
+#if !defined(__unix__) && !defined(__APPLE__)
+    std::vector<char> fallback;
+#endif
+};
+
+// Network address - an IPv4 address and port, both in host byte order
+struct NetAddress {
+    std::uint32_t ip = 0;
+    std::uint16_t port = 0;
+
+    bool operator==(const NetAddress& other) const { return ip == other.ip && port == other.port; }
+    bool operator!=(const NetAddress& other) const { return !(*this == other); }
+};
+
+// Looks up a host name or dotted address; false unless it has an IPv4 address
+bool resolveAddress(const char* host, std::uint16_t port, NetAddress& address) {
+#if defined(__unix__) || defined(__APPLE__)
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host, nullptr, &hints, &result) != 0 || !result) {
+        return false;
+    }
+    address.ip = ntohl(reinterpret_cast<const sockaddr_in*>(result->ai_addr)->sin_addr.s_addr);
+    address.port = port;
+    freeaddrinfo(result);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// UDP socket - non-blocking IPv4 datagrams (POSIX only)
+class UdpSocket {
+public:
+    UdpSocket() : fd(-1) {}
+    ~UdpSocket() { close(); }
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    // Binds to 'port' on every interface; 0 lets the system pick a free one
+    bool open(std::uint16_t port = 0) {
+        close();
+#if defined(__unix__) || defined(__APPLE__)
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(port);
+        if (bind(fd, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0 || fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+            close();
+            return false;
+        }
+        return true;
+#else
+        (void)port;
+        return false;
+#endif
+    }
+
+    void close() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (fd >= 0) {
+            ::close(fd);
+        }
+#endif
+        fd = -1;
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+    std::uint16_t getLocalPort() const {
+#if defined(__unix__) || defined(__APPLE__)
+        sockaddr_in local = {};
+        socklen_t length = sizeof(local);
+        if (fd >= 0 && getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length) == 0) {
+            return ntohs(local.sin_port);
+        }
+#endif
+        return 0;
+    }
+
+    bool send(const NetAddress& to, const std::uint8_t* data, std::size_t size) {
+#if defined(__unix__) || defined(__APPLE__)
+        sockaddr_in remote = {};
+        remote.sin_family = AF_INET;
+        remote.sin_addr.s_addr = htonl(to.ip);
+        remote.sin_port = htons(to.port);
+        return sendto(fd, data, size, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote)) == static_cast<ssize_t>(size);
+#else
+        (void)to;
+        (void)data;
+        (void)size;
+        return false;
+#endif
+    }
+
+    // Asks for room to queue 'bytes' of incoming datagrams; the system may grant less
+    void setReceiveBufferSize(int bytes) {
+#if defined(__unix__) || defined(__APPLE__)
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+#else
+        (void)bytes;
+#endif
+    }
+
+    // Blocks until a datagram is waiting or 'timeoutMs' has passed; true if one is waiting
+    bool wait(int timeoutMs) {
+#if defined(__unix__) || defined(__APPLE__)
+        pollfd entry = { fd, POLLIN, 0 };
+        return poll(&entry, 1, timeoutMs) > 0;
+#else
+        (void)timeoutMs;
+        return false;
+#endif
+    }
+
+    // Copies the next waiting datagram into 'data' and returns its size; -1 once none is waiting
+    int receive(std::uint8_t* data, std::size_t capacity, NetAddress& from) {
+#if defined(__unix__) || defined(__APPLE__)
+        sockaddr_in remote = {};
+        socklen_t length = sizeof(remote);
+        ssize_t size = recvfrom(fd, data, capacity, 0, reinterpret_cast<sockaddr*>(&remote), &length);
+        if (size < 0) {
+            return -1;
+        }
+        from.ip = ntohl(remote.sin_addr.s_addr);
+        from.port = ntohs(remote.sin_port);
+        return static_cast<int>(size);
+#else
+        (void)data;
+        (void)capacity;
+        (void)from;
+        return -1;
+#endif
+    }
+
+private:
+    int fd;
+};
+
+// Link conditions - latency, jitter and loss added to outgoing datagrams, so netplay can be tried
+// on one machine as if over a real connection. Jitter reorders datagrams, as it would there.
+struct LinkConditions {
+    float latencyMs = 0.0f;     // One way
+    float jitterMs = 0.0f;      // Uniform extra delay on top of the latency
+    float loss = 0.0f;          // Fraction of datagrams dropped
+};
+
+// Conditioned link - a UDP socket whose outgoing datagrams wait in a queue until their simulated
+// delay has passed, unless the simulated loss drops them. Times are milliseconds on the caller's
+// clock, so tests can run it on a clock of their own.
+class ConditionedLink {
+public:
+    static constexpr std::size_t maxDatagramSize = 512;
+
+    bool open(std::uint16_t port, const LinkConditions& linkConditions, std::uint32_t seed) {
+        conditions = linkConditions;
+        random.seed(seed);
+        pending.clear();
+        return socket.open(port);
+    }
+
+    void close() {
+        socket.close();
+        pending.clear();
+    }
+
+    bool isOpen() const { return socket.isOpen(); }
+    std::uint16_t getLocalPort() const { return socket.getLocalPort(); }
+    std::uint64_t getDroppedCount() const { return dropped; }
+
+    void send(const NetAddress& to, const std::uint8_t* data, std::size_t size, double now) {
+        if (conditions.loss > 0.0f && std::uniform_real_distribution<float>(0.0f, 1.0f)(random) < conditions.loss) {
+            ++dropped;
+            return;
+        }
+        if (conditions.latencyMs <= 0.0f && conditions.jitterMs <= 0.0f) {
+            socket.send(to, data, size);
+            return;
+        }
+
+        Datagram datagram;
+        datagram.due = now + conditions.latencyMs + std::uniform_real_distribution<float>(0.0f, conditions.jitterMs)(random);
+        datagram.to = to;
+        datagram.size = static_cast<std::uint16_t>(std::min(size, maxDatagramSize));
+        std::memcpy(datagram.bytes.data(), data, datagram.size);
+        pending.push_back(datagram);
+    }
+
+    // Sends every held datagram whose delay is over
+    void flush(double now) {
+        for (std::size_t i = 0; i < pending.size();) {
+            if (pending[i].due <= now) {
+                socket.send(pending[i].to, pending[i].bytes.data(), pending[i].size);
+                pending[i] = pending.back();
+                pending.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    int receive(std::uint8_t* data, std::size_t capacity, NetAddress& from) {
+        return socket.receive(data, capacity, from);
+    }
+
+private:
+    struct Datagram {
+        double due;
+        NetAddress to;
+        std::uint16_t size;
+        std::array<std::uint8_t, maxDatagramSize> bytes;
+    };
+
+    UdpSocket socket;
+    LinkConditions conditions;
+    std::mt19937 random;
+    std::vector<Datagram> pending;
+    std::uint64_t dropped = 0;
+};
+
+// Lockstep co-op - two peers run the same two-player simulation and only inputs cross the
+// network. Input sampled while the game is at tick T is applied at tick T + inputDelay, which
+// hides the trip to the other peer; a tick is only simulated once both players' inputs for it
+// are in, so the peers can never drift apart. Every sendInterval ticks a peer sends all of its
+// inputs the other has not acknowledged yet, up to 'redundancy' of them and run-length encoded,
+// so a lost datagram is covered by the next one without waiting for a resend.
+// With maxRollback above zero a peer does not wait: it runs up to that many ticks past the other
+// player's last known input, predicting that input stays as it was, and keeps a snapshot of each
+// predicted tick. When the real input turns out different, the next advance() restores the
+// snapshot of the first wrong tick and simulates back up to the present within that one call.
+class LockstepSession {
+public:
+    static constexpr std::uint16_t defaultPort = 47000;
+    static constexpr int maxRollbackLimit = 16;
+
+    struct Config {
+        int inputDelay = 4;         // Ticks between sampling an input and applying it
+        int sendInterval = 3;       // Ticks between input datagrams, so 20 a second
+        int redundancy = 32;        // Most inputs one datagram carries
+        int maxRollback = 0;        // Ticks simulated ahead on predicted input; 0 is plain lockstep
+        LinkConditions link;
+    };
+
+    struct Stats {
+        std::uint64_t datagramsSent = 0;
+        std::uint64_t datagramsReceived = 0;
+        std::uint64_t bytesSent = 0;        // With the 28 bytes of IPv4 and UDP headers per datagram
+        std::uint64_t stalls = 0;           // advance() calls that waited on the other peer
+        std::uint64_t latencySamples = 0;   // Inputs sampled and applied
+        double latencySum = 0.0;            // Milliseconds from sampling an input to simulating its tick
+        double latencyMax = 0.0;
+
+        // Rollbacks by depth, the ticks they re-simulated, and the time each took on its frame
+        std::uint64_t rollbacks = 0;
+        std::array<std::uint64_t, maxRollbackLimit + 1> rollbackDepths = {};
+        std::uint64_t resimulatedTicks = 0;
+        double rollbackSecondsSum = 0.0;
+        double rollbackSecondsMax = 0.0;
+    };
+
+    // Smallest input delay that never waits on a link this slow one way, jitter included: the
+    // wait for the next datagram, a frame to receive it, and the trip, which on a frame-driven
+    // link ends at the first frame after it is due
+    static int getStallFreeInputDelay(int sendInterval, float latencyMs) {
+        int tripTicks = latencyMs > 0.0f ? static_cast<int>(std::ceil(latencyMs / (Simulation::tickSeconds * 1000.0f))) + 1 : 0;
+        return sendInterval + 1 + tripTicks;
+    }
+
+    LockstepSession()
+        : hosting(false), started(false), seed(0), remoteAcked(0), simulatedTicks(0), mispredictedTick(noTick),
+          lastSendTime(0.0), lastHelloTime(0.0) {}
+
+    // Wait on 'port' for another player to join
+    bool host(std::uint16_t port, const Config& sessionConfig) {
+        start(sessionConfig);
+        hosting = true;
+        return link.open(port, config.link, 1);
+    }
+
+    bool join(const char* address, std::uint16_t port, const Config& sessionConfig) {
+        start(sessionConfig);
+        hosting = false;
+        return resolveAddress(address, port, peer) && link.open(0, config.link, 2);
+    }
+
+    void close() {
+        link.close();
+        started = false;
+    }
+
+    bool isOpen() const { return link.isOpen(); }
+    bool isHost() const { return hosting; }
+    std::uint16_t getLocalPort() const { return link.getLocalPort(); }
+
+    // Both peers are in; reset the simulation for two players with getSeed() and start advancing
+    bool isStarted() const { return started; }
+    std::uint64_t getSeed() const { return seed; }
+
+    // The host plays the first player, the peer that joined the second
+    int getLocalPlayer() const { return hosting ? 0 : 1; }
+    const Config& getConfig() const { return config; }
+    const Stats& getStats() const { return stats; }
+    std::uint64_t getDroppedCount() const { return link.getDroppedCount(); }
+
+    // Ticks whose inputs from both players are in; anything simulated past it may still change
+    std::uint64_t getConfirmedTick() const { return remoteInputs.size(); }
+
+    // Takes in whatever has arrived, answers the handshake and sends inputs when they are due.
+    // Call it every frame, including while the game is over, so the other peer can finish too.
+    void poll(double now) {
+        std::uint8_t datagram[ConditionedLink::maxDatagramSize];
+        NetAddress from;
+        int size;
+        while ((size = link.receive(datagram, sizeof(datagram), from)) >= 0) {
+            receive(datagram, static_cast<std::size_t>(size), from, now);
+        }
+
+        if (!started && !hosting && now - lastHelloTime >= helloIntervalMs) {
+            sendControl(Hello, now);
+            lastHelloTime = now;
+        }
+        sendInputsIfDue(now);
+        link.flush(now);
+    }
+
+    // Step 'simulation' one tick, sampling 'localInput' for inputDelay ticks ahead. Returns false,
+    // leaving the simulation as it is, while the other player's input for the tick is missing and
+    // the tick is past the rollback window; the input is only sampled on the first try at a tick.
+    bool advance(Simulation& simulation, std::uint8_t localInput, double now) {
+        if (!started) {
+            return false;
+        }
+        reconcile(simulation);
+        std::uint64_t tick = simulation.getTick();
+        if (localInputs.size() == tick + config.inputDelay) {
+            sampleTimes[localInputs.size() % sampleTimes.size()] = now;
+            localInputs.push_back(localInput);
+
+            // Straight out when due, rather than a frame later from poll()
+            sendInputsIfDue(now);
+            link.flush(now);
+        }
+        if (remoteInputs.size() + config.maxRollback <= tick) {
+            stats.stalls += tick > 0 ? 1 : 0;
+            return false;
+        }
+
+        // Waiting for the other peer to show up is not input latency
+        if (tick == 0) {
+            std::fill(sampleTimes.begin(), sampleTimes.end(), now);
+        }
+
+        step(simulation);
+        simulatedTicks = simulation.getTick();
+
+        if (tick >= static_cast<std::uint64_t>(config.inputDelay)) {
+            double latency = now - sampleTimes[tick % sampleTimes.size()];
+            ++stats.latencySamples;
+            stats.latencySum += latency;
+            stats.latencyMax = std::max(stats.latencyMax, latency);
+        }
+        return true;
+    }
+
+    // Undo any ticks simulated on a prediction that the other player's input has since proved
+    // wrong: restore the snapshot of the first such tick and simulate forward to where the game
+    // was. advance() does this first; call it directly to settle a game that has stopped advancing.
+    void reconcile(Simulation& simulation) {
+        std::uint64_t target = simulation.getTick();
+        if (mispredictedTick >= target) {
+            mispredictedTick = noTick;
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t depth = target - mispredictedTick;
+        simulation.restore(snapshots[mispredictedTick % snapshots.size()]);
+        mispredictedTick = noTick;
+
+        // The corrected game may end sooner than the predicted one did
+        while (simulation.getTick() < target && simulation.getState() != GameState::GameOver &&
+               simulation.getState() != GameState::Victory) {
+            step(simulation);
+        }
+        simulatedTicks = simulation.getTick();
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++stats.rollbacks;
+        ++stats.rollbackDepths[std::min<std::uint64_t>(depth, maxRollbackLimit)];
+        stats.resimulatedTicks += depth;
+        stats.rollbackSecondsSum += seconds;
+        stats.rollbackSecondsMax = std::max(stats.rollbackSecondsMax, seconds);
+    }
+
+private:
+    static constexpr std::uint64_t noTick = ~std::uint64_t(0);
+    static constexpr std::uint8_t protocolMagic = 0xC1;     // Changes with the datagram layout
+    static constexpr double helloIntervalMs = 100.0;
+    static constexpr std::size_t ipUdpHeaderSize = 28;
+
+    enum Kind : std::uint8_t {
+        Hello,      // Joining peer to host, until the host starts the game
+        Start,      // Host to joining peer, followed by the seed
+        Inputs      // Followed by runCount pairs of (input, run length)
+    };
+
+    struct DatagramHeader {
+        std::uint8_t magic;
+        std::uint8_t kind;
+        std::uint16_t runCount;
+        std::uint32_t firstTick;    // Tick of the first input carried
+        std::uint32_t ackTick;      // How many of the receiver's inputs the sender has
+    };
+
+    void start(const Config& sessionConfig) {
+        config = sessionConfig;
+        config.inputDelay = std::min(std::max(config.inputDelay, 0), static_cast<int>(sampleTimes.size()) - 2);
+        config.sendInterval = std::max(config.sendInterval, 1);
+        config.redundancy = std::min(std::max(config.redundancy, 1), static_cast<int>((ConditionedLink::maxDatagramSize - sizeof(DatagramHeader)) / 2));
+        config.maxRollback = std::min(std::max(config.maxRollback, 0), maxRollbackLimit);
+        started = false;
+        peerKnown = false;
+        remoteAcked = 0;
+        simulatedTicks = 0;
+        mispredictedTick = noTick;
+
+        // A slot per tick of the window; snapshots keep their capacity from game to game
+        snapshots.resize(config.maxRollback + 1);
+        predictions.assign(config.maxRollback + 1, 0);
+        lastSendTime = lastHelloTime = -1e9;
+        stats = Stats();
+
+        // Inputs before the delay has passed are nothing pressed, on both sides
+        localInputs.assign(config.inputDelay, 0);
+        remoteInputs.clear();
+    }
+
+    void receive(const std::uint8_t* data, std::size_t size, const NetAddress& from, double now) {
+        DatagramHeader header;
+        if (size < sizeof(header)) return;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != protocolMagic) return;
+
+        // The host takes the first peer to say hello and ignores everyone else
+        if (hosting && !peerKnown && header.kind == Hello) {
+            peer = from;
+            peerKnown = true;
+        }
+        if ((hosting && !peerKnown) || from != peer) return;
+        ++stats.datagramsReceived;
+
+        switch (header.kind) {
+            case Hello:
+                if (hosting) {
+                    if (!started) {
+                        std::random_device device;
+                        seed = (static_cast<std::uint64_t>(device()) << 32) | device();
+                        started = true;
+                    }
+                    // Answered every time, in case the last answer was lost
+                    sendControl(Start, now);
+                }
+                break;
+
+            case Start:
+                if (!hosting && !started && size >= sizeof(header) + sizeof(seed)) {
+                    std::memcpy(&seed, data + sizeof(header), sizeof(seed));
+                    started = true;
+                }
+                break;
+
+            case Inputs: {
+                if (!started || size < sizeof(header) + header.runCount * 2u) return;
+                remoteAcked = std::max<std::uint64_t>(remoteAcked, std::min<std::uint64_t>(header.ackTick, localInputs.size()));
+
+                // Only what extends the inputs already held is kept; older ones are repeats
+                std::uint64_t tick = header.firstTick;
+                if (tick > remoteInputs.size()) return;
+                const std::uint8_t* run = data + sizeof(header);
+                for (std::uint16_t i = 0; i < header.runCount; ++i, run += 2) {
+                    for (std::uint8_t k = 0; k < run[1]; ++k, ++tick) {
+                        if (tick == remoteInputs.size()) {
+                            // Ticks already simulated were simulated on a prediction
+                            if (tick < simulatedTicks && predictions[tick % predictions.size()] != run[0]) {
+                                mispredictedTick = std::min(mispredictedTick, tick);
+                            }
+                            remoteInputs.push_back(run[0]);
+                        }
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    // One tick with both inputs; a missing remote input is predicted to be the last one that
+    // arrived, and the state before the tick is kept in case the prediction is wrong
+    void step(Simulation& simulation) {
+        std::uint64_t tick = simulation.getTick();
+        std::uint8_t inputs[Simulation::maxPlayers];
+        inputs[getLocalPlayer()] = localInputs[tick];
+        if (tick < remoteInputs.size()) {
+            inputs[1 - getLocalPlayer()] = remoteInputs[tick];
+        } else {
+            std::size_t slot = tick % snapshots.size();
+            predictions[slot] = remoteInputs.empty() ? 0 : remoteInputs.back();
+            inputs[1 - getLocalPlayer()] = predictions[slot];
+            simulation.save(snapshots[slot]);
+        }
+        simulation.step(inputs);
+    }
+
+    void sendControl(Kind kind, double now) {
+        std::uint8_t datagram[sizeof(DatagramHeader) + sizeof(seed)];
+        DatagramHeader header = { protocolMagic, kind, 0, 0, 0 };
+        std::memcpy(datagram, &header, sizeof(header));
+        std::memcpy(datagram + sizeof(header), &seed, sizeof(seed));
+        send(datagram, kind == Start ? sizeof(datagram) : sizeof(header), now);
+    }
+
+    // Everything not yet acknowledged, oldest first; doubles as the acknowledgement of the other side's inputs
+    void sendInputsIfDue(double now) {
+        // Half a millisecond of slack so a 60 Hz caller is never a frame late
+        if (!started || now - lastSendTime < config.sendInterval * Simulation::tickSeconds * 1000.0 - 0.5) {
+            return;
+        }
+        lastSendTime = now;
+
+        std::uint8_t datagram[ConditionedLink::maxDatagramSize];
+        std::uint64_t first = remoteAcked;
+        std::uint64_t end = std::min<std::uint64_t>(localInputs.size(), first + config.redundancy);
+
+        std::uint8_t* run = datagram + sizeof(DatagramHeader);
+        std::uint16_t runCount = 0;
+        for (std::uint64_t tick = first; tick < end; ++tick) {
+            if (runCount && run[-2] == localInputs[tick] && run[-1] < 255) {
+                ++run[-1];
+            } else {
+                run[0] = localInputs[tick];
+                run[1] = 1;
+                run += 2;
+                ++runCount;
+            }
+        }
+
+        DatagramHeader header = { protocolMagic, Inputs, runCount, static_cast<std::uint32_t>(first),
+                                  static_cast<std::uint32_t>(remoteInputs.size()) };
+        std::memcpy(datagram, &header, sizeof(header));
+        send(datagram, static_cast<std::size_t>(run - datagram), now);
+    }
+
+    void send(const std::uint8_t* data, std::size_t size, double now) {
+        link.send(peer, data, size, now);
+        ++stats.datagramsSent;
+        stats.bytesSent += size + ipUdpHeaderSize;
+    }
+
+    Config config;
+    ConditionedLink link;
+    NetAddress peer;
+    bool hosting;
+    bool peerKnown = false;
+    bool started;
+    std::uint64_t seed;
+
+    // Inputs by tick: this peer's, and the other's as far as they have arrived without gaps
+    std::vector<std::uint8_t> localInputs;
+    std::vector<std::uint8_t> remoteInputs;
+    std::uint64_t remoteAcked;      // How many of 'localInputs' the other peer has
+
+    // Rollback window: the snapshot before each predicted tick and the input predicted for it,
+    // by tick modulo the window
+    std::vector<std::vector<std::uint8_t>> snapshots;
+    std::vector<std::uint8_t> predictions;
+    std::uint64_t simulatedTicks;       // Furthest tick simulated
+    std::uint64_t mispredictedTick;     // First tick simulated on a wrong prediction, or noTick
+
+    double lastSendTime;
+    double lastHelloTime;
+    std::array<double, 256> sampleTimes;    // When each of the latest inputs was sampled, by tick
+    Stats stats;
+};
+
+// CPU time used by the calling thread in seconds, or wall time where that cannot be had
+double getThreadCpuSeconds() {
+#if defined(__unix__) || defined(__APPLE__)
+    timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == 0) {
+        return now.tv_sec + now.tv_nsec * 1e-9;
+    }
+#endif
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// SipHash-2-4 of whole 64-bit words under a 128-bit key. Unlike FNV, its output gives nothing
+// away about the key, so it can make tokens that only the holder of the key can work out.
+std::uint64_t sipHash(const std::uint64_t key[2], const std::uint64_t* words, std::size_t count) {
+    std::uint64_t v0 = key[0] ^ 0x736f6d6570736575ull;
+    std::uint64_t v1 = key[1] ^ 0x646f72616e646f6dull;
+    std::uint64_t v2 = key[0] ^ 0x6c7967656e657261ull;
+    std::uint64_t v3 = key[1] ^ 0x7465646279746573ull;
+    auto rotate = [](std::uint64_t x, int bits) { return (x << bits) | (x >> (64 - bits)); };
+    auto round = [&]() {
+        v0 += v1; v1 = rotate(v1, 13); v1 ^= v0; v0 = rotate(v0, 32);
+        v2 += v3; v3 = rotate(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotate(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotate(v1, 17); v1 ^= v2; v2 = rotate(v2, 32);
+    };
+    auto compress = [&](std::uint64_t word) {
+        v3 ^= word;
+        round();
+        round();
+        v0 ^= word;
+    };
+    for (std::size_t i = 0; i < count; ++i) {
+        compress(words[i]);
+    }
+    compress(static_cast<std::uint64_t>(count * 8) << 56);
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; ++i) {
+        round();
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// Match server - many independent two-player matches in one headless process. Each match is a
+// Simulation pinned to one worker thread for its whole life, so its state stays in that core's
+// caches, and each worker serves its matches from a UDP socket of its own on port + worker index.
+// Every worker ticks off one shared 60 Hz schedule. The server is the authority: a client sends
+// its latest input, which the match applies every tick until a newer one arrives, and gets a
+// short summary of the match back every stateInterval ticks. A finished game restarts at once,
+// and a match nobody has been heard from for idleSeconds waits for new players.
+//
+// A client proves it receives at its address before anything it sends counts: an input without the
+// seat's token gets only a challenge carrying it, no bigger than the input, and changes nothing.
+// A seat stays with its address while that client is heard from, and summaries stop going to a
+// client once it has been quiet for clientTimeoutSeconds.
+class MatchServer {
+public:
+    static constexpr std::uint16_t defaultPort = 47100;
+
+    struct Config {
+        std::uint16_t port = defaultPort;   // 0 lets the system pick each worker's port
+        int matchCount = 256;
+        int threadCount = 1;
+        int stateInterval = 3;              // Ticks between summaries to each client
+        int reservedEnemies = 128;          // Per match, allocated before the first tick
+        float idleSeconds = 10.0f;
+        float clientTimeoutSeconds = 2.0f;  // Quiet this long, a client gets no summaries and can lose its seat
+        int warmupTicks = 0;                // For load tests: matches start up to this far into a game
+    };
+
+    // Client to server. The input with the newest sequence number wins.
+    struct InputDatagram {
+        std::uint8_t magic;
+        std::uint8_t player;
+        std::uint8_t input;         // Simulation input bits
+        std::uint8_t reserved;
+        std::uint32_t matchId;
+        std::uint32_t sequence;
+        std::uint32_t token;        // From the server's challenge; 0 until one has come
+    };
+
+    // Server to client, in answer to an input without the right token
+    struct ChallengeDatagram {
+        std::uint8_t magic;
+        std::uint8_t player;
+        std::uint8_t reserved[2];
+        std::uint32_t matchId;
+        std::uint32_t token;        // For this client's address, match and seat
+    };
+
+    // Server to client
+    struct StateDatagram {
+        std::uint8_t magic;
+        std::uint8_t player;
+        std::uint8_t gameState;     // GameState
+        std::uint8_t reserved;
+        std::uint32_t matchId;
+        std::uint32_t gameCount;    // Games started in this match, this one included
+        std::uint32_t tick;
+        std::uint32_t ackSequence;  // Newest input of this player the match runs on
+        std::int32_t score;
+        std::int32_t level;
+        std::int16_t health[Simulation::maxPlayers];
+        std::uint16_t enemyCount;
+        std::uint16_t reserved2;
+    };
+
+    static constexpr std::uint8_t inputMagic = 0xD1;
+    static constexpr std::uint8_t stateMagic = 0xD2;
+    static constexpr std::uint8_t challengeMagic = 0xD3;
+
+    // Summed over the workers
+    struct Stats {
+        std::uint64_t ticks = 0;                // Schedule ticks run
+        std::uint64_t lateTicks = 0;            // Started a tick or more after their time
+        std::uint64_t skippedTicks = 0;         // Given up to catch up with the schedule
+        std::uint64_t matchTicks = 0;           // Simulation steps
+        std::uint64_t gamesFinished = 0;
+        std::uint64_t datagramsReceived = 0;
+        std::uint64_t datagramsSent = 0;
+        std::uint64_t challengesSent = 0;       // Inputs answered with a token rather than taken
+        std::uint64_t activeMatches = 0;        // As of each worker's last tick
+        std::uint64_t matchBytes = 0;           // Memory held by the matches
+        double busySeconds = 0.0;               // Worker CPU time
+        double maxTickSeconds = 0.0;            // Longest tick of any worker
+    };
+
+    // What the stand-in clients play, and what warmed-up matches were played with
+    static std::uint8_t getStandInInput(int player, std::uint32_t tick) {
+        return Simulation::InputFire | ((tick / 40 + player) % 2 ? Simulation::InputLeft : Simulation::InputRight);
+    }
+
+    MatchServer() : stopping(false), readyCount(0) {}
+    ~MatchServer() { stop(); }
+
+    MatchServer(const MatchServer&) = delete;
+    MatchServer& operator=(const MatchServer&) = delete;
+
+    bool start(const Config& serverConfig) {
+        stop();
+        config = serverConfig;
+        config.matchCount = std::max(config.matchCount, 0);
+        config.threadCount = std::max(config.threadCount, 1);
+        config.stateInterval = std::max(config.stateInterval, 1);
+        config.reservedEnemies = std::max(config.reservedEnemies, 0);
+        idleTicks = static_cast<std::uint64_t>(std::max(config.idleSeconds, 1.0f) / Simulation::tickSeconds);
+        clientTimeoutTicks = static_cast<std::uint64_t>(std::max(config.clientTimeoutSeconds, 0.5f) / Simulation::tickSeconds);
+
+        // A new key every run, so tokens cannot be learned ahead of time or kept across restarts
+        std::random_device device;
+        for (std::uint64_t& word : tokenKey) {
+            word = (static_cast<std::uint64_t>(device()) << 32) | device();
+        }
+
+        workers.clear();
+        for (int i = 0; i < config.threadCount; ++i) {
+            workers.emplace_back(new Worker());
+            workers.back()->index = i;
+            if (!workers.back()->socket.open(config.port ? static_cast<std::uint16_t>(config.port + i) : 0)) {
+                workers.clear();
+                return false;
+            }
+            workers.back()->socket.setReceiveBufferSize(receiveBufferSize);
+        }
+
+        stopping = false;
+        readyCount = 0;
+        epoch = std::chrono::steady_clock::now();
+        for (std::unique_ptr<Worker>& worker : workers) {
+            worker->thread = std::thread(&MatchServer::runWorker, this, std::ref(*worker));
+        }
+        return true;
+    }
+
+    void stop() {
+        stopping = true;
+        for (std::unique_ptr<Worker>& worker : workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    // Every worker has built its matches and joined the schedule
+    bool isReady() const { return readyCount.load() == static_cast<int>(workers.size()); }
+
+    const Config& getConfig() const { return config; }
+    int getMatchCount() const { return config.matchCount; }
+
+    // Match 'matchId' lives on worker matchId % threadCount and is reached on its port
+    std::uint16_t getMatchPort(std::uint32_t matchId) const { return workers[matchId % workers.size()]->socket.getLocalPort(); }
+
+    std::vector<std::uint16_t> getWorkerPorts() const {
+        std::vector<std::uint16_t> ports;
+        for (const std::unique_ptr<Worker>& worker : workers) {
+            ports.push_back(worker->socket.getLocalPort());
+        }
+        return ports;
+    }
+
+    Stats getStats() const {
+        Stats total;
+        for (const std::unique_ptr<Worker>& worker : workers) {
+            std::lock_guard<std::mutex> lock(worker->statsMutex);
+            const Stats& stats = worker->stats;
+            total.ticks += stats.ticks;
+            total.lateTicks += stats.lateTicks;
+            total.skippedTicks += stats.skippedTicks;
+            total.matchTicks += stats.matchTicks;
+            total.gamesFinished += stats.gamesFinished;
+            total.datagramsReceived += stats.datagramsReceived;
+            total.datagramsSent += stats.datagramsSent;
+            total.challengesSent += stats.challengesSent;
+            total.activeMatches += stats.activeMatches;
+            total.matchBytes += stats.matchBytes;
+            total.busySeconds += stats.busySeconds;
+            total.maxTickSeconds = std::max(total.maxTickSeconds, stats.maxTickSeconds);
+        }
+        return total;
+    }
+
+private:
+    // A worker more than this many ticks behind gives up on them rather than running them late
+    static constexpr std::uint64_t maxCatchUpTicks = 8;
+    // Inputs that arrive during a tick are taken in every this many matches, so a worker with
+    // thousands of matches does not overflow its socket's buffer before the tick is over
+    static constexpr std::size_t matchesPerReceive = 256;
+    static constexpr int receiveBufferSize = 1 << 20;
+
+    struct Match {
+        Simulation simulation;
+        std::uint32_t id = 0;
+        std::uint32_t gameCount = 0;
+        bool active = false;
+        std::uint64_t lastHeardTick = 0;                        // From any client
+        std::uint64_t clientHeardTicks[Simulation::maxPlayers] = {};
+        std::uint8_t inputs[Simulation::maxPlayers] = {};
+        std::uint32_t sequences[Simulation::maxPlayers] = {};
+        bool clientKnown[Simulation::maxPlayers] = {};
+        NetAddress clients[Simulation::maxPlayers];
+    };
+
+    struct Worker {
+        int index = 0;
+        UdpSocket socket;
+        std::vector<Match> matches;     // Match id index * threadCount + this worker's index
+        std::thread thread;
+        mutable std::mutex statsMutex;
+        Stats stats;                    // Published after every tick
+    };
+
+    // Pins the calling thread to core index, wrapping round the cores there are
+    static void pinThread(int index) {
+#ifdef __linux__
+        unsigned cores = std::thread::hardware_concurrency();
+        if (cores > 1) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(index % cores, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+#else
+        (void)index;
+#endif
+    }
+
+    std::uint32_t getToken(const NetAddress& address, std::uint32_t matchId, int player) const {
+        const std::uint64_t words[2] = { (static_cast<std::uint64_t>(address.ip) << 32) | (static_cast<std::uint64_t>(address.port) << 16) |
+                                             static_cast<std::uint64_t>(player),
+                                         matchId };
+        // 0 is what a client sends before it has a token, so it is never one
+        return static_cast<std::uint32_t>(sipHash(tokenKey, words, 2)) | 1u;
+    }
+
+    std::uint64_t getScheduleTick() const {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+        return static_cast<std::uint64_t>(elapsed / Simulation::tickSeconds);
+    }
+
+    void startGame(Match& match) {
+        ++match.gameCount;
+        match.simulation.reset((static_cast<std::uint64_t>(match.gameCount) << 32) | match.id, Simulation::maxPlayers);
+    }
+
+    void runWorker(Worker& worker) {
+        // Pinned before the matches are built, so their memory is first touched on the core that uses it
+        pinThread(worker.index);
+        int threads = config.threadCount;
+        worker.matches.resize((config.matchCount - worker.index + threads - 1) / threads);
+        Stats stats;
+        for (std::size_t i = 0; i < worker.matches.size(); ++i) {
+            Match& match = worker.matches[i];
+            match.id = static_cast<std::uint32_t>(i * threads + worker.index);
+            match.simulation.reserve(config.reservedEnemies);
+            if (config.warmupTicks > 0) {
+                warmUp(match);
+            }
+            stats.matchBytes += sizeof(Match) + match.simulation.getHeapBytes();
+        }
+
+        // Join the shared schedule wherever it has got to
+        std::uint64_t tick = getScheduleTick() + 1;
+        for (Match& match : worker.matches) {
+            match.lastHeardTick = tick;
+        }
+        double cpuStart = getThreadCpuSeconds();
+        ++readyCount;
+
+        while (!stopping.load(std::memory_order_relaxed)) {
+            auto due = epoch + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                   std::chrono::duration<double>(tick * static_cast<double>(Simulation::tickSeconds)));
+            auto now = std::chrono::steady_clock::now();
+            if (now < due) {
+                // Datagrams are taken in as they come, so the socket's buffer never has to hold a tick's worth
+                int waitMs = static_cast<int>(std::ceil(std::chrono::duration<double, std::milli>(due - now).count()));
+                if (worker.socket.wait(std::max(waitMs, 1))) {
+                    receiveAll(worker, tick, stats);
+                }
+                continue;
+            }
+
+            std::uint64_t behind = static_cast<std::uint64_t>(std::chrono::duration<double>(now - due).count() / Simulation::tickSeconds);
+            stats.lateTicks += behind > 0 ? 1 : 0;
+            if (behind > maxCatchUpTicks) {
+                stats.skippedTicks += behind;
+                tick += behind;
+            }
+
+            stats.activeMatches = 0;
+            for (std::size_t i = 0; i < worker.matches.size(); ++i) {
+                if (i % matchesPerReceive == 0) {
+                    receiveAll(worker, tick, stats);
+                }
+                updateMatch(worker, worker.matches[i], tick, stats);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - now).count();
+            stats.maxTickSeconds = std::max(stats.maxTickSeconds, seconds);
+            ++stats.ticks;
+            ++tick;
+
+            stats.busySeconds = getThreadCpuSeconds() - cpuStart;
+            std::lock_guard<std::mutex> lock(worker.statsMutex);
+            worker.stats = stats;
+        }
+    }
+
+    // Played on with stand-in inputs to a point spread by match id, as if the match had been running
+    void warmUp(Match& match) {
+        startGame(match);
+        match.active = true;
+        std::uint32_t ticks = static_cast<std::uint32_t>((match.id * 2654435761ull) % (config.warmupTicks + 1));
+        for (std::uint32_t i = 0; i < ticks; ++i) {
+            std::uint32_t tick = static_cast<std::uint32_t>(match.simulation.getTick());
+            std::uint8_t inputs[Simulation::maxPlayers] = { getStandInInput(0, tick + match.id), getStandInInput(1, tick + match.id) };
+            match.simulation.step(inputs);
+            GameState state = match.simulation.getState();
+            if (state == GameState::GameOver || state == GameState::Victory) {
+                startGame(match);
+            }
+        }
+    }
+
+    void receiveAll(Worker& worker, std::uint64_t tick, Stats& stats) {
+        std::uint8_t data[ConditionedLink::maxDatagramSize];
+        NetAddress from;
+        int size;
+        while ((size = worker.socket.receive(data, sizeof(data), from)) >= 0) {
+            InputDatagram datagram;
+            if (static_cast<std::size_t>(size) < sizeof(datagram)) continue;
+            std::memcpy(&datagram, data, sizeof(datagram));
+            if (datagram.magic != inputMagic || datagram.player >= Simulation::maxPlayers ||
+                datagram.matchId >= static_cast<std::uint32_t>(config.matchCount) ||
+                datagram.matchId % config.threadCount != static_cast<std::uint32_t>(worker.index)) continue;
+            ++stats.datagramsReceived;
+
+            // A forged source address never sees the challenge, so it never gets as far as a seat
+            int player = datagram.player;
+            std::uint32_t token = getToken(from, datagram.matchId, player);
+            if (datagram.token != token) {
+                ChallengeDatagram challenge = { challengeMagic, datagram.player, {}, datagram.matchId, token };
+                worker.socket.send(from, reinterpret_cast<const std::uint8_t*>(&challenge), sizeof(challenge));
+                ++stats.challengesSent;
+                continue;
+            }
+
+            Match& match = worker.matches[datagram.matchId / config.threadCount];
+            if (!match.active) {
+                // The first word from anyone starts a fresh game
+                startGame(match);
+                match.active = true;
+                std::fill(std::begin(match.inputs), std::end(match.inputs), 0);
+                std::fill(std::begin(match.clientKnown), std::end(match.clientKnown), false);
+            }
+
+            // A seat held by a client still being heard from is not up for grabs
+            bool newClient = !match.clientKnown[player] || match.clients[player] != from;
+            if (newClient && match.clientKnown[player] && tick - match.clientHeardTicks[player] <= clientTimeoutTicks) continue;
+
+            if (newClient || static_cast<std::int32_t>(datagram.sequence - match.sequences[player]) > 0) {
+                match.inputs[player] = datagram.input;
+                match.sequences[player] = datagram.sequence;
+            }
+            match.clients[player] = from;
+            match.clientKnown[player] = true;
+            match.clientHeardTicks[player] = tick;
+            match.lastHeardTick = tick;
+        }
+    }
+
+    void updateMatch(Worker& worker, Match& match, std::uint64_t tick, Stats& stats) {
+        if (!match.active) return;
+        if (tick - match.lastHeardTick > idleTicks) {
+            match.active = false;
+            return;
+        }
+        ++stats.activeMatches;
+
+        match.simulation.step(match.inputs);
+        ++stats.matchTicks;
+        GameState state = match.simulation.getState();
+        if (state == GameState::GameOver || state == GameState::Victory) {
+            ++stats.gamesFinished;
+            startGame(match);
+        }
+
+        // Staggered by id, so a worker's summaries do not all go out on the same tick
+        if ((tick + match.id) % config.stateInterval != 0) return;
+        const Simulation& simulation = match.simulation;
+        StateDatagram datagram = {};
+        datagram.magic = stateMagic;
+        datagram.gameState = static_cast<std::uint8_t>(simulation.getState());
+        datagram.matchId = match.id;
+        datagram.gameCount = match.gameCount;
+        datagram.tick = static_cast<std::uint32_t>(simulation.getTick());
+        datagram.score = simulation.getPlayer().score;
+        datagram.level = simulation.getLevel().getCurrentLevel();
+        for (int player = 0; player < Simulation::maxPlayers; ++player) {
+            datagram.health[player] = static_cast<std::int16_t>(simulation.getPlayer(player).health);
+        }
+        datagram.enemyCount = static_cast<std::uint16_t>(std::min<std::size_t>(simulation.getEnemies().size(), 0xFFFF));
+        for (int player = 0; player < Simulation::maxPlayers; ++player) {
+            if (!match.clientKnown[player] || tick - match.clientHeardTicks[player] > clientTimeoutTicks) continue;
+            datagram.player = static_cast<std::uint8_t>(player);
+            datagram.ackSequence = match.sequences[player];
+            worker.socket.send(match.clients[player], reinterpret_cast<const std::uint8_t*>(&datagram), sizeof(datagram));
+            ++stats.datagramsSent;
+        }
+    }
+
+    Config config;
+    std::uint64_t idleTicks = 0;
+    std::uint64_t clientTimeoutTicks = 0;
+    std::uint64_t tokenKey[2] = {};             // Drawn at start; every seat's token is keyed by it
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::chrono::steady_clock::time_point epoch;    // Tick k of every worker is due at epoch + k ticks
+    std::atomic<bool> stopping;
+    std::atomic<int> readyCount;
+};
+
+// Stand-in clients - bots playing both sides of every match on a match server over UDP, for load
+// tests and for trying a server with no players around. Matches share client sockets in groups.
+// Each bot sends its input every sendInterval ticks, steering by the tick the server last reported.
+class StandInClients {
+public:
+    static constexpr int matchesPerSocket = 64;
+
+    struct Stats {
+        std::uint64_t datagramsSent = 0;
+        std::uint64_t statesReceived = 0;
+        std::uint64_t latencySamples = 0;
+        double latencySum = 0.0;    // Milliseconds from sending an input to a summary of a match running on it
+        double latencyMax = 0.0;
+    };
+
+    // Match i is reached on ports[i % ports.size()], as the server assigns matches to workers
+    bool open(const char* address, const std::vector<std::uint16_t>& ports, int matchCount, int sendInterval = 3) {
+        servers.clear();
+        for (std::uint16_t port : ports) {
+            NetAddress server;
+            if (!resolveAddress(address, port, server)) return false;
+            servers.push_back(server);
+        }
+        if (servers.empty()) return false;
+
+        sockets.clear();
+        for (int i = 0; i < (std::max(matchCount, 0) + matchesPerSocket - 1) / matchesPerSocket; ++i) {
+            sockets.emplace_back(new UdpSocket());
+            if (!sockets.back()->open(0)) return false;
+            sockets.back()->setReceiveBufferSize(1 << 20);
+        }
+
+        // Sends spread evenly over the interval from the first update on
+        intervalMs = std::max(sendInterval, 1) * Simulation::tickSeconds * 1000.0;
+        matches.assign(std::max(matchCount, 0), MatchClient());
+        for (std::size_t i = 0; i < matches.size(); ++i) {
+            matches[i].nextSend = intervalMs * i / matches.size();
+        }
+        started = false;
+        stats = Stats();
+        return true;
+    }
+
+    // Takes in the server's summaries and sends whatever inputs are due; call it often
+    void update(double now) {
+        if (!started) {
+            for (MatchClient& match : matches) {
+                match.nextSend += now;
+            }
+            started = true;
+        }
+
+        std::uint8_t data[ConditionedLink::maxDatagramSize];
+        NetAddress from;
+        for (std::unique_ptr<UdpSocket>& socket : sockets) {
+            int size;
+            while ((size = socket->receive(data, sizeof(data), from)) >= 0) {
+                receive(data, static_cast<std::size_t>(size), now);
+            }
+        }
+
+        for (std::size_t i = 0; i < matches.size(); ++i) {
+            MatchClient& match = matches[i];
+            if (now < match.nextSend) continue;
+            // After a stall the schedule moves on rather than sending a burst
+            match.nextSend = std::max(match.nextSend + intervalMs, now);
+
+            for (int player = 0; player < Simulation::maxPlayers; ++player) {
+                std::uint32_t sequence = ++match.sequences[player];
+                match.sendTimes[player][sequence % historySize] = now;
+                MatchServer::InputDatagram datagram = { MatchServer::inputMagic, static_cast<std::uint8_t>(player),
+                                                        MatchServer::getStandInInput(player, match.serverTick + static_cast<std::uint32_t>(i)),
+                                                        0, static_cast<std::uint32_t>(i), sequence, match.tokens[player] };
+                sockets[i / matchesPerSocket]->send(servers[i % servers.size()], reinterpret_cast<const std::uint8_t*>(&datagram), sizeof(datagram));
+                ++stats.datagramsSent;
+            }
+        }
+    }
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    static constexpr std::uint32_t historySize = 16;
+
+    struct MatchClient {
+        double nextSend = 0.0;
+        std::uint32_t serverTick = 0;
+        std::uint32_t sequences[Simulation::maxPlayers] = {};
+        std::uint32_t acked[Simulation::maxPlayers] = {};
+        std::uint32_t tokens[Simulation::maxPlayers] = {};     // From the server's challenges
+        double sendTimes[Simulation::maxPlayers][historySize] = {};
+    };
+
+    void receive(const std::uint8_t* data, std::size_t size, double now) {
+        if (size > 0 && data[0] == MatchServer::challengeMagic) {
+            // Sent with every input from now on; the one that drew the challenge was not taken
+            MatchServer::ChallengeDatagram challenge;
+            if (size < sizeof(challenge)) return;
+            std::memcpy(&challenge, data, sizeof(challenge));
+            if (challenge.matchId >= matches.size() || challenge.player >= Simulation::maxPlayers) return;
+            matches[challenge.matchId].tokens[challenge.player] = challenge.token;
+            return;
+        }
+
+        MatchServer::StateDatagram datagram;
+        if (size < sizeof(datagram)) return;
+        std::memcpy(&datagram, data, sizeof(datagram));
+        if (datagram.magic != MatchServer::stateMagic || datagram.matchId >= matches.size() || datagram.player >= Simulation::maxPlayers) return;
+        ++stats.statesReceived;
+
+        MatchClient& match = matches[datagram.matchId];
+        match.serverTick = datagram.tick;
+
+        // The first summary that shows an input in use measures its trip
+        int player = datagram.player;
+        std::uint32_t ack = datagram.ackSequence;
+        if (ack > match.acked[player] && ack <= match.sequences[player] && match.sequences[player] - ack < historySize) {
+            double latency = now - match.sendTimes[player][ack % historySize];
+            ++stats.latencySamples;
+            stats.latencySum += latency;
+            stats.latencyMax = std::max(stats.latencyMax, latency);
+            match.acked[player] = ack;
+        }
+    }
+
+    std::vector<NetAddress> servers;
+    std::vector<std::unique_ptr<UdpSocket>> sockets;
+    std::vector<MatchClient> matches;
+    double intervalMs = 50.0;
+    bool started = false;
+    Stats stats;
+};
+
+// Options shared by --server and --stand-in-clients from argv[first] on: [port] --matches <n> --server-threads <n>
+void parseMatchServerOptions(int argc, char* argv[], int first, MatchServer::Config& config) {
+    for (int i = first; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--matches" && i + 1 < argc) {
+            config.matchCount = std::atoi(argv[++i]);
+        } else if (option == "--server-threads" && i + 1 < argc) {
+            config.threadCount = std::max(1, std::atoi(argv[++i]));
+        } else if (i == first && option[0] != '-') {
+            config.port = static_cast<std::uint16_t>(std::atoi(argv[i]));
+        }
+    }
+}
+
+// --server: serves matches until the process is stopped, printing the load every 10 seconds
+int runMatchServer(int argc, char* argv[]) {
+    MatchServer::Config config;
+    config.threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    parseMatchServerOptions(argc, argv, 2, config);
+
+    MatchServer server;
+    if (!server.start(config)) {
+        std::cerr << "Could not open UDP ports " << config.port << "-" << config.port + config.threadCount - 1 << std::endl;
+        return 1;
+    }
+    std::cout << "Serving " << config.matchCount << " matches on " << config.threadCount << " worker thread"
+              << (config.threadCount == 1 ? "" : "s") << ", UDP ports " << config.port << "-" << config.port + config.threadCount - 1
+              << "; match n is on port " << config.port << " + n % " << config.threadCount << std::endl;
+
+    const double reportSeconds = 10.0;
+    MatchServer::Stats last;
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(reportSeconds));
+        MatchServer::Stats stats = server.getStats();
+        std::uint64_t matchTicks = stats.matchTicks - last.matchTicks;
+        double busy = stats.busySeconds - last.busySeconds;
+        std::cout << stats.activeMatches << " active matches, " << std::fixed << std::setprecision(1)
+                  << 100.0 * busy / (reportSeconds * config.threadCount) << "% of worker time busy, "
+                  << busy * 1e6 / std::max<std::uint64_t>(matchTicks, 1) << " us per match tick, " << std::setprecision(0)
+                  << (stats.datagramsReceived - last.datagramsReceived) / reportSeconds << " datagrams/s in, "
+                  << (stats.datagramsSent - last.datagramsSent) / reportSeconds << " out, "
+                  << (stats.challengesSent - last.challengesSent) / reportSeconds << " challenges/s, "
+                  << stats.lateTicks - last.lateTicks << " late ticks, " << stats.gamesFinished - last.gamesFinished << " games finished, "
+                  << stats.matchBytes / 1024 << " KB held by matches" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
+        last = stats;
+    }
+}
+
+// --stand-in-clients <address>: bots for every match of a server until the process is stopped.
+// --server-threads has to match the server's, since it decides which port each match is on; both
+// default to the number of hardware threads.
+int runStandInClients(int argc, char* argv[]) {
+    MatchServer::Config config;
+    const char* address = argv[2];
+    config.threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    parseMatchServerOptions(argc, argv, 3, config);
+
+    std::vector<std::uint16_t> ports;
+    for (int i = 0; i < config.threadCount; ++i) {
+        ports.push_back(static_cast<std::uint16_t>(config.port + i));
+    }
+    StandInClients clients;
+    if (!clients.open(address, ports, config.matchCount)) {
+        std::cerr << "Could not reach " << address << " over UDP" << std::endl;
+        return 1;
+    }
+    std::cout << "Playing " << config.matchCount << " matches on " << address << ":" << config.port << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    double nextReport = 10000.0;
+    StandInClients::Stats last;
+    for (;;) {
+        double now = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        clients.update(now);
+        if (now >= nextReport) {
+            const StandInClients::Stats& stats = clients.getStats();
+            std::uint64_t samples = stats.latencySamples - last.latencySamples;
+            std::cout << (stats.statesReceived - last.statesReceived) / 10 << " summaries/s received, input to summary "
+                      << static_cast<int>((stats.latencySum - last.latencySum) / std::max<std::uint64_t>(samples, 1)) << " ms avg, "
+                      << static_cast<int>(stats.latencyMax) << " ms max" << std::endl;
+            last = stats;
+            nextReport += 10000.0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// SpriteBatch - textured quads for a single texture collected into one vertex array,
+// so a whole screen of text and bars goes out in one draw call.
+class SpriteBatch {
+public:
+    SpriteBatch() : texture(nullptr), vertices(sf::Triangles) {}
+
+    void setTexture(const sf::Texture* batchTexture) { texture = batchTexture; }
+
+    void clear() { vertices.clear(); }
+
+    void addQuad(const sf::FloatRect& rect, const sf::FloatRect& texRect, const sf::Color& color) {
+        sf::Vector2f topLeft(rect.left, rect.top), bottomRight(rect.left + rect.width, rect.top + rect.height);
+        sf::Vector2f texTopLeft(texRect.left, texRect.top), texBottomRight(texRect.left + texRect.width, texRect.top + texRect.height);
+
+        vertices.append(sf::Vertex(topLeft, color, texTopLeft));
+        vertices.append(sf::Vertex(sf::Vector2f(bottomRight.x, topLeft.y), color, sf::Vector2f(texBottomRight.x, texTopLeft.y)));
+        vertices.append(sf::Vertex(sf::Vector2f(topLeft.x, bottomRight.y), color, sf::Vector2f(texTopLeft.x, texBottomRight.y)));
+        vertices.append(sf::Vertex(sf::Vector2f(topLeft.x, bottomRight.y), color, sf::Vector2f(texTopLeft.x, texBottomRight.y)));
+        vertices.append(sf::Vertex(sf::Vector2f(bottomRight.x, topLeft.y), color, sf::Vector2f(texBottomRight.x, texTopLeft.y)));
+        vertices.append(sf::Vertex(bottomRight, color, texBottomRight));
+    }
+
+    std::size_t getQuadCount() const { return vertices.getVertexCount() / 6; }
+
+    void draw(sf::RenderWindow& window) const {
+        if (texture && vertices.getVertexCount() > 0) {
+            window.draw(vertices, texture);
+        }
+    }
+
+private:
+    const sf::Texture* texture;
+    sf::VertexArray vertices;
+};
+
+// GlyphAtlas - printable ASCII for every text size the game uses, rasterized once at startup
+// and packed into one texture with its metrics and kerning. Laying out text afterwards never
+// goes back to FreeType.
+class GlyphAtlas {
+public:
+    static constexpr unsigned sizes[] = { 18, 24, 32, 48, 64 };
+    static constexpr std::size_t sizeCount = sizeof(sizes) / sizeof(sizes[0]);
+
+    GlyphAtlas() : loaded(false), lineSpacing{} {}
+
+    bool build(const sf::Font& font) {
+        const unsigned atlasWidth = 1024;
+        std::vector<sf::Image> pages(sizeCount);
+
+        // Rasterize every glyph first and shelf-pack its rectangle. The top-left 2x2 stays
+        // white for untextured quads.
+        unsigned penX = 3, penY = 0, shelfHeight = 2;
+        for (std::size_t s = 0; s < sizeCount; ++s) {
+            kerning[s].assign(charCount * charCount, 0.f);
+            for (int c = firstChar; c <= lastChar; ++c) {
+                const sf::Glyph& source = font.getGlyph(c, sizes[s], false);
+                BakedGlyph& glyph = glyphs[s][c - firstChar];
+                glyph.advance = source.advance;
+                glyph.bounds = source.bounds;
+                glyph.source = source.textureRect;
+
+                unsigned width = static_cast<unsigned>(source.textureRect.width);
+                unsigned height = static_cast<unsigned>(source.textureRect.height);
+                if (penX + width > atlasWidth) {
+                    penX = 0;
+                    penY += shelfHeight + 1;
+                    shelfHeight = 0;
+                }
+                glyph.textureRect = sf::FloatRect(static_cast<float>(penX), static_cast<float>(penY),
+                                                  static_cast<float>(width), static_cast<float>(height));
+                penX += width + 1;
+                shelfHeight = std::max(shelfHeight, height);
+
+                for (int next = firstChar; next <= lastChar; ++next) {
+                    kerning[s][(c - firstChar) * charCount + (next - firstChar)] = font.getKerning(c, next, sizes[s]);
+                }
+            }
+            lineSpacing[s] = font.getLineSpacing(sizes[s]);
+            pages[s] = font.getTexture(sizes[s]).copyToImage();
+        }
+
+        sf::Image image;
+        image.create(atlasWidth, penY + shelfHeight, sf::Color(255, 255, 255, 0));
+        for (unsigned y = 0; y < 2; ++y) {
+            for (unsigned x = 0; x < 2; ++x) {
+                image.setPixel(x, y, sf::Color::White);
+            }
+        }
+        for (std::size_t s = 0; s < sizeCount; ++s) {
+            for (const BakedGlyph& glyph : glyphs[s]) {
+                if (glyph.source.width > 0 && glyph.source.height > 0) {
+                    image.copy(pages[s], static_cast<unsigned>(glyph.textureRect.left), static_cast<unsigned>(glyph.textureRect.top), glyph.source);
+                }
+            }
+        }
+
+        loaded = texture.loadFromImage(image);
+        return loaded;
+    }
+
+    bool isLoaded() const { return loaded; }
+
+    const sf::Texture& getTexture() const { return texture; }
+
+    // Texture coordinates of an opaque white texel, for bars and backgrounds
+    static sf::FloatRect getWhiteRect() { return sf::FloatRect(1.f, 1.f, 0.f, 0.f); }
+
+    // Lay text out like sf::Text: (x, y) is the top-left and the first baseline sits characterSize
+    // below it. Sizes that were not baked are scaled from the next larger baked size.
+    sf::Vector2f appendText(SpriteBatch& batch, const std::string& text, sf::Vector2f position,
+                            unsigned characterSize, const sf::Color& color) const {
+        if (!loaded) return sf::Vector2f(0.f, 0.f);
+
+        std::size_t s = findSize(characterSize);
+        float scale = static_cast<float>(characterSize) / sizes[s];
+        float x = position.x;
+        float baseline = position.y + characterSize;
+        float width = 0.f;
+        int previous = -1;
+
+        for (char c : text) {
+            if (c == '\n') {
+                width = std::max(width, x - position.x);
+                x = position.x;
+                baseline += lineSpacing[s] * scale;
+                previous = -1;
+                continue;
+            }
+
+            int index = static_cast<unsigned char>(c) - firstChar;
+            if (index < 0 || index >= charCount) {
+                index = '?' - firstChar;
+            }
+            if (previous >= 0) {
+                x += kerning[s][previous * charCount + index] * scale;
+            }
+            previous = index;
+
+            const BakedGlyph& glyph = glyphs[s][index];
+            if (c != ' ') {
+                sf::FloatRect rect(x + glyph.bounds.left * scale, baseline + glyph.bounds.top * scale,
+                                   glyph.bounds.width * scale, glyph.bounds.height * scale);
+                batch.addQuad(rect, glyph.textureRect, color);
+            }
+            x += glyph.advance * scale;
+        }
+
+        width = std::max(width, x - position.x);
+        return sf::Vector2f(width, baseline - position.y);
+    }
+
+private:
+    static constexpr int firstChar = 32;
+    static constexpr int lastChar = 126;
+    static constexpr int charCount = lastChar - firstChar + 1;
+
+    struct BakedGlyph {
+        float advance = 0.f;
+        sf::FloatRect bounds;
+        sf::FloatRect textureRect;
+        sf::IntRect source;
+    };
+
+    static std::size_t findSize(unsigned characterSize) {
+        for (std::size_t s = 0; s < sizeCount; ++s) {
+            if (sizes[s] >= characterSize) return s;
+        }
+        return sizeCount - 1;
+    }
+
+    bool loaded;
+    sf::Texture texture;
+    BakedGlyph glyphs[sizeCount][charCount];
+    std::vector<float> kerning[sizeCount];
+    float lineSpacing[sizeCount];
+};
+
+// Sprite sheet layout for a flipbook: equal frames read row by row
+struct FlipbookSheet {
+    int columns;
+    int rows;
+    float frameTime;
+};
+
+// explosion.png: 3x4 frames of 256x128, played at 20 frames per second
+constexpr FlipbookSheet explosionSheet = { 3, 4, 0.05f };
+
+// Flipbook effects - every running instance of one sprite-sheet animation. Frame rectangles are
+// computed once and shared; an instance is just where, when and how big, and its frame follows from
+// the elapsed time. All instances are drawn as one batch.
+class FlipbookEffects {
+public:
+    FlipbookEffects() : frameTime(0.f), time(0.f) {}
+
+    bool setSheet(const sf::Texture& texture, const FlipbookSheet& sheet) {
+        frames.clear();
+        batch.setTexture(&texture);
+        frameTime = sheet.frameTime;
+
+        sf::Vector2u size = texture.getSize();
+        float frameWidth = static_cast<float>(size.x / sheet.columns);
+        float frameHeight = static_cast<float>(size.y / sheet.rows);
+        if (frameWidth <= 0 || frameHeight <= 0) {
+            return false;
+        }
+        for (int row = 0; row < sheet.rows; ++row) {
+            for (int column = 0; column < sheet.columns; ++column) {
+                frames.emplace_back(column * frameWidth, row * frameHeight, frameWidth, frameHeight);
+            }
+        }
+        return true;
+    }
+
+    bool isReady() const { return !frames.empty(); }
+
+    // scale is relative to the frame size in the sheet
+    void spawn(const sf::Vector2f& position, float scale) {
+        if (isReady()) {
+            instances.push_back(Instance{ position, time, scale });
+        }
+    }
+
+    void update(float deltaTime) {
+        time += deltaTime;
+        float duration = frameTime * frames.size();
+
+        // Order does not matter, so finished instances are swapped out
+        for (std::size_t i = 0; i < instances.size();) {
+            if (time - instances[i].startTime >= duration) {
+                instances[i] = instances.back();
+                instances.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    void draw(sf::RenderWindow& window) {
+        if (instances.empty()) return;
+
+        batch.clear();
+        for (const Instance& instance : instances) {
+            std::size_t frame = std::min(static_cast<std::size_t>((time - instance.startTime) / frameTime), frames.size() - 1);
+            const sf::FloatRect& texRect = frames[frame];
+            float width = texRect.width * instance.scale;
+            float height = texRect.height * instance.scale;
+            batch.addQuad(sf::FloatRect(instance.position.x - width / 2, instance.position.y - height / 2, width, height),
+                          texRect, sf::Color::White);
+        }
+        batch.draw(window);
+    }
+
+    void clear() { instances.clear(); }
+
+    bool empty() const { return instances.empty(); }
+
+    std::size_t size() const { return instances.size(); }
+
+private:
+    struct Instance {
+        sf::Vector2f position;
+        float startTime;
+        float scale;
+    };
+
+    std::vector<sf::FloatRect> frames;
+    float frameTime;
+    float time;
+    std::vector<Instance> instances;
+    SpriteBatch batch;
+};
+
+// Effect quality: particles look best, the flipbook is one quad per effect, and automatic switches
+// to the flipbook while a heavy wave has many particle effects alive
+enum class EffectQuality {
+    Automatic,
+    Particles,
+    Flipbook
+};
+
+// Quality levels the governor steps through, from full detail to cheapest
+struct QualityLevel {
+    const char* name;
+    int particlesPerExplosion;
+    float particleLifetimeScale;
+    EffectQuality explosionQuality; // Used while the player leaves explosions on automatic
+    int hudRefreshInterval;         // Frames between HUD rebuilds
+    bool drawBackground;
+};
+
+constexpr QualityLevel qualityLevels[] = {
+    { "full",    30, 1.0f, EffectQuality::Automatic, 1, true },
+    { "high",    20, 0.8f, EffectQuality::Automatic, 1, true },
+    { "medium",  12, 0.6f, EffectQuality::Automatic, 2, true },
+    { "low",      8, 0.5f, EffectQuality::Flipbook,  3, true },
+    { "minimal",  8, 0.5f, EffectQuality::Flipbook,  4, false }
+};
+constexpr int qualityLevelCount = static_cast<int>(sizeof(qualityLevels) / sizeof(qualityLevels[0]));
+
+// Quality governor - compares the smoothed update + render time of each frame with the frame budget.
+// It steps quality down after a sustained stretch over 90% of the budget and back up only after a
+// longer stretch under 60%, and waits after every change so the averages can settle.
+class QualityGovernor {
+public:
+    explicit QualityGovernor(float budgetMs) : budgetMs(budgetMs), level(0), overFrames(0), underFrames(0), settleFrames(0) {}
+
+    void setBudget(float newBudgetMs) { budgetMs = newBudgetMs; }
+    float getBudget() const { return budgetMs; }
+
+    // Returns true when the level changed
+    bool update(double frameWorkMs) {
+        if (settleFrames > 0) {
+            --settleFrames;
+            return false;
+        }
+
+        if (frameWorkMs > budgetMs * overBudget) {
+            ++overFrames;
+            underFrames = 0;
+        } else if (frameWorkMs < budgetMs * headroom) {
+            ++underFrames;
+            overFrames = 0;
+        } else {
+            overFrames = underFrames = 0;
+        }
+
+        int previous = level;
+        if (overFrames >= stepDownFrames && level < qualityLevelCount - 1) {
+            ++level;
+        } else if (underFrames >= stepUpFrames && level > 0) {
+            --level;
+        }
+        if (level == previous) {
+            return false;
+        }
+
+        overFrames = underFrames = 0;
+        settleFrames = settleAfterChange;
+        return true;
+    }
+
+    const QualityLevel& getLevel() const { return qualityLevels[level]; }
+
+private:
+    static constexpr double overBudget = 0.9;
+    static constexpr double headroom = 0.6;
+    static constexpr int stepDownFrames = 30;
+    static constexpr int stepUpFrames = 180;
+    static constexpr int settleAfterChange = 60;
+
+    float budgetMs;
+    int level;
+    int overFrames;
+    int underFrames;
+    int settleFrames;
+};
+
+// Profiler - wall time per named section, smoothed across frames. F3 toggles the overlay.
+class Profiler {
+public:
+    // Adds the time spent in the enclosing block to a section
+    class Scope {
+    public:
+        Scope(Profiler& profiler, const char* name)
+            : profiler(profiler), section(profiler.getSection(name)), start(std::chrono::steady_clock::now()) {}
+
+        ~Scope() {
+            profiler.sections[section].frameTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    private:
+        Profiler& profiler;
+        std::size_t section;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    Profiler() : atlas(nullptr), overlayVisible(false), frameCount(0) {}
+
+    void setAtlas(const GlyphAtlas& glyphAtlas) {
+        atlas = &glyphAtlas;
+        overlay.setTexture(&glyphAtlas.getTexture());
+    }
+
+    // Fold this frame's section times into the running averages
+    void endFrame() {
+        for (auto& section : sections) {
+            section.smoothedTime = frameCount == 0 ? section.frameTime : section.smoothedTime * 0.95 + section.frameTime * 0.05;
+            section.frameTime = 0.0;
+        }
+        ++frameCount;
+
+        // The overlay is text too, so only refresh it a few times per second
+        if (overlayVisible && atlas && frameCount % 15 == 0) {
+            std::ostringstream lines;
+            lines << std::fixed << std::setprecision(3);
+            for (const auto& section : sections) {
+                lines << std::left << std::setw(8) << section.name << std::right << std::setw(8) << section.smoothedTime << " ms\n";
+            }
+            lines << note;
+            overlay.clear();
+            atlas->appendText(overlay, lines.str(), sf::Vector2f(620.f, 10.f), 14, sf::Color::White);
+        }
+    }
+
+    double getSmoothedTime(const char* name) const {
+        for (const auto& section : sections) {
+            if (std::strcmp(section.name, name) == 0) return section.smoothedTime;
+        }
+        return 0.0;
+    }
+
+    // Extra text shown under the section times
+    void setNote(const std::string& text) { note = text; }
+
+    void toggleOverlay() { overlayVisible = !overlayVisible; }
+    bool isOverlayVisible() const { return overlayVisible; }
+
+    void drawOverlay(sf::RenderWindow& window) const {
+        if (overlayVisible) {
+            overlay.draw(window);
+        }
+    }
+
+private:
+    struct Section {
+        const char* name;
+        double frameTime;
+        double smoothedTime;
+    };
+
+    std::size_t getSection(const char* name) {
+        for (std::size_t i = 0; i < sections.size(); ++i) {
+            if (std::strcmp(sections[i].name, name) == 0) return i;
+        }
+        sections.push_back({ name, 0.0, 0.0 });
+        return sections.size() - 1;
+    }
+
+    std::vector<Section> sections;
+    const GlyphAtlas* atlas;
+    bool overlayVisible;
+    std::uint64_t frameCount;
+    std::string note;
+    SpriteBatch overlay;
+};
+
+// HUD - score, level, health and shield bars and the weapon name, built into a single vertex
+// array and drawn with one call. Geometry is only rebuilt when a displayed value changes.
+class Hud {
+public:
+    Hud() : atlas(nullptr), score(-1), level(-1), health(-1), shieldWidth(-1), weaponName(nullptr) {}
+
+    void setAtlas(const GlyphAtlas& glyphAtlas) {
+        atlas = &glyphAtlas;
+        batch.setTexture(&glyphAtlas.getTexture());
+        score = -1; // Force a rebuild
+    }
+
+    // Returns true when the geometry had to be rebuilt
+    bool update(int newScore, int newLevel, int newHealth, float shieldHealth, const char* newWeaponName) {
+        // The shield drains continuously, so compare it at the pixel width it is drawn with
+        int newShieldWidth = static_cast<int>(barWidth * std::max(0.0f, shieldHealth) / 100.0f);
+        if (newScore == score && newLevel == level && newHealth == health && newShieldWidth == shieldWidth &&
+            newWeaponName == weaponName) {
+            return false;
+        }
+
+        score = newScore;
+        level = newLevel;
+        health = newHealth;
+        shieldWidth = newShieldWidth;
+        weaponName = newWeaponName;
+        rebuild();
+        return true;
+    }
+
+    void draw(sf::RenderWindow& window) const {
+        batch.draw(window);
+    }
+
+private:
+    static constexpr float barWidth = 200.0f;
+
+    void rebuild() {
+        batch.clear();
+        if (!atlas) return;
+
+        appendText("Score: " + std::to_string(score), 10.f, 10.f, 24, sf::Color::White);
+        appendText("Level: " + std::to_string(level), 10.f, 40.f, 24, sf::Color::White);
+
+        // Health bar, colored by how much is left
+        float healthPercent = static_cast<float>(health) / 100.0f;
+        sf::Color healthColor = healthPercent > 0.6f ? sf::Color::Green : healthPercent > 0.3f ? sf::Color::Yellow : sf::Color::Red;
+        appendRect(sf::FloatRect(10.f, 70.f, barWidth, 20.f), sf::Color(100, 100, 100));
+        appendRect(sf::FloatRect(10.f, 70.f, barWidth * healthPercent, 20.f), healthColor);
+
+        // Shield bar
+        appendRect(sf::FloatRect(10.f, 95.f, barWidth, 10.f), sf::Color(100, 100, 100));
+        appendRect(sf::FloatRect(10.f, 95.f, static_cast<float>(shieldWidth), 10.f), sf::Color::Cyan);
+
+        appendText(std::string("Weapon: ") + weaponName, 10.f, 110.f, 18, sf::Color::White);
+    }
+
+    void appendRect(const sf::FloatRect& rect, const sf::Color& color) {
+        if (rect.width > 0) {
+            batch.addQuad(rect, GlyphAtlas::getWhiteRect(), color);
+        }
+    }
+
+    void appendText(const std::string& text, float x, float y, unsigned characterSize, const sf::Color& color) {
+        atlas->appendText(batch, text, sf::Vector2f(x, y), characterSize, color);
+    }
+
+    const GlyphAtlas* atlas;
+    SpriteBatch batch;
+    int score;
+    int level;
+    int health;
+    int shieldWidth;
+    const char* weaponName;
+};
+
+// Startup times are measured from static initialization, before main() runs
+const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+
+// Game class to manage the game state
+class Game {
+public:
+    Game() : window(sf::VideoMode(800, 600), "Space Shooter"), gameState(GameState::MainMenu), deltaTime(0.0f), paused(false),
+             redrawNeeded(true) {
+        window.setFramerateLimit(60);
+        
+        // Start decoding assets; run() shows the loading screen until they are ready
+        queueAssets();
+    }
+    
+    // Frame rate the game runs at; the quality governor budgets update + render to one frame of it
+    void setTargetFrameRate(unsigned frameRate) {
+        window.setFramerateLimit(frameRate);
+        governor.setBudget(1000.0f / frameRate);
+    }
+    
+    // Publish the simulation state to other processes after every tick (POSIX only)
+    bool enableStateExport() {
+        return stateExport.open();
+    }
+    
+    // Save every finished game as a replay file in 'directory'
+    void enableReplayRecording(const std::string& directory) {
+#if defined(__unix__) || defined(__APPLE__)
+        mkdir(directory.c_str(), 0755);
+#endif
+        replayDirectory = directory;
+    }
+    
+    // Watch a replay instead of playing; false if the file is not a replay this build can read
+    bool openReplay(const char* path) {
+        return replay.open(path);
+    }
+    
+    // Co-op over UDP: host on 'port' or join a host; the game starts once both players are in
+    bool hostCoop(std::uint16_t port, const LockstepSession::Config& config) {
+        coopEnabled = coop.host(port, config);
+        return coopEnabled;
+    }
+    
+    bool joinCoop(const char* address, std::uint16_t port, const LockstepSession::Config& config) {
+        coopEnabled = coop.join(address, port, config);
+        return coopEnabled;
+    }
+    
+    // Reload textures and sounds whenever a file under assets/ is saved (Linux only)
+    bool enableAssetWatching() {
+        return assetWatcher.start({ "assets/images", "assets/images/enemies", "assets/images/weapons",
+                                    "assets/images/effects", "assets/sounds" });
+    }
+    
+    void run() {
+        showLoadingScreen();
+        bool interactiveLogged = false;
+        
+        while (window.isOpen()) {
+            // Nothing on screen can change without input, so sleep in the OS until an event arrives
+            if (isIdle() && !redrawNeeded) {
+                sf::Event event;
+                bool received = window.waitEvent(event);
+                
+                // Time spent waiting is not simulated
+                frameClock.restart();
+                if (received) {
+                    handleEvent(event);
+                }
+            }
+            
+            handleEvents();
+            if (assetWatcher.isRunning()) {
+                applyAssetReloads();
+            }
+            deltaTime = frameClock.restart().asSeconds();
+            
+            // Explosions still finishing on an end screen keep it animating for one more frame
+            bool animating = !isIdle();
+            {
+                Profiler::Scope scope(profiler, "update");
+                update();
+            }
+            audio.endTick();
+            
+            if (!animating && isIdle() && !redrawNeeded) {
+                continue;
+            }
+            redrawNeeded = false;
+            
+            {
+                Profiler::Scope scope(profiler, "render");
+                render();
+            }
+            
+            // Presenting waits for the frame limit, so it is kept out of the render section
+            window.display();
+            profiler.endFrame();
+            updateQuality();
+            
+            if (!interactiveLogged) {
+                logStartupTime("time to interactive");
+                interactiveLogged = true;
+            }
+        }
+    }
+
+private:
+    void queueAssets() {
+        // Anything missing from the pack (or no pack at all) falls back to the loose files
+        if (assetPack.open(assetPackPath)) {
+            assets.setPack(&assetPack);
+        }
+        
+        assets.addFont(fontPath, font);
+        for (int i = 0; i < static_cast<int>(TextureId::Count); ++i) {
+            assets.addTexture(static_cast<TextureId>(i));
+        }
+        assets.addTexture(backgroundPath, backgroundTexture, sf::Vector2u(800, 600));
+        assets.addTexture(explosionSheetPath, explosionTexture);
+        for (int i = 0; i < static_cast<int>(SoundId::Count); ++i) {
+            assets.addSound(static_cast<SoundId>(i));
+        }
+        assets.start();
+    }
+    
+    // Progress bar while the workers decode; finished assets are uploaded as they come in
+    void showLoadingScreen() {
+        sf::RectangleShape barBackground(sf::Vector2f(400.f, 20.f));
+        barBackground.setPosition(200.f, 290.f);
+        barBackground.setFillColor(sf::Color(100, 100, 100));
+        sf::RectangleShape bar;
+        bar.setPosition(200.f, 290.f);
+        bar.setFillColor(sf::Color::Cyan);
+        bool firstFrame = true;
+        
+        while (window.isOpen() && !assets.isFinished()) {
+            sf::Event event;
+            while (window.pollEvent(event)) {
+                if (event.type == sf::Event::Closed)
+                    window.close();
+            }
+            
+            assets.uploadFinished(audio);
+            bar.setSize(sf::Vector2f(400.f * assets.getProgress(), 20.f));
+            
+            window.clear();
+            window.draw(barBackground);
+            window.draw(bar);
+            window.display();
+            
+            if (firstFrame) {
+                logStartupTime("time to first frame");
+                firstFrame = false;
+            }
+        }
+        assets.uploadFinished(audio);
+        
+        finishLoading();
+    }
+    
+    void finishLoading() {
+        if (assetPack.isOpen()) {
+            std::cout << "Loaded " << assets.getPackedCount() << " assets from " << assetPackPath << std::endl;
+        }
+        
+        // Bake the glyph atlas all on-screen text is drawn from
+        if (font.getInfo().family.empty()) {
+            std::cerr << "No font loaded; text will not be drawn" << std::endl;
+        } else if (!glyphAtlas.build(font)) {
+            std::cerr << "Failed to build the glyph atlas from " << fontPath << std::endl;
+        }
+        
+        // Sound buffers are in place, so the mixer can start
+        audio.start();
+        
+        // Explosions are drawn from the sheet at several scales
+        explosionTexture.setSmooth(true);
+        bool explosionMipmapped = explosionTexture.generateMipmap();
+        explosionFlipbooks.setSheet(explosionTexture, explosionSheet);
+        
+        // Texture memory after load-time resampling, against uploading everything at source size
+        std::size_t uploadedBytes = 0, sourceBytes = 0;
+        TextureCache::getMemoryUsage(uploadedBytes, sourceBytes);
+        uploadedBytes += TextureCache::getTextureBytes(backgroundTexture.getSize(), false) +
+                         TextureCache::getTextureBytes(explosionTexture.getSize(), explosionMipmapped);
+        sourceBytes += TextureCache::getTextureBytes(assets.getSourceSize(backgroundTexture), false) +
+                       TextureCache::getTextureBytes(assets.getSourceSize(explosionTexture), false);
+        std::cout << "Textures: " << uploadedBytes / 1024 << " KB in video memory, " << sourceBytes / 1024
+                  << " KB at source size (" << (sourceBytes > uploadedBytes ? (sourceBytes - uploadedBytes) / 1024 : 0) << " KB saved)" << std::endl;
+        
+        // Scale background to fit window
+        background.setTexture(backgroundTexture, true);
+        float scaleX = 800.0f / backgroundTexture.getSize().x;
+        float scaleY = 600.0f / backgroundTexture.getSize().y;
+        background.setScale(scaleX, scaleY);
+        
+        // Entities are drawn through one sprite per shape, set up now that the textures are in place
+        setupShapeSprites();
+        
+        // Initialize UI elements
+        initializeUI();
+        redrawNeeded = true;
+        
+        if (replay.isOpen()) {
+            startReplay();
+        }
+    }
+    
+    // Feeds the governor the frame's work time (presenting is excluded; it only waits for the frame limit)
+    void updateQuality() {
+        double workMs = profiler.getSmoothedTime("update") + profiler.getSmoothedTime("render");
+        
+        if (governor.update(workMs)) {
+            const QualityLevel& quality = governor.getLevel();
+            std::cout << "Quality: " << quality.name << " (update + render " << std::fixed << std::setprecision(1) << workMs
+                      << " ms against a " << governor.getBudget() << " ms budget): " << quality.particlesPerExplosion
+                      << " particles per explosion, lifetime x" << std::setprecision(2) << quality.particleLifetimeScale
+                      << ", HUD every " << quality.hudRefreshInterval << " frame(s), background "
+                      << (quality.drawBackground ? "on" : "off") << std::endl;
+            std::cout << std::defaultfloat << std::setprecision(6);
+        }
+        
+        std::ostringstream note;
+        note << "quality " << governor.getLevel().name << "\nbudget " << std::fixed << std::setprecision(1) << governor.getBudget() << " ms\n";
+        profiler.setNote(note.str());
+    }
+    
+    // Swaps hot-reloaded assets in at the frame boundary and reports how long it took
+    void applyAssetReloads() {
+        std::vector<AssetWatcher::Reload> reloads = assetWatcher.takePending();
+        if (reloads.empty()) return;
+        
+        Profiler::Scope scope(profiler, "reload");
+        auto swapStart = std::chrono::steady_clock::now();
+        bool texturesChanged = false;
+        
+        for (AssetWatcher::Reload& reload : reloads) {
+            bool used = false;
+            if (!reload.ok) {
+                std::cerr << "Hot reload: could not decode " << reload.path << std::endl;
+                continue;
+            }
+            
+            if (reload.isSound) {
+                for (int i = 0; i < static_cast<int>(SoundId::Count); ++i) {
+                    if (reload.path == soundTable[i].path) {
+                        audio.reloadBuffer(static_cast<SoundId>(i), std::move(reload.samples), reload.channelCount, reload.sampleRate);
+                        used = true;
+                    }
+                }
+            } else {
+                sf::Vector2u size = reload.image.getSize();
+                for (int i = 0; i < static_cast<int>(TextureId::Count); ++i) {
+                    TextureId id = static_cast<TextureId>(i);
+                    if (reload.path == getTexturePath(id)) {
+                        sf::Image prepared = TextureCache::prepare(id, reload.image.getPixelsPtr(), size);
+                        TextureCache::upload(id, prepared.getSize().x, prepared.getSize().y, prepared.getPixelsPtr(), size);
+                        CollisionMaskCache::reload(id, reload.image);
+                        texturesChanged = used = true;
+                    }
+                }
+                if (reload.path == backgroundPath) {
+                    sf::Image resampled = downscaleArea(reload.image.getPixelsPtr(), size, 800, 600);
+                    if (backgroundTexture.loadFromImage(resampled.getSize().x > 0 ? resampled : reload.image)) {
+                        background.setTexture(backgroundTexture, true);
+                        background.setScale(800.0f / backgroundTexture.getSize().x, 600.0f / backgroundTexture.getSize().y);
+                        used = true;
+                    }
+                }
+                if (reload.path == explosionSheetPath && explosionTexture.loadFromImage(reload.image)) {
+                    explosionTexture.generateMipmap();
+                    explosionFlipbooks.setSheet(explosionTexture, explosionSheet);
+                    used = true;
+                }
+            }
+            
+            if (used) {
+                double latency = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now() - reload.saved).count();
+                std::cout << "Hot reload: " << reload.path << " live " << std::fixed << std::setprecision(1) << latency
+                          << " ms after it was saved" << std::endl;
+                std::cout << std::defaultfloat << std::setprecision(6);
+            }
+        }
+        
+        // Shapes keep their texture IDs; refresh them in case the size or mask changed
+        if (texturesChanged) {
+            ShapeTable::refresh();
+            setupShapeSprites();
+        }
+        
+        double swapTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - swapStart).count();
+        std::cout << "Hot reload: swapped " << reloads.size() << " file(s) in " << std::fixed << std::setprecision(2) << swapTime
+                  << " ms of frame time" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
+        redrawNeeded = true;
+    }
+    
+    static void logStartupTime(const char* milestone) {
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count();
+        std::cout << "Startup: " << milestone << " " << std::fixed << std::setprecision(1) << elapsed << " ms" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
+    }
+    
+    void initializeUI() {
+        // Score, level, health, shield and weapon
+        hud.setAtlas(glyphAtlas);
+        profiler.setAtlas(glyphAtlas);
+        
+        // Static screens are laid out once
+        for (SpriteBatch* batch : { &menuBatch, &gameOverBatch, &victoryBatch, &bossWarningBatch, &pausedBatch, &rewindBatch, &timelineBatch, &replayLabelBatch, &waitingBatch }) {
+            batch->setTexture(&glyphAtlas.getTexture());
+        }
+        
+        // Main menu
+        glyphAtlas.appendText(menuBatch, "SPACE SHOOTER", sf::Vector2f(150.f, 100.f), 64, sf::Color::Yellow);
+        glyphAtlas.appendText(menuBatch, "Press ENTER to start", sf::Vector2f(250.f, 300.f), 32, sf::Color::White);
+        glyphAtlas.appendText(menuBatch, "Controls:\nArrow Keys - Move\nSpace - Shoot", sf::Vector2f(250.f, 400.f), 24, sf::Color::White);
+        
+        // Game over and victory, each with the restart prompt
+        glyphAtlas.appendText(gameOverBatch, "GAME OVER", sf::Vector2f(200.f, 200.f), 64, sf::Color::Red);
+        glyphAtlas.appendText(gameOverBatch, "Press R to restart", sf::Vector2f(275.f, 300.f), 32, sf::Color::White);
+        glyphAtlas.appendText(victoryBatch, "VICTORY!", sf::Vector2f(250.f, 200.f), 64, sf::Color::Green);
+        glyphAtlas.appendText(victoryBatch, "Press R to restart", sf::Vector2f(275.f, 300.f), 32, sf::Color::White);
+        
+        // Shown while the window is in the background
+        glyphAtlas.appendText(pausedBatch, "PAUSED", sf::Vector2f(290.f, 250.f), 64, sf::Color::White);
+        
+        // Boss warning
+        glyphAtlas.appendText(bossWarningBatch, "WARNING: BOSS APPROACHING!", sf::Vector2f(75.f, 250.f), 48, sf::Color::Red);
+        
+        // Co-op, before the other player joins and while their inputs are late
+        glyphAtlas.appendText(waitingBatch, "Waiting for the other player...", sf::Vector2f(200.f, 510.f), 28, sf::Color::Yellow);
+    }
+    
+    // True when the current screen is static: menus and end screens with nothing left animating,
+    // or a game paused because the window lost focus
+    bool isIdle() const {
+        if (paused) return true;
+        if (rewinding) return false;
+        // Co-op keeps exchanging inputs, even on the end screen, so the other player can finish
+        if (coopEnabled) return false;
+        if (profiler.isOverlayVisible()) return false;
+        
+        switch (gameState) {
+            case GameState::MainMenu:
+                return true;
+            case GameState::GameOver:
+            case GameState::Victory:
+                return explosions.empty() && explosionFlipbooks.empty();
+            default:
+                return false;
+        }
+    }
+    
+    void handleEvents() {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            handleEvent(event);
+        }
+    }
+    
+    void handleEvent(const sf::Event& event) {
+        if (event.type == sf::Event::Closed)
+            window.close();
+        
+        // Pause a running game while the window is in the background
+        if (event.type == sf::Event::LostFocus && (gameState == GameState::Playing || gameState == GameState::BossFight) && !coopEnabled) {
+            paused = true;
+            redrawNeeded = true;
+        }
+        else if (event.type == sf::Event::GainedFocus && paused) {
+            paused = false;
+            frameClock.restart();
+        }
+        else if (event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus) {
+            redrawNeeded = true;
+        }
+        
+        if (replay.isOpen()) {
+            handleReplayMouse(event);
+        }
+        
+        // Handle key presses
+        if (event.type == sf::Event::KeyPressed) {
+            if (event.key.code == sf::Keyboard::F3) {
+                profiler.toggleOverlay();
+                redrawNeeded = true;
+            }
+            if (event.key.code == sf::Keyboard::F4) {
+                explosionQuality = static_cast<EffectQuality>((static_cast<int>(explosionQuality) + 1) % 3);
+                static const char* const qualityNames[] = { "automatic", "particles", "flipbook" };
+                std::cout << "Explosion quality: " << qualityNames[static_cast<int>(explosionQuality)] << std::endl;
+            }
+            if (replay.isOpen()) {
+                handleReplayKey(event.key.code);
+                return;
+            }
+            // One peer cannot load, rewind or restart without the games parting
+            if (coopEnabled) {
+                return;
+            }
+            
+            // Quick save and load, kept in memory for this session
+            if (event.key.code == sf::Keyboard::F5 && (gameState == GameState::Playing || gameState == GameState::BossFight)) {
+                simulation.save(quickSave);
+                std::cout << "Quick saved at tick " << simulation.getTick() << std::endl;
+            }
+            if (event.key.code == sf::Keyboard::F9 && gameState != GameState::MainMenu && simulation.restore(quickSave)) {
+                rewinding = false;
+                gameState = simulation.getState();
+                tickAccumulator = 0.0f;
+                explosions.clear();
+                explosionFlipbooks.clear();
+                rewind.clear();
+                rewind.capture(simulation);
+                redrawNeeded = true;
+                std::cout << "Quick loaded tick " << simulation.getTick() << std::endl;
+                
+                // The inputs that led to the loaded state are not in the recording
+                if (recordingReplay) {
+                    recordingReplay = false;
+                    std::cout << "Replay recording stopped for this game" << std::endl;
+                }
+            }
+            // Rewind: F6 freezes the game on its newest tick and resumes from whichever tick is shown
+            if (event.key.code == sf::Keyboard::F6 && gameState != GameState::MainMenu) {
+                if (rewinding) {
+                    stopRewind();
+                } else {
+                    startRewind();
+                }
+            }
+            if (rewinding && (event.key.code == sf::Keyboard::Comma || event.key.code == sf::Keyboard::Period)) {
+                seekRewind(event.key.code == sf::Keyboard::Period ? 1 : -1);
+                printRewindTick();
+            }
+            if (gameState == GameState::MainMenu && event.key.code == sf::Keyboard::Return) {
+                startGame();
+            }
+            else if ((gameState == GameState::GameOver || gameState == GameState::Victory) && 
+                     event.key.code == sf::Keyboard::R) {
+                startGame();
+            }
+        }
+    }
+    
+    void update() {
+        if (coopEnabled) {
+            coop.poll(getClockMilliseconds());
+            if (gameState == GameState::MainMenu && coop.isStarted()) {
+                startCoopGame();
+            }
+
+            // A game that ended on a predicted input may carry on once the real one is in
+            if (gameState == GameState::GameOver || gameState == GameState::Victory) {
+                coop.reconcile(simulation);
+                gameState = simulation.getState();
+                if (gameState != GameState::Playing && gameState != GameState::BossFight &&
+                    coop.getConfirmedTick() >= simulation.getTick()) {
+                    printCoopStats();
+                }
+            }
+        }
+        if (paused) {
+            return;
+        }
+        if (rewinding) {
+            updateRewind();
+            return;
+        }
+        if (replay.isOpen() && replayPaused) {
+            updateReplayLabel();
+            return;
+        }
+        
+        switch (gameState) {
+            case GameState::MainMenu:
+                // Nothing to update in main menu
+                break;
+                
+            case GameState::Playing:
+            case GameState::BossFight:
+                updateSimulation();
+                break;
+                
+            case GameState::GameOver:
+            case GameState::Victory:
+                // Update explosions
+                updateExplosions();
+                break;
+        }
+    }
+    
+    // The simulation runs at its own fixed tick; each frame steps it as often as the elapsed time covers
+    void updateSimulation() {
+        std::uint8_t input = readInput();
+        tickAccumulator += deltaTime;
+        
+        for (int ticks = 0; tickAccumulator >= Simulation::tickSeconds; ++ticks) {
+            GameState state = simulation.getState();
+            if (state != GameState::Playing && state != GameState::BossFight) {
+                break;
+            }
+            // After a long stall the backlog is dropped rather than replayed all at once
+            if (ticks == maxTicksPerFrame) {
+                tickAccumulator = 0.0f;
+                break;
+            }
+            
+            // A replay supplies its own inputs and stops at its last tick
+            if (replay.isOpen()) {
+                if (simulation.getTick() >= replay.getTickCount()) {
+                    tickAccumulator = 0.0f;
+                    break;
+                }
+                input = replay.getInput(simulation.getTick());
+            }
+            
+            // Co-op waits for the other player's input; the time spent waiting is not made up
+            if (coopEnabled) {
+                if (!coop.advance(simulation, input, getClockMilliseconds())) {
+                    tickAccumulator = std::min(tickAccumulator, Simulation::tickSeconds);
+                    ++coopStalledFrames;
+                    break;
+                }
+                coopStalledFrames = 0;
+            } else {
+                simulation.step(input);
+            }
+            presentEvents();
+            if (recordingReplay) {
+                replayRecorder.record(input, simulation);
+            }
+            if (!replay.isOpen() && !coopEnabled) {
+                Profiler::Scope scope(profiler, "rewind");
+                rewind.capture(simulation);
+            }
+            if (stateExport.isOpen()) {
+                Profiler::Scope scope(profiler, "export");
+                stateExport.publish(simulation);
+            }
+            tickAccumulator -= Simulation::tickSeconds;
+        }
+        gameState = simulation.getState();
+        if (recordingReplay && !replaySaved && gameState != GameState::Playing && gameState != GameState::BossFight) {
+            saveReplay();
+        }
+        if (replay.isOpen()) {
+            updateReplayLabel();
+        }
+        
+        // Update explosions
+        updateExplosions();
+        
+        // Update UI
+        updateUI();
+    }
+    
+    // Held arrow keys scrub a tick per frame, eight with Shift
+    void updateRewind() {
+        int step = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift) || sf::Keyboard::isKeyPressed(sf::Keyboard::RShift) ? 8 : 1;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) {
+            seekRewind(-step);
+        } else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) {
+            seekRewind(step);
+        }
+    }
+    
+    void startRewind() {
+        if (rewind.empty()) {
+            return;
+        }
+        rewinding = true;
+        explosions.clear();
+        explosionFlipbooks.clear();
+        rewindTick = rewind.getLastTick();
+        seekRewind(0);
+        std::cout << "Rewind: ticks " << rewind.getFirstTick() << " to " << rewind.getLastTick() << " held in "
+                  << rewind.getUsedBytes() / 1024 << " KB" << std::endl;
+    }
+    
+    // Play carries on from the tick on screen; the ticks after it are forgotten
+    void stopRewind() {
+        rewinding = false;
+        rewind.truncateAfter(rewindTick);
+        replayRecorder.truncate(rewindTick);
+        gameState = simulation.getState();
+        
+        // A game resumed before its ending is saved again, over the same file, when it ends
+        if (gameState == GameState::Playing || gameState == GameState::BossFight) {
+            replaySaved = false;
+        }
+        tickAccumulator = 0.0f;
+    }
+    
+    // Move the tick on screen by 'ticks', staying within the ticks held
+    void seekRewind(int ticks) {
+        std::uint64_t tick = rewindTick;
+        if (ticks < 0) {
+            tick = tick - rewind.getFirstTick() > static_cast<std::uint64_t>(-ticks) ? tick + ticks : rewind.getFirstTick();
+        } else {
+            tick = std::min(tick + ticks, rewind.getLastTick());
+        }
+        if (!rewind.seek(tick, rewindSnapshot) || !simulation.restore(rewindSnapshot)) {
+            return;
+        }
+        rewindTick = tick;
+        gameState = simulation.getState();
+        updateUI();
+        
+        std::ostringstream text;
+        text << "REWIND  tick " << tick << "  (" << std::fixed << std::setprecision(2)
+             << (static_cast<double>(tick) - rewind.getLastTick()) * Simulation::tickSeconds << " s)";
+        rewindBatch.clear();
+        glyphAtlas.appendText(rewindBatch, text.str(), sf::Vector2f(20.f, 530.f), 24, sf::Color::Yellow);
+        glyphAtlas.appendText(rewindBatch, "Left/Right scrub (Shift faster)   , and . step   F6 resume", sf::Vector2f(20.f, 565.f), 18,
+                              sf::Color::White);
+    }
+    
+    void printRewindTick() {
+        const Player& player = simulation.getPlayer();
+        const Boss& boss = simulation.getBoss();
+        std::cout << "tick " << simulation.getTick() << ": player (" << player.position.x << ", " << player.position.y << ") health "
+                  << player.health << ", " << simulation.getEnemies().size() << " enemies, " << simulation.getBullets().size() << "/"
+                  << simulation.getEnemyBullets().size() << " bullets, " << simulation.getLasers().size() << " lasers";
+        if (boss.active) {
+            std::cout << ", boss (" << boss.position.x << ", " << boss.position.y << ") " << boss.health << " hp";
+        }
+        std::cout << std::endl;
+    }
+    
+    // Space pauses, Left/Right jump 5 seconds, Home or R go back to the start
+    void handleReplayKey(sf::Keyboard::Key key) {
+        std::uint64_t jump = 5 * 60;
+        std::uint64_t tick = simulation.getTick();
+        if (key == sf::Keyboard::Space) {
+            replayPaused = !replayPaused;
+        } else if (key == sf::Keyboard::Left) {
+            seekReplay(tick > jump ? tick - jump : 0);
+        } else if (key == sf::Keyboard::Right) {
+            seekReplay(tick + jump);
+        } else if (key == sf::Keyboard::Home || key == sf::Keyboard::R) {
+            seekReplay(0);
+        }
+    }
+    
+    // Clicking or dragging along the timeline seeks to the tick under the mouse
+    void handleReplayMouse(const sf::Event& event) {
+        bool pressed = event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left;
+        if (event.type == sf::Event::MouseButtonReleased) {
+            scrubbingTimeline = false;
+        }
+        if (!pressed && !(event.type == sf::Event::MouseMoved && scrubbingTimeline)) {
+            return;
+        }
+        
+        sf::Vector2i pixel = pressed ? sf::Vector2i(event.mouseButton.x, event.mouseButton.y) : sf::Vector2i(event.mouseMove.x, event.mouseMove.y);
+        sf::Vector2f point = window.mapPixelToCoords(pixel);
+        if (pressed && !timelineBounds.contains(point.x, point.y)) {
+            return;
+        }
+        scrubbingTimeline = true;
+        float fraction = std::min(std::max((point.x - timelineBounds.left) / timelineBounds.width, 0.0f), 1.0f);
+        seekReplay(static_cast<std::uint64_t>(fraction * replay.getTickCount() + 0.5f));
+    }
+    
+    void startReplay() {
+        std::cout << "Replay: " << replay.getTickCount() << " ticks, " << replay.getKeyframeCount() << " keyframes, final score "
+                  << replay.getFinalScore() << " on level " << replay.getFinalLevel() << std::endl;
+        
+        // The track with a mark at every keyframe, where seeking is cheapest
+        timelineBatch.clear();
+        timelineBatch.addQuad(timelineBounds, GlyphAtlas::getWhiteRect(), sf::Color(80, 80, 80, 200));
+        for (std::size_t i = 0; i < replay.getKeyframeCount(); ++i) {
+            float x = timelineBounds.left + timelineBounds.width * replay.getKeyframe(i).tick / std::max<std::uint64_t>(1, replay.getTickCount());
+            timelineBatch.addQuad(sf::FloatRect(x, timelineBounds.top + timelineBounds.height, 1.f, 4.f), GlyphAtlas::getWhiteRect(),
+                                  sf::Color(160, 160, 160));
+        }
+        timelineProgress.setFillColor(sf::Color::Yellow);
+        timelineProgress.setPosition(timelineBounds.left, timelineBounds.top);
+        
+        replayPaused = false;
+        seekReplay(0);
+    }
+    
+    void seekReplay(std::uint64_t tick) {
+        replay.seek(tick, simulation);
+        gameState = simulation.getState();
+        tickAccumulator = 0.0f;
+        explosions.clear();
+        explosionFlipbooks.clear();
+        updateUI();
+        updateReplayLabel();
+    }
+    
+    // Elapsed and total time, rebuilt only when the shown second changes
+    void updateReplayLabel() {
+        std::uint64_t tickCount = std::max<std::uint64_t>(1, replay.getTickCount());
+        timelineProgress.setSize(sf::Vector2f(timelineBounds.width * simulation.getTick() / tickCount, timelineBounds.height));
+        
+        int second = static_cast<int>(simulation.getTick() / 60);
+        int shownState = second * 2 + (replayPaused ? 1 : 0);
+        if (shownState == replayLabelState) {
+            return;
+        }
+        replayLabelState = shownState;
+        
+        int total = static_cast<int>(replay.getTickCount() / 60);
+        std::ostringstream text;
+        text << "REPLAY  " << second / 60 << ":" << std::setw(2) << std::setfill('0') << second % 60 << " / " << total / 60 << ":"
+             << std::setw(2) << total % 60 << (replayPaused ? "  paused" : "");
+        replayLabelBatch.clear();
+        glyphAtlas.appendText(replayLabelBatch, text.str(), sf::Vector2f(timelineBounds.left, timelineBounds.top - 26.f), 18, sf::Color::White);
+    }
+    
+    // Named after when the game first ended, so files from one session sort in order. Recording
+    // goes on after the save, so a rewind past the ending can play on and save over it.
+    void saveReplay() {
+        replaySaved = true;
+        if (replayPath.empty()) {
+            char name[64];
+            std::time_t now = std::time(nullptr);
+            std::strftime(name, sizeof(name), "replay-%Y%m%d-%H%M%S.ssr", std::localtime(&now));
+            replayPath = replayDirectory + "/" + name;
+        }
+        if (replayRecorder.write(replayPath.c_str(), simulation)) {
+            std::cout << "Saved replay " << replayPath << " (" << replayRecorder.getTickCount() << " ticks)" << std::endl;
+        } else {
+            std::cerr << "Could not write replay " << replayPath << std::endl;
+        }
+    }
+    
+    static std::uint8_t readInput() {
+        std::uint8_t input = 0;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) input |= Simulation::InputLeft;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) input |= Simulation::InputRight;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up)) input |= Simulation::InputUp;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down)) input |= Simulation::InputDown;
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Space)) input |= Simulation::InputFire;
+        return input;
+    }
+    
+    // Sounds and explosions the last tick reported
+    void presentEvents() {
+        for (const Simulation::Event& event : simulation.getEvents()) {
+            if (event.type == Simulation::Event::Type::Sound) {
+                audio.play(event.sound);
+            } else {
+                spawnExplosion(event.position, event.scale);
+            }
+        }
+    }
+    
+    void updateExplosions() {
+        for (auto it = explosions.begin(); it != explosions.end();) {
+            if (!it->update(deltaTime)) {
+                it = explosions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        explosionFlipbooks.update(deltaTime);
+    }
+    
+    // Particles cost 30 shapes per explosion, so past a handful alive the flipbook takes over
+    void spawnExplosion(const sf::Vector2f& position, float scale = 1.0f) {
+        const QualityLevel& quality = governor.getLevel();
+        EffectQuality effectQuality = explosionQuality == EffectQuality::Automatic ? quality.explosionQuality : explosionQuality;
+        bool useFlipbook = effectQuality == EffectQuality::Flipbook ||
+                           (effectQuality == EffectQuality::Automatic && explosions.size() >= maxParticleExplosions);
+        if (useFlipbook && explosionFlipbooks.isReady()) {
+            explosionFlipbooks.spawn(position, 0.3f * scale);
+        } else {
+            explosions.emplace_back(position, scale, quality.particlesPerExplosion, quality.particleLifetimeScale);
+        }
+    }
+    
+    void updateUI() {
+        Profiler::Scope scope(profiler, "hud");
+        
+        // At lower quality levels the HUD only catches up every few frames
+        if (++hudFramesSinceRefresh < governor.getLevel().hudRefreshInterval) {
+            return;
+        }
+        hudFramesSinceRefresh = 0;
+        
+        // The score is the team's; the rest is this player's own
+        int local = coopEnabled ? coop.getLocalPlayer() : 0;
+        const Player& player = simulation.getPlayer(local);
+        float shieldHealth = simulation.hasShield(local) ? simulation.getShieldHealth(local) : 0.0f;
+        hud.update(simulation.getPlayer().score, simulation.getLevel().getCurrentLevel(), player.health, shieldHealth, player.getWeapon().name);
+    }
+    
+    void startGame() {
+        gameState = GameState::Playing;
+        
+        // Every game gets a fresh seed; the simulation plays out the same game from the same one
+        std::random_device device;
+        std::uint64_t seed = (static_cast<std::uint64_t>(device()) << 32) | device();
+        simulation.reset(seed);
+        tickAccumulator = 0.0f;
+        rewinding = false;
+        rewind.clear();
+        rewind.capture(simulation);
+        if (!replayDirectory.empty()) {
+            replayRecorder.start(seed, simulation);
+            recordingReplay = true;
+            replaySaved = false;
+            replayPath.clear();
+        }
+        
+        // Clear effects
+        explosions.clear();
+        explosionFlipbooks.clear();
+    }
+    
+    // Both peers start from the seed the host picked, on the same tick
+    void startCoopGame() {
+        gameState = GameState::Playing;
+        simulation.reset(coop.getSeed(), Simulation::maxPlayers);
+        tickAccumulator = 0.0f;
+        explosions.clear();
+        explosionFlipbooks.clear();
+        std::cout << "Co-op game started; you are player " << coop.getLocalPlayer() + 1 << std::endl;
+    }
+    
+    void printCoopStats() {
+        if (coopStatsPrinted) return;
+        coopStatsPrinted = true;
+        const LockstepSession::Stats& stats = coop.getStats();
+        double seconds = simulation.getTick() * Simulation::tickSeconds;
+        std::cout << "Co-op: input delay " << coop.getConfig().inputDelay << " ticks, added input latency avg "
+                  << static_cast<int>(stats.latencySum / std::max<std::uint64_t>(stats.latencySamples, 1)) << " ms, max "
+                  << static_cast<int>(stats.latencyMax) << " ms, " << stats.stalls << " stalled frames, "
+                  << static_cast<int>(stats.bytesSent / std::max(seconds, 1.0)) << " B/s sent" << std::endl;
+        if (coop.getConfig().maxRollback > 0) {
+            std::cout << "Rollback: " << stats.rollbacks << " rollbacks, " << stats.resimulatedTicks << " ticks re-simulated, worst "
+                      << static_cast<int>(stats.rollbackSecondsMax * 1e6) << " us in one frame" << std::endl;
+        }
+        std::cout << "Restart both games to play again" << std::endl;
+    }
+    
+    double getClockMilliseconds() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count();
+    }
+    
+    void render() {
+        window.clear();
+        
+        // Draw background
+        if (governor.getLevel().drawBackground) {
+            window.draw(background);
+        }
+        
+        // Draw based on game state
+        switch (gameState) {
+            case GameState::MainMenu:
+                renderMainMenu();
+                break;
+                
+            case GameState::Playing:
+            case GameState::BossFight:
+                renderGame();
+                break;
+                
+            case GameState::GameOver:
+                renderGame();
+                gameOverBatch.draw(window);
+                break;
+                
+            case GameState::Victory:
+                renderGame();
+                victoryBatch.draw(window);
+                break;
+        }
+        
+        if (rewinding) {
+            rewindBatch.draw(window);
+        }
+        if (replay.isOpen() && gameState != GameState::MainMenu) {
+            timelineBatch.draw(window);
+            window.draw(timelineProgress);
+            replayLabelBatch.draw(window);
+        }
+        if (paused) {
+            pausedBatch.draw(window);
+        }
+        if (coopEnabled && (gameState == GameState::MainMenu || coopStalledFrames >= coopWaitingFrames)) {
+            waitingBatch.draw(window);
+        }
+        
+        profiler.drawOverlay(window);
+    }
+    
+    void renderMainMenu() {
+        menuBatch.draw(window);
+    }
+    
+    void renderGame() {
+        // Draw players and shields; in co-op a player who is down is gone, and the second ship is tinted
+        for (int i = 0; i < simulation.getPlayerCount(); ++i) {
+            const Player& player = simulation.getPlayer(i);
+            if (simulation.getPlayerCount() > 1 && player.health <= 0) {
+                continue;
+            }
+            sf::Sprite& ship = shapeSprites[static_cast<std::size_t>(ShapeId::Player)];
+            ship.setColor(i == 0 ? sf::Color::White : sf::Color(150, 200, 255));
+            drawShape(ShapeId::Player, player.position);
+            if (simulation.hasShield(i)) {
+                drawShape(ShapeId::Shield, player.position);
+            }
+        }
+        
+        // Draw bullets
+        for (const Bullet& bullet : simulation.getBullets()) {
+            drawShape(bullet.shape, bullet.position);
+        }
+        
+        // Draw enemy bullets
+        for (const Bullet& bullet : simulation.getEnemyBullets()) {
+            drawShape(bullet.shape, bullet.position);
+        }
+        
+        // Draw lasers
+        for (const Laser& laser : simulation.getLasers()) {
+            laserBeam.setSize(sf::Vector2f(Laser::width, laser.bottom - laser.top));
+            laserBeam.setPosition(laser.getLeft(), laser.top);
+            window.draw(laserBeam);
+        }
+        
+        // Draw enemies
+        for (const Enemy& enemy : simulation.getEnemies()) {
+            drawShape(getEnemyDef(enemy.type).shape, enemy.position);
+        }
+        
+        // Draw boss
+        if (simulation.getBoss().active) {
+            drawShape(ShapeId::Boss, simulation.getBoss().position);
+        }
+        
+        // Draw power-ups
+        for (const PowerUp& powerup : simulation.getPowerUps()) {
+            drawShape(getPowerUpShape(powerup.type), powerup.position);
+        }
+        
+        // Draw explosions
+        for (const auto& explosion : explosions) {
+            explosion.draw(window);
+        }
+        explosionFlipbooks.draw(window);
+        
+        // Draw UI
+        {
+            Profiler::Scope scope(profiler, "hud");
+            hud.draw(window);
+        }
+        
+        // Draw boss warning
+        if (simulation.isBossWarningVisible()) {
+            bossWarningBatch.draw(window);
+        }
+    }
+    
+    void drawShape(ShapeId shape, const sf::Vector2f& position) {
+        sf::Sprite& sprite = shapeSprites[static_cast<std::size_t>(shape)];
+        sprite.setPosition(position);
+        window.draw(sprite);
+    }
+    
+    // One sprite per shape, moved to each body drawn with it
+    void setupShapeSprites() {
+        for (std::size_t i = 0; i < shapeCount; ++i) {
+            const ShapeDef& def = shapeTable[i];
+            const sf::Texture& texture = TextureCache::get(def.texture);
+            sf::Sprite& sprite = shapeSprites[i];
+            sprite.setTexture(texture, true);
+            sprite.setOrigin(texture.getSize().x / 2.0f, texture.getSize().y / 2.0f);
+            
+            // Textures uploaded at lower resolution are scaled up to match the source image
+            float resolutionScale = TextureCache::getResolutionScale(def.texture);
+            sprite.setScale(def.scale / resolutionScale, def.scale / resolutionScale);
+            sprite.setRotation(def.rotation);
+        }
+        
+        const sf::Texture& laserTexture = TextureCache::get(TextureId::Laser);
+        if (laserTexture.getSize().x > 0) {
+            laserBeam.setTexture(&laserTexture, true);
+            laserBeam.setFillColor(sf::Color::White);
+        } else {
+            laserBeam.setTexture(nullptr);
+            laserBeam.setFillColor(sf::Color(255, 80, 80));
+        }
+    }
+    
+    // Game window
+    sf::RenderWindow window;
+    
+    // Game state
+    GameState gameState;
+    
+    // Delta time for frame-rate independent movement
+    float deltaTime;
+    sf::Clock frameClock;
+    
+    // Idle rendering: static screens only redraw when something marks them dirty
+    bool paused;
+    bool redrawNeeded;
+    
+    // Resources; the pack comes first because the font keeps reading from its mapping
+    AssetPack assetPack;
+    sf::Font font;
+    GlyphAtlas glyphAtlas;
+    sf::Texture backgroundTexture;
+    sf::Sprite background;
+    sf::Texture explosionTexture;
+    
+    // Sounds
+    AudioService audio;
+    
+    // Decodes everything above in the background
+    AssetLoader assets;
+    AssetWatcher assetWatcher;
+    
+    // Game rules, stepped at their fixed tick, and the sprites they are drawn with
+    Simulation simulation;
+    float tickAccumulator = 0.0f;
+    static constexpr int maxTicksPerFrame = 8;
+    StateExport stateExport;
+    std::vector<std::uint8_t> quickSave;
+    
+    // The last minute of ticks, and the one on screen while rewinding
+    RewindBuffer rewind;
+    bool rewinding = false;
+    std::uint64_t rewindTick = 0;
+    std::vector<std::uint8_t> rewindSnapshot;
+    
+    // Replays: the game being recorded, or the file being watched
+    std::string replayDirectory;
+    ReplayFile::Recorder replayRecorder;
+    bool recordingReplay = false;
+    bool replaySaved = false;       // This game's ending is in the file; cleared when a rewind resumes play before it
+    std::string replayPath;
+    ReplayFile replay;
+    bool replayPaused = false;
+    bool scrubbingTimeline = false;
+    sf::FloatRect timelineBounds{ 20.f, 580.f, 760.f, 8.f };
+    sf::RectangleShape timelineProgress;
+    int replayLabelState = -1;
+    
+    // Co-op: the session with the other player, and how long their input has been late
+    LockstepSession coop;
+    bool coopEnabled = false;
+    bool coopStatsPrinted = false;
+    int coopStalledFrames = 0;
+    static constexpr int coopWaitingFrames = 15;
+    std::array<sf::Sprite, shapeCount> shapeSprites;
+    sf::RectangleShape laserBeam;
+    
+    // Effects
+    std::vector<Explosion> explosions;
+    FlipbookEffects explosionFlipbooks;
+    EffectQuality explosionQuality = EffectQuality::Automatic;
+    static constexpr std::size_t maxParticleExplosions = 6;
+    
+    // UI elements
+    Hud hud;
+    SpriteBatch menuBatch;
+    SpriteBatch gameOverBatch;
+    SpriteBatch victoryBatch;
+    SpriteBatch bossWarningBatch;
+    SpriteBatch pausedBatch;
+    SpriteBatch rewindBatch;
+    SpriteBatch timelineBatch;
+    SpriteBatch replayLabelBatch;
+    SpriteBatch waitingBatch;
+    
+    // Frame timing and the quality it allows
+    Profiler profiler;
+    QualityGovernor governor{ 1000.0f / 60.0f };
+    int hudFramesSinceRefresh = 0;
+};
+
+// Worker pool - a fixed set of threads that split each job's index range with the calling thread
+class WorkerPool {
+public:
+    typedef std::function<void(std::size_t begin, std::size_t end)> Task;
+
+    explicit WorkerPool(unsigned threadCount) : task(nullptr), taskSize(0), generation(0), remaining(0), stopping(false) {
+        for (unsigned i = 1; i < threadCount; ++i) {
+            threads.emplace_back(&WorkerPool::workerLoop, this, i);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Run 'job' over [0, count) in one contiguous chunk per thread and return once all are done
+    void run(std::size_t count, const Task& job) {
+        if (threads.empty()) {
+            job(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &job;
+            taskSize = count;
+            remaining = static_cast<unsigned>(threads.size());
+            ++generation;
+        }
+        wake.notify_all();
+        runChunk(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return remaining == 0; });
+        task = nullptr;
+    }
+
+    unsigned getThreadCount() const { return static_cast<unsigned>(threads.size()) + 1; }
+
+private:
+    void runChunk(unsigned index) {
+        std::size_t chunks = threads.size() + 1;
+        std::size_t begin = taskSize * index / chunks;
+        std::size_t end = taskSize * (index + 1) / chunks;
+        if (begin < end) {
+            (*task)(begin, end);
+        }
+    }
+
+    void workerLoop(unsigned index) {
+        std::uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+
+            runChunk(index);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const Task* task;
+    std::size_t taskSize;
+    std::uint64_t generation;
+    unsigned remaining;
+    bool stopping;
+};
+
+// Indices of up to 'count' items nearest to 'origin', nearest first; returns how many were found
+template <typename Items, typename PositionOf>
+int findNearest(const Items& items, const sf::Vector2f& origin, PositionOf positionOf, int count, std::size_t* result) {
+    float distances[32];
+    int found = 0;
+    std::size_t index = 0;
+    for (const auto& item : items) {
+        sf::Vector2f offset = positionOf(item) - origin;
+        float distance = offset.x * offset.x + offset.y * offset.y;
+
+        // Insertion into the short sorted list
+        if (found < count || distance < distances[found - 1]) {
+            int slot = found < count ? found++ : found - 1;
+            while (slot > 0 && distances[slot - 1] > distance) {
+                distances[slot] = distances[slot - 1];
+                result[slot] = result[slot - 1];
+                --slot;
+            }
+            distances[slot] = distance;
+            result[slot] = index;
+        }
+        ++index;
+    }
+    return found;
+}
+
+// Feature layers - the simulation rasterized into a low-resolution grid per entity class, for bots
+// and analytics. A cell is set where an entity's bounds cover it. Cells are packed one bit each,
+// lowest bit first, and rows are padded to whole bytes; layers follow each other, rows top to
+// bottom (numpy.unpackbits with bitorder='little' expands a frame). Bits rather than bytes keep a
+// frame to 6.6 KB at 80x60, so clearing it costs less than a simulation step. Bounds are turned
+// into cell ranges four at a time with SIMD, straight from the entity arrays; nothing here touches
+// SFML or the GPU.
+class FeatureLayers {
+public:
+    enum class Layer {
+        Player,
+        BasicEnemy,
+        FastEnemy,
+        TankyEnemy,
+        PlayerBullets,      // Laser beams included
+        EnemyBullets,
+        HealthPowerUp,
+        ShieldPowerUp,
+        UpgradePowerUp,
+        ScoreBoostPowerUp,
+        Boss,
+        Count
+    };
+
+    static constexpr int layerCount = static_cast<int>(Layer::Count);
+
+    FeatureLayers(int width = 80, int height = 60)
+        : width(width), height(height), rowBytes((width + 7) / 8), cellsPerPixelX(width / 800.0f), cellsPerPixelY(height / 600.0f) {
+        // Shape sizes are copied once so rendering reads nothing but plain floats
+        for (std::size_t i = 0; i < shapeCount; ++i) {
+            const sf::Vector2f& size = ShapeTable::get(static_cast<ShapeId>(i)).size;
+            halfWidths[i] = size.x / 2.0f;
+            halfHeights[i] = size.y / 2.0f;
+        }
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    std::size_t getPlaneSize() const { return static_cast<std::size_t>(rowBytes) * height; }
+    std::size_t getSize() const { return getPlaneSize() * layerCount; }
+
+    void render(const Simulation& simulation, std::uint8_t* out) const {
+        render(simulation.getPlayer(), simulation.getBoss(), simulation.getEnemies(), simulation.getBullets(),
+               simulation.getEnemyBullets(), simulation.getLasers(), simulation.getPowerUps(), out);
+    }
+
+    // Writes getSize() bytes to 'out'; safe to call from several threads at once
+    void render(const Player& player, const Boss& boss, const std::vector<Enemy>& enemies, const BulletPool& bullets,
+                const BulletPool& enemyBullets, const std::vector<Laser>& lasers, const std::vector<PowerUp>& powerups,
+                std::uint8_t* out) const {
+        std::memset(out, 0, getSize());
+        Batches batches;
+
+        addShape(batches, out, Layer::Player, ShapeId::Player, player.position);
+        if (boss.active) {
+            addShape(batches, out, Layer::Boss, ShapeId::Boss, boss.position);
+        }
+        for (const Enemy& enemy : enemies) {
+            Layer layer = static_cast<Layer>(static_cast<int>(Layer::BasicEnemy) + static_cast<int>(enemy.type));
+            addShape(batches, out, layer, getEnemyDef(enemy.type).shape, enemy.position);
+        }
+        for (const Bullet& bullet : bullets) {
+            addShape(batches, out, Layer::PlayerBullets, bullet.shape, bullet.position);
+        }
+        for (const Laser& laser : lasers) {
+            float halfHeight = (laser.bottom - laser.top) / 2.0f;
+            addBox(batches, out, Layer::PlayerBullets, laser.x, laser.top + halfHeight, Laser::width / 2.0f, halfHeight);
+        }
+        for (const Bullet& bullet : enemyBullets) {
+            addShape(batches, out, Layer::EnemyBullets, bullet.shape, bullet.position);
+        }
+        for (const PowerUp& powerup : powerups) {
+            Layer layer = static_cast<Layer>(static_cast<int>(Layer::HealthPowerUp) + static_cast<int>(powerup.type));
+            addShape(batches, out, layer, getPowerUpShape(powerup.type), powerup.position);
+        }
+
+        for (int layer = 0; layer < layerCount; ++layer) {
+            fill(out + layer * getPlaneSize(), batches[layer]);
+        }
+    }
+
+private:
+    static constexpr int batchSize = 64;
+
+    // Boxes waiting to be filled, as centres and half sizes in pixels
+    struct Batch {
+        float centerX[batchSize];
+        float centerY[batchSize];
+        float halfWidth[batchSize];
+        float halfHeight[batchSize];
+        int count = 0;
+    };
+
+    typedef std::array<Batch, layerCount> Batches;
+
+    void addShape(Batches& batches, std::uint8_t* out, Layer layer, ShapeId shape, const sf::Vector2f& position) const {
+        std::size_t index = static_cast<std::size_t>(shape);
+        addBox(batches, out, layer, position.x, position.y, halfWidths[index], halfHeights[index]);
+    }
+
+    void addBox(Batches& batches, std::uint8_t* out, Layer layer, float centerX, float centerY, float halfWidth, float halfHeight) const {
+        Batch& batch = batches[static_cast<int>(layer)];
+        batch.centerX[batch.count] = centerX;
+        batch.centerY[batch.count] = centerY;
+        batch.halfWidth[batch.count] = halfWidth;
+        batch.halfHeight[batch.count] = halfHeight;
+        if (++batch.count == batchSize) {
+            fill(out + static_cast<int>(layer) * getPlaneSize(), batch);
+        }
+    }
+
+    // Cell range [first, last) covered by [center - half, center + half), clamped to [0, limit]
+    static void toCells(float center, float half, float scale, float limit, int& first, int& last) {
+        float low = std::min(std::max((center - half) * scale, 0.0f), limit);
+        float high = std::min(std::max((center + half) * scale, 0.0f), limit);
+        first = static_cast<int>(low);
+        last = static_cast<int>(high);
+        if (static_cast<float>(last) < high) ++last;
+    }
+
+    void fill(std::uint8_t* plane, Batch& batch) const {
+        int x0[batchSize], x1[batchSize], y0[batchSize], y1[batchSize];
+        int i = 0;
+
+#if defined(__SSE2__)
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 scaleX = _mm_set1_ps(cellsPerPixelX), scaleY = _mm_set1_ps(cellsPerPixelY);
+        const __m128 limitX = _mm_set1_ps(static_cast<float>(width)), limitY = _mm_set1_ps(static_cast<float>(height));
+        for (; i + 4 <= batch.count; i += 4) {
+            __m128 centerX = _mm_loadu_ps(batch.centerX + i), halfWidth = _mm_loadu_ps(batch.halfWidth + i);
+            __m128 centerY = _mm_loadu_ps(batch.centerY + i), halfHeight = _mm_loadu_ps(batch.halfHeight + i);
+
+            // Clamped to the grid first, so truncation is a floor
+            __m128 left = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(centerX, halfWidth), scaleX), zero), limitX);
+            __m128 right = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(centerX, halfWidth), scaleX), zero), limitX);
+            __m128 top = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(centerY, halfHeight), scaleY), zero), limitY);
+            __m128 bottom = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(centerY, halfHeight), scaleY), zero), limitY);
+
+            // Ceiling of the far edges: a true compare is -1, so subtracting it adds one
+            __m128i right0 = _mm_cvttps_epi32(right), bottom0 = _mm_cvttps_epi32(bottom);
+            __m128i rightCeil = _mm_sub_epi32(right0, _mm_castps_si128(_mm_cmpgt_ps(right, _mm_cvtepi32_ps(right0))));
+            __m128i bottomCeil = _mm_sub_epi32(bottom0, _mm_castps_si128(_mm_cmpgt_ps(bottom, _mm_cvtepi32_ps(bottom0))));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(x0 + i), _mm_cvttps_epi32(left));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(x1 + i), rightCeil);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y0 + i), _mm_cvttps_epi32(top));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y1 + i), bottomCeil);
+        }
+#elif defined(__ARM_NEON)
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t scaleX = vdupq_n_f32(cellsPerPixelX), scaleY = vdupq_n_f32(cellsPerPixelY);
+        const float32x4_t limitX = vdupq_n_f32(static_cast<float>(width)), limitY = vdupq_n_f32(static_cast<float>(height));
+        for (; i + 4 <= batch.count; i += 4) {
+            float32x4_t centerX = vld1q_f32(batch.centerX + i), halfWidth = vld1q_f32(batch.halfWidth + i);
+            float32x4_t centerY = vld1q_f32(batch.centerY + i), halfHeight = vld1q_f32(batch.halfHeight + i);
+
+            float32x4_t left = vminq_f32(vmaxq_f32(vmulq_f32(vsubq_f32(centerX, halfWidth), scaleX), zero), limitX);
+            float32x4_t right = vminq_f32(vmaxq_f32(vmulq_f32(vaddq_f32(centerX, halfWidth), scaleX), zero), limitX);
+            float32x4_t top = vminq_f32(vmaxq_f32(vmulq_f32(vsubq_f32(centerY, halfHeight), scaleY), zero), limitY);
+            float32x4_t bottom = vminq_f32(vmaxq_f32(vmulq_f32(vaddq_f32(centerY, halfHeight), scaleY), zero), limitY);
+
+            int32x4_t right0 = vcvtq_s32_f32(right), bottom0 = vcvtq_s32_f32(bottom);
+            int32x4_t rightCeil = vsubq_s32(right0, vreinterpretq_s32_u32(vcgtq_f32(right, vcvtq_f32_s32(right0))));
+            int32x4_t bottomCeil = vsubq_s32(bottom0, vreinterpretq_s32_u32(vcgtq_f32(bottom, vcvtq_f32_s32(bottom0))));
+
+            vst1q_s32(x0 + i, vcvtq_s32_f32(left));
+            vst1q_s32(x1 + i, rightCeil);
+            vst1q_s32(y0 + i, vcvtq_s32_f32(top));
+            vst1q_s32(y1 + i, bottomCeil);
+        }
+#endif
+        for (; i < batch.count; ++i) {
+            toCells(batch.centerX[i], batch.halfWidth[i], cellsPerPixelX, static_cast<float>(width), x0[i], x1[i]);
+            toCells(batch.centerY[i], batch.halfHeight[i], cellsPerPixelY, static_cast<float>(height), y0[i], y1[i]);
+        }
+
+        for (i = 0; i < batch.count; ++i) {
+            if (x0[i] >= x1[i]) continue;
+
+            // Partial bytes at either end of the span, whole bytes in between
+            int firstByte = x0[i] >> 3;
+            int lastByte = (x1[i] - 1) >> 3;
+            std::uint8_t firstMask = static_cast<std::uint8_t>(0xff << (x0[i] & 7));
+            std::uint8_t lastMask = static_cast<std::uint8_t>(0xff >> (7 - ((x1[i] - 1) & 7)));
+            if (firstByte == lastByte) {
+                firstMask &= lastMask;
+            }
+
+            for (int y = y0[i]; y < y1[i]; ++y) {
+                std::uint8_t* row = plane + static_cast<std::size_t>(y) * rowBytes;
+                row[firstByte] |= firstMask;
+                if (lastByte > firstByte) {
+                    std::memset(row + firstByte + 1, 0xff, lastByte - firstByte - 1);
+                    row[lastByte] |= lastMask;
                 }
             }
-            
-            // Check collision with boss
-            if (!bulletRemoved && boss && (*it)->getBounds().intersects(boss->getBounds())) {
-                boss->takeDamage((*it)->getDamage());
-                it = bullets.erase(it);
-                bulletRemoved = true;
+        }
+        batch.count = 0;
+    }
+
+    int width;
+    int height;
+    int rowBytes;
+    float cellsPerPixelX;
+    float cellsPerPixelY;
+    float halfWidths[shapeCount];
+    float halfHeights[shapeCount];
+};
+
+// Vectorized environment - N headless simulations stepped together on a worker pool, for training
+// bots. Actions are Simulation input bits. A step's reward is the score gained minus a penalty for
+// health lost; instances that reach GameOver or Victory report done and restart straight away with
+// a seed derived from the reset seed, their index and their episode count.
+class VecEnv {
+public:
+    // Observation: the player, the boss, then the nearest enemies, enemy bullets and power-ups
+    // relative to the player. Absent entries are all zeros.
+    static constexpr int nearestEnemies = 16;
+    static constexpr int nearestEnemyBullets = 16;
+    static constexpr int nearestPowerUps = 4;
+    static constexpr int observationSize = 6 + 4 + nearestEnemies * 4 + nearestEnemyBullets * 3 + nearestPowerUps * 4;
+    static constexpr float damagePenalty = 1.0f;
+    static_assert(nearestEnemies <= 32 && nearestEnemyBullets <= 32 && nearestPowerUps <= 32, "findNearest keeps at most 32");
+
+    VecEnv(std::size_t count, unsigned threadCount)
+        : simulations(count), episodes(count, 0), baseSeed(0), pool(std::max(1u, threadCount)) {}
+
+    void reset(std::uint64_t seed) {
+        baseSeed = seed;
+        pool.run(simulations.size(), [this](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                episodes[i] = 0;
+                simulations[i].reset(getEpisodeSeed(i));
             }
-            
-            // Remove off-screen bullets
-            if (!bulletRemoved) {
-                if ((*it)->isOffScreen()) {
-                    it = bullets.erase(it);
-                } else {
-                    ++it;
+        });
+    }
+
+    // One input byte per instance in; one reward and one done flag per instance out
+    void step(const std::uint8_t* actions, float* rewards, std::uint8_t* dones) {
+        pool.run(simulations.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                Simulation& simulation = simulations[i];
+                int score = simulation.getPlayer().score;
+                int health = simulation.getPlayer().health;
+
+                simulation.step(actions[i]);
+
+                int healthLost = std::max(0, health - simulation.getPlayer().health);
+                rewards[i] = static_cast<float>(simulation.getPlayer().score - score) - damagePenalty * healthLost;
+
+                GameState state = simulation.getState();
+                bool done = state == GameState::GameOver || state == GameState::Victory;
+                dones[i] = done ? 1 : 0;
+                if (done) {
+                    ++episodes[i];
+                    simulation.reset(getEpisodeSeed(i));
                 }
             }
+        });
+    }
+
+    // Writes observationSize floats per instance, instance after instance
+    void observe(float* observations) {
+        pool.run(simulations.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                writeObservation(simulations[i], observations + i * observationSize);
+            }
+        });
+    }
+
+    // Writes getLayers().getSize() bytes of feature layers per instance, instance after instance
+    void observeLayers(std::uint8_t* out) {
+        pool.run(simulations.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                layers.render(simulations[i], out + i * layers.getSize());
+            }
+        });
+    }
+
+    const FeatureLayers& getLayers() const { return layers; }
+
+    std::size_t size() const { return simulations.size(); }
+    unsigned getThreadCount() const { return pool.getThreadCount(); }
+    const Simulation& getSimulation(std::size_t index) const { return simulations[index]; }
+
+    static void writeObservation(const Simulation& simulation, float* out) {
+        const Player& player = simulation.getPlayer();
+        const sf::Vector2f& origin = player.position;
+
+        *out++ = player.position.x / 800.0f;
+        *out++ = player.position.y / 600.0f;
+        *out++ = player.health / 100.0f;
+        *out++ = simulation.hasShield() ? simulation.getShieldHealth() / Player::maxShieldHealth : 0.0f;
+        *out++ = static_cast<float>(player.weaponType) / (weaponCount - 1);
+        *out++ = simulation.canShoot() ? 1.0f : 0.0f;
+
+        const Boss& boss = simulation.getBoss();
+        *out++ = boss.active ? 1.0f : 0.0f;
+        *out++ = boss.active ? (boss.position.x - origin.x) / 800.0f : 0.0f;
+        *out++ = boss.active ? (boss.position.y - origin.y) / 600.0f : 0.0f;
+        *out++ = boss.active ? boss.health / getEnemyDef(EnemyType::Boss).health : 0.0f;
+
+        std::size_t nearest[32];
+        const std::vector<Enemy>& enemies = simulation.getEnemies();
+        int found = findNearest(enemies, origin, [](const Enemy& enemy) { return enemy.position; }, nearestEnemies, nearest);
+        for (int k = 0; k < nearestEnemies; ++k, out += 4) {
+            if (k >= found) {
+                std::fill(out, out + 4, 0.0f);
+                continue;
+            }
+            const Enemy& enemy = enemies[nearest[k]];
+            out[0] = 1.0f;
+            out[1] = (enemy.position.x - origin.x) / 800.0f;
+            out[2] = (enemy.position.y - origin.y) / 600.0f;
+            out[3] = static_cast<float>(enemy.type) / 2.0f;
+        }
+
+        const BulletPool& bullets = simulation.getEnemyBullets();
+        found = findNearest(bullets, origin, [](const Bullet& bullet) { return bullet.position; }, nearestEnemyBullets, nearest);
+        for (int k = 0; k < nearestEnemyBullets; ++k, out += 3) {
+            if (k >= found) {
+                std::fill(out, out + 3, 0.0f);
+                continue;
+            }
+            const Bullet& bullet = bullets[nearest[k]];
+            out[0] = 1.0f;
+            out[1] = (bullet.position.x - origin.x) / 800.0f;
+            out[2] = (bullet.position.y - origin.y) / 600.0f;
+        }
+
+        const std::vector<PowerUp>& powerups = simulation.getPowerUps();
+        found = findNearest(powerups, origin, [](const PowerUp& powerup) { return powerup.position; }, nearestPowerUps, nearest);
+        for (int k = 0; k < nearestPowerUps; ++k, out += 4) {
+            if (k >= found) {
+                std::fill(out, out + 4, 0.0f);
+                continue;
+            }
+            const PowerUp& powerup = powerups[nearest[k]];
+            out[0] = 1.0f;
+            out[1] = (powerup.position.x - origin.x) / 800.0f;
+            out[2] = (powerup.position.y - origin.y) / 600.0f;
+            out[3] = static_cast<float>(powerup.type) / 3.0f;
         }
     }
-    
-    void updateLasers() {
-        for (auto it = lasers.begin(); it != lasers.end();) {
-            (*it)->update(deltaTime);
-            
-            // Check collision with enemies
-            for (auto enemyIt = enemies.begin(); enemyIt != enemies.end();) {
-                if ((*it)->getBounds().intersects((*enemyIt)->getBounds())) {
-                    // Enemy hit by laser
-                    (*enemyIt)->takeDamage((*it)->getDamage());
-                    
-                    if ((*enemyIt)->isDestroyed()) {
-                        // Create explosion
-                        explosions.emplace_back((*enemyIt)->getPosition());
-                        explosionSound.play();
-                        
-                        // Add score
-                        player.addScore((*enemyIt)->getScoreValue());
-                        
-                        // Update level
-                        level.update(1);
-                        
-                        // Remove enemy
-                        enemyIt = enemies.erase(enemyIt);
-                    } else {
-                        ++enemyIt;
+
+private:
+    // Seeds depend only on the instance and its episode, never on which thread stepped it
+    std::uint64_t getEpisodeSeed(std::size_t index) const {
+        return baseSeed + index + episodes[index] * simulations.size();
+    }
+
+    std::vector<Simulation> simulations;
+    std::vector<std::uint64_t> episodes;
+    std::uint64_t baseSeed;
+    FeatureLayers layers;
+    WorkerPool pool;
+};
+
+// C interface to VecEnv for training code outside C++, e.g. Python through ctypes. Build a shared
+// library with -shared -fPIC -DSPACE_SHOOTER_LIBRARY, which leaves out main(). All buffers belong
+// to the caller and are written in place: count action bytes in, count rewards and done flags out,
+// count * shooter_env_observation_size() floats of observations and count * layers * height *
+// ceil(width / 8) bytes of bit-packed feature layers.
+struct ShooterEnv {
+    ShooterEnv(std::size_t count, unsigned threadCount) : env(count, threadCount) {}
+    VecEnv env;
+};
+
+extern "C" {
+
+// threadCount 0 uses every hardware thread; returns null on failure
+ShooterEnv* shooter_env_create(int count, int threadCount) {
+    if (count <= 0) return nullptr;
+    unsigned threads = threadCount > 0 ? static_cast<unsigned>(threadCount) : std::thread::hardware_concurrency();
+    try {
+        return new ShooterEnv(static_cast<std::size_t>(count), threads);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void shooter_env_destroy(ShooterEnv* env) {
+    delete env;
+}
+
+int shooter_env_observation_size() {
+    return VecEnv::observationSize;
+}
+
+void shooter_env_reset(ShooterEnv* env, std::uint64_t seed) {
+    env->env.reset(seed);
+}
+
+void shooter_env_step(ShooterEnv* env, const std::uint8_t* actions, float* rewards, std::uint8_t* dones) {
+    env->env.step(actions, rewards, dones);
+}
+
+void shooter_env_observe(ShooterEnv* env, float* observations) {
+    env->env.observe(observations);
+}
+
+void shooter_env_layer_shape(ShooterEnv* env, int* layers, int* height, int* width) {
+    *layers = FeatureLayers::layerCount;
+    *height = env->env.getLayers().getHeight();
+    *width = env->env.getLayers().getWidth();
+}
+
+void shooter_env_observe_layers(ShooterEnv* env, std::uint8_t* layers) {
+    env->env.observeLayers(layers);
+}
+
+}
+
+// Replay verification - checks the result a replay claims by playing it again from its seed and
+// inputs alone. Keyframes are compared with the re-simulated state but never restored, so a forged
+// file cannot plant state; the first keyframe that differs shows roughly where the two parted.
+struct ReplayVerdict {
+    enum Result {
+        Verified,
+        Mismatch,   // Reads fine, but the game does not play out as claimed
+        Invalid     // Not a replay of this version, or too long to check
+    };
+
+    Result result;
+    std::uint64_t ticks;        // Ticks re-simulated
+    int claimedScore;
+    int score;
+    int claimedLevel;
+    int level;
+    std::string detail;         // What did not match
+};
+
+// An hour of play; a file claiming more is rejected rather than tying up a worker
+const std::uint64_t maxVerifiedTicks = 60 * 60 * 60;
+
+// 'simulation' and 'snapshot' are reused from replay to replay, so a worker only ever holds one game
+ReplayVerdict verifyReplay(const char* path, Simulation& simulation, std::vector<std::uint8_t>& snapshot) {
+    ReplayVerdict verdict = { ReplayVerdict::Invalid, 0, 0, 0, 0, 0, std::string() };
+    ReplayFile replay;
+    if (!replay.open(path)) {
+        verdict.detail = "not a replay of this version";
+        return verdict;
+    }
+    verdict.claimedScore = replay.getFinalScore();
+    verdict.claimedLevel = replay.getFinalLevel();
+    std::uint64_t tickCount = replay.getTickCount();
+    if (tickCount > maxVerifiedTicks) {
+        verdict.detail = "longer than an hour";
+        return verdict;
+    }
+
+    // Stops early if the game ends before the inputs do
+    simulation.reset(replay.getSeed());
+    std::size_t nextKeyframe = 0;
+    std::uint64_t divergedTick = 0;
+    bool keyframesMatch = true;
+    for (;;) {
+        std::uint64_t tick = simulation.getTick();
+        if (nextKeyframe < replay.getKeyframeCount() && replay.getKeyframe(nextKeyframe).tick == tick) {
+            ReplayFile::Keyframe keyframe = replay.getKeyframe(nextKeyframe++);
+            if (keyframesMatch) {
+                simulation.save(snapshot);
+                keyframesMatch = keyframe.size == snapshot.size() &&
+                                 std::memcmp(replay.getKeyframeData(keyframe), snapshot.data(), snapshot.size()) == 0;
+                divergedTick = tick;
+            }
+        }
+        GameState state = simulation.getState();
+        if (tick == tickCount || (state != GameState::Playing && state != GameState::BossFight)) {
+            break;
+        }
+        simulation.step(replay.getInput(tick));
+    }
+
+    verdict.ticks = simulation.getTick();
+    verdict.score = simulation.getPlayer().score;
+    verdict.level = simulation.getLevel().getCurrentLevel();
+    GameState state = simulation.getState();
+    simulation.save(snapshot);
+
+    std::vector<std::string> problems;
+    if (verdict.ticks < tickCount) {
+        problems.push_back("game over at tick " + std::to_string(verdict.ticks) + " of " + std::to_string(tickCount));
+    } else if (state != GameState::GameOver && state != GameState::Victory) {
+        problems.push_back("game still running after the last input");
+    }
+    if (verdict.score != verdict.claimedScore) problems.push_back("score");
+    if (verdict.level != verdict.claimedLevel) problems.push_back("level");
+    if (state != replay.getFinalState()) problems.push_back("final state");
+    if (hashBytes(snapshot.data(), snapshot.size()) != replay.getFinalStateHash()) problems.push_back("state hash");
+    if (!keyframesMatch) problems.push_back("keyframe at tick " + std::to_string(divergedTick));
+
+    verdict.result = problems.empty() ? ReplayVerdict::Verified : ReplayVerdict::Mismatch;
+    for (std::size_t i = 0; i < problems.size(); ++i) {
+        verdict.detail += (i ? ", " : "") + problems[i];
+    }
+    return verdict;
+}
+
+struct ReplayVerifierStats {
+    std::size_t verified = 0;
+    std::size_t mismatched = 0;
+    std::size_t invalid = 0;
+    std::uint64_t ticks = 0;
+    double seconds = 0.0;
+};
+
+// Verifies every .ssr file in 'directory' on 'threadCount' threads (0 for every hardware thread)
+// and writes one tab-separated verdict line per file to 'reportPath'. The directory is read a
+// batch at a time and each batch's verdicts are written before the next is read, so memory
+// stays the same for ten files or a hundred thousand. Replays are handed out one at a time
+// rather than in fixed chunks, since one long game would otherwise hold up its whole chunk.
+bool verifyReplayDirectory(const char* directory, const char* reportPath, unsigned threadCount, ReplayVerifierStats& stats) {
+#if defined(__unix__) || defined(__APPLE__)
+    static const char* const resultNames[] = { "verified", "mismatch", "invalid" };
+    const std::size_t batchSize = 4096;
+
+    DIR* listing = opendir(directory);
+    if (!listing) {
+        return false;
+    }
+    std::ofstream report(reportPath, std::ios::trunc);
+    if (!report) {
+        closedir(listing);
+        return false;
+    }
+    report << "file\tverdict\tticks\tclaimed score\tscore\tclaimed level\tlevel\tdetail\n";
+
+    WorkerPool pool(threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<Simulation> simulations(pool.getThreadCount());
+    std::vector<std::vector<std::uint8_t>> snapshots(pool.getThreadCount());
+    std::vector<std::string> paths;
+    std::vector<ReplayVerdict> verdicts;
+    stats = ReplayVerifierStats();
+
+    auto start = std::chrono::steady_clock::now();
+    for (;;) {
+        paths.clear();
+        while (paths.size() < batchSize) {
+            dirent* entry = readdir(listing);
+            if (!entry) break;
+            std::size_t length = std::strlen(entry->d_name);
+            if (length > 4 && std::strcmp(entry->d_name + length - 4, ".ssr") == 0) {
+                paths.push_back(std::string(directory) + "/" + entry->d_name);
+            }
+        }
+        if (paths.empty()) break;
+
+        // One chunk per thread; each thread keeps taking the next unclaimed replay
+        verdicts.resize(paths.size());
+        std::atomic<std::size_t> next(0);
+        pool.run(pool.getThreadCount(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t worker = begin; worker < end; ++worker) {
+                for (std::size_t i = next++; i < paths.size(); i = next++) {
+                    verdicts[i] = verifyReplay(paths[i].c_str(), simulations[worker], snapshots[worker]);
+                }
+            }
+        });
+
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            const ReplayVerdict& verdict = verdicts[i];
+            report << paths[i] << '\t' << resultNames[verdict.result] << '\t' << verdict.ticks << '\t' << verdict.claimedScore << '\t'
+                   << verdict.score << '\t' << verdict.claimedLevel << '\t' << verdict.level << '\t' << verdict.detail << '\n';
+            stats.verified += verdict.result == ReplayVerdict::Verified ? 1 : 0;
+            stats.mismatched += verdict.result == ReplayVerdict::Mismatch ? 1 : 0;
+            stats.invalid += verdict.result == ReplayVerdict::Invalid ? 1 : 0;
+            stats.ticks += verdict.ticks;
+        }
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    closedir(listing);
+    return static_cast<bool>(report.flush());
+#else
+    (void)directory;
+    (void)reportPath;
+    (void)threadCount;
+    (void)stats;
+    return false;
+#endif
+}
+
+// --verify-replays: exits with 0 only if every replay in the directory verified
+int runReplayVerifier(const char* directory, const char* reportPath) {
+    ReplayVerifierStats stats;
+    if (!verifyReplayDirectory(directory, reportPath, 0, stats)) {
+        std::cerr << "Could not verify the replays in " << directory << " into " << reportPath << std::endl;
+        return 1;
+    }
+
+    std::size_t total = stats.verified + stats.mismatched + stats.invalid;
+    std::cout << total << " replays: " << stats.verified << " verified, " << stats.mismatched << " mismatched, " << stats.invalid
+              << " invalid, in " << std::fixed << std::setprecision(2) << stats.seconds << " s (" << std::setprecision(0)
+              << total / std::max(stats.seconds, 1e-9) << " replays/s, " << std::setprecision(2)
+              << stats.ticks / std::max(stats.seconds, 1e-9) / 1e6 << " M ticks/s)" << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+    std::cout << "Verdicts written to " << reportPath << std::endl;
+    return stats.verified == total ? 0 : 1;
+}
+
+// Benchmarks - headless measurements, run with ./output/main --bench
+double benchmarkSeconds(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmarkCollisionMasks() {
+    struct MaskedSprite {
+        const char* name;
+        TextureId texture;
+        float scale;
+        float rotation;
+    };
+
+    // Every masked sprite at the scale and rotation it is drawn with in game
+    const MaskedSprite sprites[] = {
+        { "player", TextureId::Player, 0.5f, 0.0f },
+        { "basic enemy", TextureId::BasicEnemy, 0.5f, 180.0f },
+        { "fast enemy", TextureId::FastEnemy, 0.5f, 180.0f },
+        { "tanky enemy", TextureId::TankyEnemy, 0.5f, 180.0f },
+        { "boss", TextureId::Boss, 1.0f, 180.0f },
+        { "basic bullet", TextureId::Bullet, 0.5f, 0.0f },
+        { "double bullet", TextureId::RoundBullet, 0.5f, 0.0f },
+        { "triple bullet", TextureId::LongBullet, 0.5f, 0.0f },
+        { "boss bullet", TextureId::LongBullet, 0.5f, 180.0f }
+    };
+
+    std::cout << "Collision masks" << std::endl;
+    std::vector<const CollisionMask*> masks;
+    for (const auto& sprite : sprites) {
+        const CollisionMask* mask = CollisionMaskCache::get(sprite.texture, sprite.scale, sprite.scale, sprite.rotation);
+        std::cout << "  " << std::left << std::setw(14) << sprite.name << std::right;
+        if (mask) {
+            std::cout << std::setw(4) << mask->getWidth() << "x" << std::setw(4) << std::left << mask->getHeight()
+                      << std::right << std::setw(8) << mask->getMemoryUsage() << " bytes" << std::endl;
+            masks.push_back(mask);
+        } else {
+            std::cout << "  no mask, AABB fallback" << std::endl;
+        }
+    }
+    std::cout << "  total mask memory: " << CollisionMaskCache::getMemoryUsage() << " bytes" << std::endl;
+
+    if (masks.size() < 2) {
+        std::cout << "  not enough masks to time overlap tests" << std::endl;
+        return;
+    }
+
+    // Random pairs with offsets that always pass the AABB broadphase, i.e. the worst case for the mask test
+    const int testCount = 1000000;
+    struct Pair {
+        const CollisionMask* a;
+        const CollisionMask* b;
+        int dx;
+        int dy;
+    };
+    std::vector<Pair> pairs;
+    pairs.reserve(testCount);
+    std::mt19937 gen(1234);
+    for (int i = 0; i < testCount; ++i) {
+        const CollisionMask* a = masks[gen() % masks.size()];
+        const CollisionMask* b = masks[gen() % masks.size()];
+        int dx = static_cast<int>(gen() % (a->getWidth() + b->getWidth() - 1)) - (b->getWidth() - 1);
+        int dy = static_cast<int>(gen() % (a->getHeight() + b->getHeight() - 1)) - (b->getHeight() - 1);
+        pairs.push_back({ a, b, dx, dy });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int hits = 0;
+    for (const auto& pair : pairs) {
+        if (pair.a->overlaps(*pair.b, pair.dx, pair.dy)) ++hits;
+    }
+    double elapsed = benchmarkSeconds(start);
+
+    std::cout << "  overlap test: " << std::fixed << std::setprecision(1) << elapsed * 1e9 / testCount
+              << " ns/test over " << testCount << " AABB-passing pairs, "
+              << std::setprecision(1) << 100.0 * hits / testCount << "% pixel hits" << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+// Headless batch sim of the bullet-versus-enemy rules at a fixed tick rate. Spawns and shots happen
+// on a 30 Hz grid so every tick rate sees exactly the same schedule.
+struct TickRateResult {
+    int hits;
+    int kills;
+};
+
+TickRateResult simulateBulletWaves(int tickRate, bool swept, float duration) {
+    const int scheduleRate = 30;
+    const int ticksPerSlot = tickRate / scheduleRate;
+    const float deltaTime = 1.0f / tickRate;
+    const int tickCount = static_cast<int>(duration * tickRate);
+
+    std::mt19937 gen(42);
+    std::vector<Enemy> enemies;
+    BulletPool bullets(512);
+    std::vector<float> columns;
+    TickRateResult result = { 0, 0 };
+
+    for (int tick = 0; tick < tickCount; ++tick) {
+        if (tick % ticksPerSlot == 0) {
+            int slot = tick / ticksPerSlot;
+
+            // A new enemy every 0.2 s
+            if (slot % 6 == 0) {
+                EnemyType type = static_cast<EnemyType>(gen() % 3);
+                float x = 50.0f + gen() % 700;
+                enemies.push_back({ sf::Vector2f(x, -50.f), getEnemyDef(type).health, type });
+                columns.push_back(x);
+            }
+
+            // A shot every 0.1 s at a recent enemy column, slightly off-centre
+            if (slot % 3 == 0 && !columns.empty()) {
+                float x = columns[gen() % columns.size()] + static_cast<float>(gen() % 25) - 12.0f;
+                emitVolley(bullets, weaponTable[static_cast<int>(WeaponType::Basic)], sf::Vector2f(x, 580.f));
+            }
+        }
+
+        // Same order as Simulation::step - bullets resolve against enemies before enemies move
+        for (std::size_t i = 0; i < bullets.size();) {
+            Bullet& bullet = bullets[i];
+            sf::Vector2f bulletStart = bullet.position;
+            bullet.position += bullet.velocity * deltaTime;
+
+            bool bulletRemoved = false;
+            for (auto enemyIt = enemies.begin(); enemyIt != enemies.end(); ++enemyIt) {
+                ShapeId enemyShape = getEnemyDef(enemyIt->type).shape;
+                bool hit = swept ? shapesSweptCollide(bullet.shape, bulletStart, bullet.velocity, enemyShape, enemyIt->position,
+                                                      enemyIt->getVelocity(), deltaTime)
+                                 : shapesCollide(bullet.shape, bullet.position, enemyShape, enemyIt->position);
+                if (hit) {
+                    ++result.hits;
+                    enemyIt->health -= bullet.damage;
+                    if (enemyIt->isDestroyed()) {
+                        ++result.kills;
+                        enemies.erase(enemyIt);
                     }
-                } else {
-                    ++enemyIt;
+                    bullets.remove(i);
+                    bulletRemoved = true;
+                    break;
                 }
             }
-            
-            // Check collision with boss
-            if (boss && (*it)->getBounds().intersects(boss->getBounds())) {
-                boss->takeDamage((*it)->getDamage());
+
+            if (!bulletRemoved) {
+                if (bullet.isOffScreen()) {
+                    bullets.remove(i);
+                } else {
+                    ++i;
+                }
             }
-            
-            // Remove inactive lasers
-            if (!(*it)->isActive()) {
-                it = lasers.erase(it);
+        }
+
+        for (auto it = enemies.begin(); it != enemies.end();) {
+            it->position += it->getVelocity() * deltaTime;
+            if (it->isOffScreen()) {
+                it = enemies.erase(it);
             } else {
                 ++it;
             }
         }
     }
-    
-    void updateEnemies() {
-        for (auto it = enemies.begin(); it != enemies.end();) {
-            (*it)->update(deltaTime);
-            
-            // Check collision with player
-            if ((*it)->getBounds().intersects(player.getBounds())) {
-                // Player hit by enemy
-                player.takeDamage(25);
-                explosionSound.play();
-                explosions.emplace_back((*it)->getPosition());
-                it = enemies.erase(it);
-                
-                // Check if player is dead
-                if (player.getHealth() <= 0) {
-                    gameState = GameState::GameOver;
-                    explosions.emplace_back(player.getPosition());
+
+    return result;
+}
+
+void benchmarkTickRates() {
+    const int tickRates[] = { 30, 60, 120, 240 };
+    const float duration = 30.0f;
+
+    std::cout << "Tick rate independence (" << duration << " s of bullet waves, hits/kills)" << std::endl;
+    for (int swept = 0; swept <= 1; ++swept) {
+        std::cout << "  " << std::left << std::setw(10) << (swept ? "swept" : "discrete") << std::right;
+
+        std::vector<TickRateResult> results;
+        for (int tickRate : tickRates) {
+            results.push_back(simulateBulletWaves(tickRate, swept != 0, duration));
+            std::cout << std::setw(5) << tickRate << " Hz " << std::setw(4) << results.back().hits << "/"
+                      << std::left << std::setw(4) << results.back().kills << std::right;
+        }
+
+        // Lowest against highest tick rate
+        int difference = std::abs(results.front().kills - results.back().kills);
+        std::cout << "  30 vs 240 Hz: " << difference << " kills apart" << std::endl;
+    }
+}
+
+// Firing path: a volley of every projectile weapon written into a pool that is recycled when full
+void benchmarkFiring() {
+    const int volleyCount = 1000000;
+    BulletPool pool(512);
+
+    std::cout << "Firing path (" << volleyCount << " volleys per weapon)" << std::endl;
+    for (std::size_t weapon = 0; weapon < weaponCount; ++weapon) {
+        if (weaponTable[weapon].beam) continue;
+
+        pool.clear();
+        auto start = std::chrono::steady_clock::now();
+        std::size_t emitted = 0;
+        for (int i = 0; i < volleyCount; ++i) {
+            if (pool.size() + weaponTable[weapon].projectileCount > pool.capacity()) {
+                emitted += pool.size();
+                pool.clear();
+            }
+            weaponEmitters[weapon](pool, sf::Vector2f(400.f, 550.f));
+        }
+        emitted += pool.size();
+        double elapsed = benchmarkSeconds(start);
+
+        std::cout << "  " << std::left << std::setw(8) << weaponTable[weapon].name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(7) << elapsed * 1e9 / volleyCount << " ns/volley "
+                  << std::setw(7) << elapsed * 1e9 / emitted << " ns/projectile" << std::endl;
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+// Timer wheel: per-tick advance cost with many idle timers pending, versus a handful
+void benchmarkTimerWheel() {
+    const int pendingCounts[] = { 10, 1000, 100000 };
+    const int tickCount = 100000;
+    const float deltaTime = 1.0f / 60.0f;
+
+    std::cout << "Timer wheel (" << tickCount << " ticks at 60 Hz, one 0.25 s cooldown re-armed as it expires)" << std::endl;
+    for (int pendingCount : pendingCounts) {
+        TimerWheel timers;
+        std::mt19937 gen(7);
+
+        // Long-running timers that never expire during the run
+        for (int i = 0; i < pendingCount; ++i) {
+            timers.schedule(5000.0f + (gen() % 100000) / 10.0f);
+        }
+
+        int fired = 0;
+        const std::uint32_t cooldownEvent = 1;
+        timers.schedule(0.25f, cooldownEvent);
+        auto onExpire = [&](TimerHandle handle, std::uint32_t event) {
+            if (event == cooldownEvent) {
+                ++fired;
+                timers.restart(handle, 0.25f);
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < tickCount; ++tick) {
+            timers.advance(deltaTime, onExpire);
+        }
+        double elapsed = benchmarkSeconds(start);
+
+        std::cout << "  " << std::setw(6) << pendingCount << " pending: " << std::fixed << std::setprecision(1)
+                  << elapsed * 1e9 / tickCount << " ns/tick, " << fired << " expirations" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
+    }
+}
+
+void benchmarkAudioQueue() {
+    const int tickCount = 2000;
+    const int explosionsPerTick = 40;
+    const int shotsPerTick = 3;
+
+    std::cout << "Audio queue (" << tickCount << " ticks 0.5 ms apart, " << explosionsPerTick << " explosions and " << shotsPerTick
+              << " shots per tick, mixer thread running)" << std::endl;
+
+    // No buffers are loaded, so the voices play silence
+    AudioService audio;
+    audio.start();
+
+    double elapsed = 0.0;
+    for (int tick = 0; tick < tickCount; ++tick) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < explosionsPerTick; ++i) {
+            audio.play(SoundId::Explosion);
+        }
+        for (int i = 0; i < shotsPerTick; ++i) {
+            audio.play(SoundId::Shoot);
+        }
+        audio.endTick();
+        elapsed += benchmarkSeconds(start);
+
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    audio.stop();
+
+    std::uint64_t requests = static_cast<std::uint64_t>(tickCount) * (explosionsPerTick + shotsPerTick);
+    std::cout << "  play() and endTick(): " << std::fixed << std::setprecision(1) << elapsed * 1e9 / requests << " ns per request, "
+              << audio.getMergedCount() << " of " << requests << " requests merged, " << audio.getDroppedCount()
+              << " dropped, " << audio.getStolenCount() << " voices stolen" << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+// Drops a file from the page cache so the next read comes from disk
+bool evictFromPageCache(const char* path) {
+#ifdef POSIX_FADV_DONTNEED
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    fdatasync(fd);
+    bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    ::close(fd);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+void benchmarkStartupAssets() {
+    const char* benchPackPath = "assets/bench.pack";
+    std::cout << "Startup assets (decode every startup asset from loose files vs. map the pack and touch every page)" << std::endl;
+    if (!packAssets(benchPackPath, false)) {
+        std::cout << "  (some assets could not be packed; both sides load the same set)" << std::endl;
+    }
+
+    // Only what made it into the pack is compared
+    std::vector<std::string> paths;
+    {
+        AssetPack pack;
+        if (!pack.open(benchPackPath)) {
+            std::cout << "  could not open " << benchPackPath << std::endl;
+            return;
+        }
+        for (int i = 0; i < static_cast<int>(TextureId::Count); ++i) {
+            if (pack.find(getTexturePath(static_cast<TextureId>(i)), AssetPack::Kind::Pixels)) paths.push_back(getTexturePath(static_cast<TextureId>(i)));
+        }
+        for (const char* path : { backgroundPath, explosionSheetPath }) {
+            if (pack.find(path, AssetPack::Kind::Pixels)) paths.push_back(path);
+        }
+        for (const SoundDef& sound : soundTable) {
+            if (pack.find(sound.path, AssetPack::Kind::Samples)) paths.push_back(sound.path);
+        }
+        if (pack.find(fontPath, AssetPack::Kind::Bytes)) paths.push_back(fontPath);
+    }
+
+    auto loadLoose = [&]() {
+        std::size_t bytes = 0;
+        for (const std::string& path : paths) {
+            if (path.compare(path.size() - 4, 4, ".wav") == 0) {
+                sf::InputSoundFile file;
+                if (file.openFromFile(path)) {
+                    std::vector<sf::Int16> samples(static_cast<std::size_t>(file.getSampleCount()));
+                    bytes += static_cast<std::size_t>(file.read(samples.data(), samples.size())) * sizeof(sf::Int16);
                 }
+            } else if (path == fontPath) {
+                std::vector<char> fontBytes;
+                readFileBytes(path.c_str(), fontBytes);
+                bytes += fontBytes.size();
+            } else {
+                sf::Image image;
+                image.loadFromFile(path);
+                bytes += static_cast<std::size_t>(image.getSize().x) * image.getSize().y * 4;
             }
-            // Remove off-screen enemies
-            else if ((*it)->isOffScreen()) {
-                it = enemies.erase(it);
+        }
+        return bytes;
+    };
+
+    auto loadPacked = [&]() {
+        AssetPack pack;
+        pack.open(benchPackPath);
+        // Reading one byte per page faults in everything an upload would read
+        std::size_t bytes = 0;
+        volatile unsigned char sink = 0;
+        for (std::size_t i = 0; i < pack.getEntryCount(); ++i) {
+            const AssetPack::Entry& entry = pack.getEntry(i);
+            const unsigned char* data = static_cast<const unsigned char*>(pack.getData(entry));
+            for (std::size_t offset = 0; offset < entry.size; offset += 4096) {
+                sink = sink + data[offset];
+            }
+            bytes += static_cast<std::size_t>(entry.size);
+        }
+        return bytes;
+    };
+
+    auto evict = [&](bool packed) {
+        bool ok = true;
+        if (packed) {
+            ok = evictFromPageCache(benchPackPath);
+        } else {
+            for (const std::string& path : paths) ok = evictFromPageCache(path.c_str()) && ok;
+        }
+        return ok;
+    };
+
+    const int warmRuns = 20;
+    for (bool packed : { false, true }) {
+        const char* label = packed ? "pack       " : "loose files";
+
+        bool cold = evict(packed);
+        auto start = std::chrono::steady_clock::now();
+        std::size_t bytes = packed ? loadPacked() : loadLoose();
+        double coldTime = benchmarkSeconds(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int run = 0; run < warmRuns; ++run) {
+            packed ? loadPacked() : loadLoose();
+        }
+        double warmTime = benchmarkSeconds(start) / warmRuns;
+
+        std::cout << "  " << label << " (" << paths.size() << " assets, " << bytes / 1024 << " KB): " << std::fixed << std::setprecision(2);
+        if (cold) {
+            std::cout << "cold " << coldTime * 1e3 << " ms, ";
+        } else {
+            std::cout << "cold n/a (page cache cannot be dropped here), ";
+        }
+        std::cout << "warm " << warmTime * 1e3 << " ms" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
+    }
+
+    std::remove(benchPackPath);
+}
+
+// Training environment: instance-steps per second with random inputs, alone and with each kind of observation
+void benchmarkEnvironment() {
+    const std::size_t instanceCount = 256;
+    const int stepCount = 2000;
+    const int actionRows = 64;
+
+    VecEnv env(instanceCount, std::thread::hardware_concurrency());
+    std::cout << "Training environment (" << instanceCount << " instances, " << stepCount << " steps, "
+              << env.getThreadCount() << " thread(s), random inputs)" << std::endl;
+
+    std::mt19937 gen(99);
+    std::vector<std::uint8_t> actions(instanceCount * actionRows);
+    for (std::uint8_t& action : actions) {
+        action = static_cast<std::uint8_t>(gen() & 0x1f);
+    }
+    std::vector<float> rewards(instanceCount);
+    std::vector<std::uint8_t> dones(instanceCount);
+    std::vector<float> observations(instanceCount * VecEnv::observationSize);
+    std::vector<std::uint8_t> layers(instanceCount * env.getLayers().getSize());
+
+    const char* const labels[] = { "step          ", "step + observe", "step + layers " };
+    for (int mode = 0; mode < 3; ++mode) {
+        env.reset(1);
+        std::size_t episodes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int step = 0; step < stepCount; ++step) {
+            env.step(&actions[(step % actionRows) * instanceCount], rewards.data(), dones.data());
+            if (mode == 1) {
+                env.observe(observations.data());
+            } else if (mode == 2) {
+                env.observeLayers(layers.data());
+            }
+            for (std::uint8_t done : dones) episodes += done;
+        }
+        double elapsed = benchmarkSeconds(start);
+
+        double steps = static_cast<double>(instanceCount) * stepCount;
+        std::cout << "  " << labels[mode] << ": " << std::fixed << std::setprecision(2)
+                  << steps / elapsed / 1e6 << " M steps/s (" << std::setprecision(1) << elapsed * 1e9 / steps << " ns/step), "
+                  << episodes << " episodes finished" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
+    }
+}
+
+// Feature layers: one frame of 1000 entities spread over the screen, against a typical game frame
+void benchmarkFeatureLayers() {
+    const int frameCount = 20000;
+    FeatureLayers layers;
+    std::vector<std::uint8_t> out(layers.getSize());
+    std::mt19937 gen(5);
+    auto randomPosition = [&]() { return sf::Vector2f(static_cast<float>(gen() % 800), static_cast<float>(gen() % 600)); };
+
+    Player player = Player();
+    player.position = sf::Vector2f(400.f, 550.f);
+    Boss boss = Boss();
+    boss.active = true;
+    boss.position = sf::Vector2f(400.f, 100.f);
+
+    std::vector<Enemy> enemies;
+    for (int i = 0; i < 400; ++i) {
+        EnemyType type = static_cast<EnemyType>(gen() % 3);
+        enemies.push_back({ randomPosition(), getEnemyDef(type).health, type });
+    }
+    BulletPool bullets(300), enemyBullets(250);
+    while (Bullet* bullet = bullets.emit()) {
+        *bullet = { randomPosition(), sf::Vector2f(0.f, -600.f), 10.0f, static_cast<ShapeId>(static_cast<int>(ShapeId::Bullet) + gen() % 3), {} };
+    }
+    while (Bullet* bullet = enemyBullets.emit()) {
+        *bullet = { randomPosition(), sf::Vector2f(0.f, 300.f), 10.0f, ShapeId::BossBullet, {} };
+    }
+    std::vector<Laser> lasers;
+    for (int i = 0; i < 4; ++i) {
+        lasers.push_back({ static_cast<float>(gen() % 800), 500.f, 0.f, Laser::duration, static_cast<std::uint8_t>(WeaponType::Laser), {} });
+    }
+    std::vector<PowerUp> powerups;
+    for (int i = 0; i < 44; ++i) {
+        powerups.push_back({ randomPosition(), static_cast<PowerUpType>(gen() % 4) });
+    }
+    std::size_t entityCount = 2 + enemies.size() + bullets.size() + enemyBullets.size() + lasers.size() + powerups.size();
+
+    std::cout << "Feature layers (" << FeatureLayers::layerCount << " layers of " << layers.getWidth() << "x" << layers.getHeight()
+              << ", " << layers.getSize() << " bytes per frame)" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; ++frame) {
+        layers.render(player, boss, enemies, bullets, enemyBullets, lasers, powerups, out.data());
+    }
+    double elapsed = benchmarkSeconds(start);
+
+    std::size_t covered = 0;
+    for (std::uint8_t cells : out) covered += std::bitset<8>(cells).count();
+    std::cout << "  " << entityCount << " entities: " << std::fixed << std::setprecision(2) << elapsed * 1e6 / frameCount
+              << " us/frame (" << std::setprecision(1) << elapsed * 1e9 / frameCount / entityCount << " ns/entity), "
+              << covered << " cells covered" << std::endl;
+
+    // A game a few seconds in, for scale against the environment's step cost
+    Simulation simulation;
+    simulation.reset(1);
+    for (int tick = 0; tick < 600; ++tick) {
+        simulation.step(Simulation::InputFire | (tick / 60 % 2 ? Simulation::InputLeft : Simulation::InputRight));
+    }
+    start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; ++frame) {
+        layers.render(simulation, out.data());
+    }
+    elapsed = benchmarkSeconds(start);
+    std::cout << "  game after 10 s (" << simulation.getEnemies().size() + simulation.getBullets().size() + 1
+              << " entities): " << std::setprecision(2) << elapsed * 1e6 / frameCount << " us/frame" << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+// State export: publish cost for a typical game and with the export full, plus a reader's copy
+void benchmarkStateExport() {
+    const char* benchName = "/space-shooter-bench-state";
+    const int publishCount = 100000;
+
+    std::cout << "State export (seqlock over POSIX shared memory, " << sizeof(StateExportSegment) / 1024 << " KB segment)" << std::endl;
+    StateExport stateExport;
+    StateExportReader reader;
+    if (!stateExport.open(benchName) || !reader.open(benchName)) {
+        std::cout << "  shared memory is not available here" << std::endl;
+        return;
+    }
+    std::unique_ptr<ExportedState> copy(new ExportedState());
+
+    // A game a few seconds in
+    Simulation simulation;
+    simulation.reset(1);
+    for (int tick = 0; tick < 600; ++tick) {
+        simulation.step(Simulation::InputFire | (tick / 60 % 2 ? Simulation::InputLeft : Simulation::InputRight));
+    }
+
+    // More entities than the export holds, so the writer hits its ceiling
+    std::mt19937 gen(3);
+    std::vector<Enemy> enemies;
+    for (int i = 0; i < 300; ++i) {
+        enemies.push_back({ sf::Vector2f(gen() % 800, gen() % 600), 10.0f, static_cast<EnemyType>(gen() % 3) });
+    }
+    BulletPool bullets(600), enemyBullets(300);
+    while (Bullet* bullet = bullets.emit()) *bullet = { sf::Vector2f(gen() % 800, gen() % 600), sf::Vector2f(0.f, -600.f), 10.0f, ShapeId::Bullet, {} };
+    while (Bullet* bullet = enemyBullets.emit()) *bullet = { sf::Vector2f(gen() % 800, gen() % 600), sf::Vector2f(0.f, 300.f), 10.0f, ShapeId::BossBullet, {} };
+    std::vector<Laser> lasers;
+    std::vector<PowerUp> powerups;
+
+    for (bool full : { false, true }) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < publishCount; ++i) {
+            if (full) {
+                stateExport.publish(simulation, enemies, bullets, enemyBullets, lasers, powerups);
             } else {
-                ++it;
+                stateExport.publish(simulation);
             }
         }
+        double publishTime = benchmarkSeconds(start) / publishCount;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < publishCount; ++i) {
+            reader.read(*copy);
+        }
+        double readTime = benchmarkSeconds(start) / publishCount;
+
+        std::cout << "  " << (full ? "full export" : "game after 10 s") << " (" << copy->entityCount << " entities exported, "
+                  << copy->droppedCount << " dropped): publish " << std::fixed << std::setprecision(1) << publishTime * 1e9
+                  << " ns, read " << readTime * 1e9 << " ns" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
     }
-    
-    void updatePowerUps() {
-        for (auto it = powerups.begin(); it != powerups.end();) {
-            (*it)->update(deltaTime);
-            
-            // Check collision with player
-            if ((*it)->getBounds().intersects(player.getBounds())) {
-                // Apply power-up effect
-                switch ((*it)->getType()) {
-                    case PowerUpType::Health:
-                        player.heal(25);
-                        powerupSound.play();
-                        break;
-                        
-                    case PowerUpType::Shield:
-                        player.activateShield();
-                        powerupSound.play();
-                        break;
-                        
-                    case PowerUpType::WeaponUpgrade:
-                        player.upgradeWeapon();
-                        upgradeSound.play();
-                        break;
-                        
-                    case PowerUpType::ScoreBoost:
-                        player.addScore(50);
-                        powerupSound.play();
-                        break;
-                }
-                
-                it = powerups.erase(it);
-            }
-            // Remove off-screen power-ups
-            else if ((*it)->isOffScreen()) {
-                it = powerups.erase(it);
-            } else {
-                ++it;
-            }
+}
+
+// The same game with 'count' entities in place of its own: 40% enemies, 40% player bullets, 15%
+// enemy bullets and 5% power-ups, appended in snapshot order after the fixed state and timers
+std::vector<std::uint8_t> makeCrowdedSnapshot(const std::vector<std::uint8_t>& snapshot, int count) {
+    Simulation::SnapshotHeader header;
+    Simulation::readSnapshotHeader(snapshot.data(), snapshot.size(), header);
+    std::size_t entityBytes = (static_cast<std::size_t>(header.bulletCount) + header.enemyBulletCount) * sizeof(Bullet) +
+                              header.laserCount * sizeof(Laser) + header.enemyCount * sizeof(Enemy) + header.powerupCount * sizeof(PowerUp);
+
+    std::mt19937 gen(11);
+    std::vector<Bullet> bullets(count * 40 / 100), enemyBullets(count * 15 / 100);
+    std::vector<Enemy> enemies(count * 40 / 100);
+    std::vector<PowerUp> powerups(count - bullets.size() - enemyBullets.size() - enemies.size());
+    for (Bullet& bullet : bullets) bullet = { sf::Vector2f(gen() % 800, gen() % 600), sf::Vector2f(0.f, -600.f), 10.0f, ShapeId::Bullet, {} };
+    for (Bullet& bullet : enemyBullets) bullet = { sf::Vector2f(gen() % 800, gen() % 600), sf::Vector2f(0.f, 300.f), 10.0f, ShapeId::BossBullet, {} };
+    for (Enemy& enemy : enemies) enemy = { sf::Vector2f(gen() % 800, gen() % 600), 10.0f, static_cast<EnemyType>(gen() % 3) };
+    for (PowerUp& powerup : powerups) powerup = { sf::Vector2f(gen() % 800, gen() % 600), static_cast<PowerUpType>(gen() % 4) };
+
+    header.bulletCount = static_cast<std::uint32_t>(bullets.size());
+    header.enemyBulletCount = static_cast<std::uint32_t>(enemyBullets.size());
+    header.laserCount = 0;
+    header.enemyCount = static_cast<std::uint32_t>(enemies.size());
+    header.powerupCount = static_cast<std::uint32_t>(powerups.size());
+    std::size_t fixedBytes = snapshot.size() - entityBytes;
+    header.size = static_cast<std::uint32_t>(fixedBytes + (bullets.size() + enemyBullets.size()) * sizeof(Bullet) +
+                                             enemies.size() * sizeof(Enemy) + powerups.size() * sizeof(PowerUp));
+
+    std::vector<std::uint8_t> crowded(header.size);
+    std::memcpy(crowded.data(), snapshot.data(), fixedBytes);
+    writeSnapshot(crowded.data(), &header);
+    std::uint8_t* out = crowded.data() + fixedBytes;
+    out = writeSnapshot(out, bullets.data(), bullets.size());
+    out = writeSnapshot(out, enemyBullets.data(), enemyBullets.size());
+    out = writeSnapshot(out, enemies.data(), enemies.size());
+    writeSnapshot(out, powerups.data(), powerups.size());
+    return crowded;
+}
+
+// Snapshots: save and restore cost of the whole simulation, and a check that a restored game
+// plays on exactly like the original
+void benchmarkSnapshots() {
+    const int entityCounts[] = { 0, 100, 1000, 10000 };
+    const int roundCount = 2000;
+    auto inputAt = [](int tick) -> std::uint8_t {
+        return Simulation::InputFire | (tick / 45 % 2 ? Simulation::InputLeft : Simulation::InputRight) | (tick / 200 % 2 ? Simulation::InputUp : 0);
+    };
+
+    std::cout << "Snapshots (" << roundCount << " saves and restores of the whole simulation)" << std::endl;
+
+    // A game a few seconds in, then saved and played on both from the live state and from a restore
+    Simulation original;
+    original.reset(5);
+    for (int tick = 0; tick < 600; ++tick) original.step(inputAt(tick));
+    std::vector<std::uint8_t> snapshot;
+    original.save(snapshot);
+
+    Simulation restored;
+    bool replayMatches = restored.restore(snapshot);
+    for (int tick = 600; tick < 1800; ++tick) {
+        original.step(inputAt(tick));
+        restored.step(inputAt(tick));
+    }
+    std::vector<std::uint8_t> originalEnd, restoredEnd;
+    original.save(originalEnd);
+    restored.save(restoredEnd);
+    replayMatches = replayMatches && originalEnd == restoredEnd;
+    std::cout << "  restored game after 20 s more play: " << (replayMatches ? "identical" : "DIFFERENT") << " to the original" << std::endl;
+
+    for (int entityCount : entityCounts) {
+        std::vector<std::uint8_t> source = entityCount ? makeCrowdedSnapshot(snapshot, entityCount) : snapshot;
+        Simulation simulation;
+        if (!simulation.restore(source)) {
+            std::cout << "  " << entityCount << " entities: snapshot rejected" << std::endl;
+            continue;
+        }
+
+        std::vector<std::uint8_t> saved;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < roundCount; ++i) {
+            simulation.save(saved);
+        }
+        double saveTime = benchmarkSeconds(start) / roundCount;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < roundCount; ++i) {
+            simulation.restore(saved);
         }
+        double restoreTime = benchmarkSeconds(start) / roundCount;
+
+        std::cout << "  " << std::setw(5) << entityCount << (entityCount ? " entities" : " (game)  ") << std::fixed << std::setprecision(1)
+                  << std::setw(7) << saved.size() / 1024.0 << " KB: save " << std::setw(5) << saveTime * 1e6 << " us, restore "
+                  << std::setw(5) << restoreTime * 1e6 << " us" << (saved == source ? "" : "  (round trip differs)") << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
     }
-    
-    void updateExplosions() {
-        for (auto it = explosions.begin(); it != explosions.end();) {
-            if (!it->update(deltaTime)) {
-                it = explosions.erase(it);
-            } else {
-                ++it;
-            }
+}
+
+// Rewind buffer: capture cost per tick, memory held and seek cost over 90 s of play that reaches
+// the first boss fight, with every held tick checked against a snapshot taken directly
+void benchmarkRewind() {
+    const int tickCount = 90 * 60;
+    const std::size_t budgets[] = { 4 << 20, 64 << 10 };
+    auto inputAt = [](int tick) -> std::uint8_t {
+        return Simulation::InputFire | (tick / 45 % 2 ? Simulation::InputLeft : Simulation::InputRight);
+    };
+
+    std::cout << "Rewind buffer (" << tickCount / 60 << " s of play, keyframe every 60 ticks, at most 60 s held)" << std::endl;
+    for (std::size_t budget : budgets) {
+        RewindBuffer rewind(budget);
+        Simulation simulation;
+        simulation.reset(5);
+        std::vector<std::vector<std::uint8_t>> expected(tickCount + 1);
+        simulation.save(expected[0]);
+        rewind.capture(simulation);
+
+        double captureTime = 0.0;
+        for (int tick = 1; tick <= tickCount; ++tick) {
+            simulation.step(inputAt(tick));
+            simulation.save(expected[tick]);
+
+            auto start = std::chrono::steady_clock::now();
+            rewind.capture(simulation);
+            captureTime += benchmarkSeconds(start);
+        }
+
+        // Every tick held, oldest to newest, then the same ticks in random order
+        std::vector<std::uint8_t> snapshot;
+        bool matches = true;
+        auto start = std::chrono::steady_clock::now();
+        for (std::uint64_t tick = rewind.getFirstTick(); tick <= rewind.getLastTick(); ++tick) {
+            matches = rewind.seek(tick, snapshot) && snapshot == expected[tick] && matches;
+        }
+        double stepTime = benchmarkSeconds(start) / rewind.getTickCount();
+
+        std::mt19937 gen(4);
+        const int seekCount = 2000;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < seekCount; ++i) {
+            std::uint64_t tick = rewind.getFirstTick() + gen() % rewind.getTickCount();
+            matches = rewind.seek(tick, snapshot) && snapshot == expected[tick] && matches;
         }
+        double seekTime = benchmarkSeconds(start) / seekCount;
+
+        std::cout << "  " << std::setw(4) << budget / 1024 << " KB ring: " << std::fixed << std::setprecision(1)
+                  << rewind.getTickCount() / 60.0 << " s held in " << rewind.getUsedBytes() / 1024.0 << " KB ("
+                  << rewind.getKeyframeCount() << " keyframes, " << static_cast<double>(rewind.getUsedBytes()) / rewind.getTickCount()
+                  << " B/tick against " << expected[tickCount].size() << " B snapshots), capture "
+                  << captureTime * 1e6 / tickCount << " us/tick, step " << stepTime * 1e6 << " us, random seek " << seekTime * 1e6
+                  << " us" << (matches ? "" : "  (MISMATCH)") << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
     }
-    
-    void updateUI() {
-        // Update score text
-        scoreText.setString("Score: " + std::to_string(player.getScore()));
-        
-        // Update level text
-        levelText.setString("Level: " + std::to_string(level.getCurrentLevel()));
-        
-        // Update health bar
-        float healthPercent = static_cast<float>(player.getHealth()) / 100.0f;
-        healthBar.setSize(sf::Vector2f(200.f * healthPercent, 20.f));
-        
-        // Change health bar color based on health
-        if (healthPercent > 0.6f) {
-            healthBar.setFillColor(sf::Color::Green);
-        } else if (healthPercent > 0.3f) {
-            healthBar.setFillColor(sf::Color::Yellow);
-        } else {
-            healthBar.setFillColor(sf::Color::Red);
+}
+
+// Replays: file size against seek latency for several keyframe spacings, over a recorded game of
+// almost three minutes; every seek is checked against a snapshot taken while recording
+void benchmarkReplays() {
+    const char* benchReplayPath = "bench.ssr";
+    const std::uint32_t intervals[] = { 0, 1800, 600, ReplayFile::defaultKeyframeInterval, 60 };
+    const int seekCount = 200;
+    auto inputAt = [](std::uint64_t tick) -> std::uint8_t {
+        return Simulation::InputFire | (tick / 45 % 2 ? Simulation::InputLeft : Simulation::InputRight);
+    };
+
+    // The game, with a snapshot of every tick the seeks below land on
+    std::mt19937 gen(8);
+    Simulation simulation;
+    simulation.reset(8);
+    while (simulation.getState() == GameState::Playing || simulation.getState() == GameState::BossFight) {
+        simulation.step(inputAt(simulation.getTick()));
+    }
+    std::uint64_t tickCount = simulation.getTick();
+    std::vector<std::uint64_t> seekTicks;
+    for (int i = 0; i < seekCount; ++i) {
+        seekTicks.push_back(gen() % (tickCount + 1));
+    }
+    std::sort(seekTicks.begin(), seekTicks.end());
+    std::vector<std::vector<std::uint8_t>> expected(seekCount);
+
+    std::cout << "Replays (" << tickCount << " ticks, " << tickCount / 60 / 60 << ":" << std::setw(2) << std::setfill('0')
+              << tickCount / 60 % 60 << std::setfill(' ') << " of play, " << seekCount << " seeks to random ticks)" << std::endl;
+    for (std::uint32_t interval : intervals) {
+        // Recording costs one input byte per tick plus the keyframes
+        ReplayFile::Recorder recorder(interval ? interval : ~0u);
+        simulation.reset(8);
+        recorder.start(8, simulation);
+        std::size_t next = 0;
+        while (next < expected.size() && seekTicks[next] == 0) simulation.save(expected[next++]);
+        while (simulation.getTick() < tickCount) {
+            std::uint8_t input = inputAt(simulation.getTick());
+            simulation.step(input);
+            recorder.record(input, simulation);
+            while (next < expected.size() && seekTicks[next] == simulation.getTick()) simulation.save(expected[next++]);
         }
-        
-        // Update shield bar
-        if (player.hasShield()) {
-            float shieldPercent = player.getShieldHealth() / 100.0f;
-            shieldBar.setSize(sf::Vector2f(200.f * shieldPercent, 10.f));
-            shieldBar.setFillColor(sf::Color::Cyan);
-        } else {
-            shieldBar.setSize(sf::Vector2f(0.f, 10.f));
+        if (!recorder.write(benchReplayPath, simulation)) {
+            std::cout << "  could not write " << benchReplayPath << std::endl;
+            return;
         }
-        
-        // Update weapon text
-        std::string weaponName;
-        switch (player.getWeaponType()) {
-            case WeaponType::Basic: weaponName = "Basic"; break;
-            case WeaponType::Double: weaponName = "Double"; break;
-            case WeaponType::Triple: weaponName = "Triple"; break;
-            case WeaponType::Laser: weaponName = "Laser"; break;
+
+        ReplayFile replay;
+        if (!replay.open(benchReplayPath)) {
+            std::cout << "  could not open " << benchReplayPath << std::endl;
+            return;
+        }
+
+        // Seeks in random order, each from wherever the last one left the simulation
+        std::vector<std::size_t> order(seekCount);
+        for (int i = 0; i < seekCount; ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), gen);
+
+        Simulation viewer;
+        std::vector<std::uint8_t> snapshot;
+        std::uint64_t simulated = 0, mostSimulated = 0;
+        double seekTime = 0.0, slowestSeek = 0.0;
+        bool matches = true;
+        for (std::size_t i : order) {
+            auto start = std::chrono::steady_clock::now();
+            std::uint64_t ticks = replay.seek(seekTicks[i], viewer);
+            double elapsed = benchmarkSeconds(start);
+            seekTime += elapsed;
+            slowestSeek = std::max(slowestSeek, elapsed);
+            simulated += ticks;
+            mostSimulated = std::max(mostSimulated, ticks);
+
+            viewer.save(snapshot);
+            matches = matches && snapshot == expected[i];
         }
-        weaponText.setString("Weapon: " + weaponName);
+
+        std::cout << "  keyframes " << std::left << std::setw(11) << (interval ? "every " + std::to_string(interval) : std::string("at start"))
+                  << std::right << std::setw(5) << replay.getKeyframeCount() << " keyframes " << std::fixed << std::setprecision(1)
+                  << std::setw(7) << replay.getFileSize() / 1024.0 << " KB, seek avg " << std::setw(7) << seekTime * 1e3 / seekCount
+                  << " ms, max " << std::setw(7) << slowestSeek * 1e3 << " ms (" << simulated / seekCount << " ticks avg, "
+                  << mostSimulated << " max)" << (matches ? "" : "  (MISMATCH)") << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
     }
-    
-    void spawnEnemy() {
-        std::shared_ptr<Enemy> enemy;
-        
-        // Random enemy type based on level
-        int maxEnemyType = std::min(3, level.getCurrentLevel());
-        int enemyType = rand() % maxEnemyType;
-        
-        switch (enemyType) {
-            case 0:
-                enemy = std::make_shared<BasicEnemy>();
-                break;
-            case 1:
-                enemy = std::make_shared<FastEnemy>();
-                break;
-            case 2:
-                enemy = std::make_shared<TankyEnemy>();
-                break;
+    std::remove(benchReplayPath);
+}
+
+void benchmarkReplayVerification() {
+#if defined(__unix__) || defined(__APPLE__)
+    const std::string benchDirectory = "bench-replays";
+    const std::string benchReport = benchDirectory + "/verdicts.tsv";
+    const int replayCount = 60;
+    auto inputAt = [](std::uint64_t seed, std::uint64_t tick) -> std::uint8_t {
+        return Simulation::InputFire | ((tick + seed * 17) / 45 % 2 ? Simulation::InputLeft : Simulation::InputRight);
+    };
+
+    // Of every ten replays seven are honest, one was played with other inputs than it holds, one
+    // claims a game that was not finished and one is not a replay at all
+    mkdir(benchDirectory.c_str(), 0755);
+    std::vector<std::string> paths;
+    std::size_t expectedVerified = 0, expectedMismatched = 0, expectedInvalid = 0;
+    Simulation simulation;
+    ReplayFile::Recorder recorder;
+    for (int i = 0; i < replayCount; ++i) {
+        std::uint64_t seed = 100 + i;
+        paths.push_back(benchDirectory + "/" + std::to_string(seed) + ".ssr");
+        if (i % 10 == 9) {
+            std::ofstream(paths.back(), std::ios::binary) << "not a replay";
+            ++expectedInvalid;
+            continue;
         }
-        
-        float x = static_cast<float>(rand() % 750 + 25);
-        enemy->setPosition(x, -50.f);
-        enemies.push_back(enemy);
+
+        simulation.reset(seed);
+        recorder.start(seed, simulation);
+        while (simulation.getState() == GameState::Playing || simulation.getState() == GameState::BossFight) {
+            if (i % 10 == 8 && simulation.getTick() == 1200) break;
+            std::uint8_t input = inputAt(seed, simulation.getTick());
+            simulation.step(i % 10 == 7 && simulation.getTick() == 300 ? input ^ Simulation::InputFire : input);
+            recorder.record(input, simulation);
+        }
+        recorder.write(paths.back().c_str(), simulation);
+        (i % 10 >= 7 ? expectedMismatched : expectedVerified) += 1;
     }
-    
-    void spawnPowerUp() {
-        // Random power-up type
-        PowerUpType type = static_cast<PowerUpType>(rand() % 4);
-        
-        auto powerup = std::make_shared<PowerUp>(type);
-        float x = static_cast<float>(rand() % 750 + 25);
-        powerup->setPosition(x, -50.f);
-        powerups.push_back(powerup);
+
+    std::vector<unsigned> threadCounts(1, 1);
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
     }
-    
-    void startBossFight() {
-        gameState = GameState::BossFight;
-        bossWarningVisible = true;
-        bossWarningTime = 0.0f;
+    for (unsigned threads : threadCounts) {
+        ReplayVerifierStats stats;
+        if (!verifyReplayDirectory(benchDirectory.c_str(), benchReport.c_str(), threads, stats)) {
+            std::cout << "Replay verification: could not verify " << benchDirectory << std::endl;
+            break;
+        }
+        bool expected = stats.verified == expectedVerified && stats.mismatched == expectedMismatched && stats.invalid == expectedInvalid;
+        std::cout << "Replay verification (" << replayCount << " replays, " << threads << (threads == 1 ? " thread): " : " threads): ")
+                  << std::fixed << std::setprecision(0) << replayCount / stats.seconds << " replays/s, " << std::setprecision(2)
+                  << stats.ticks / stats.seconds / 1e6 << " M ticks/s, " << stats.ticks / replayCount << " ticks per replay, "
+                  << stats.verified << " verified / " << stats.mismatched << " mismatched / " << stats.invalid << " invalid"
+                  << (expected ? "" : "  (UNEXPECTED)") << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
     }
-    
-    void startGame() {
-        // Reset game state
-        gameState = GameState::Playing;
-        
-        // Reset player
-        player.resetHealth();
-        player.resetScore();
-        player.resetWeapon();
-        player.setPosition(400.f, 550.f);
-        
-        // Clear game objects
-        bullets.clear();
-        lasers.clear();
-        enemies.clear();
-        powerups.clear();
-        explosions.clear();
-        enemyBullets.clear();
-        boss = nullptr;
-        
-        // Reset level
-        level.reset();
-        
-        // Reset timers
-        enemySpawnTimer = 0.0f;
-        powerupSpawnTimer = 0.0f;
+
+    for (const std::string& path : paths) {
+        std::remove(path.c_str());
     }
-    
-    void render() {
-        window.clear();
-        
-        // Draw background
-        window.draw(background);
-        
-        // Draw based on game state
-        switch (gameState) {
-            case GameState::MainMenu:
-                renderMainMenu();
-                break;
-                
-            case GameState::Playing:
-            case GameState::BossFight:
-                renderGame();
-                break;
-                
-            case GameState::GameOver:
-                renderGame();
-                window.draw(gameOverText);
-                window.draw(restartText);
-                break;
-                
-            case GameState::Victory:
-                renderGame();
-                window.draw(victoryText);
-                window.draw(restartText);
-                break;
+    std::remove(benchReport.c_str());
+    rmdir(benchDirectory.c_str());
+#endif
+}
+
+void benchmarkLockstep() {
+    struct Scenario {
+        const char* name;
+        LinkConditions link;
+    };
+    const Scenario scenarios[] = {
+        { "loopback", { 0.0f, 0.0f, 0.0f } },
+        { "20 ms +5 jitter, 1% loss", { 20.0f, 5.0f, 0.01f } },
+        { "50 ms +15 jitter, 5% loss", { 50.0f, 15.0f, 0.05f } },
+        { "100 ms +30 jitter, 20% loss", { 100.0f, 30.0f, 0.2f } },
+    };
+    const std::uint64_t maxTicks = 3600;
+    const double frameMs = 1000.0 / 60.0;
+    auto inputAt = [](int player, std::uint64_t tick) -> std::uint8_t {
+        return Simulation::InputFire | ((tick + player * 37) / 50 % 2 ? Simulation::InputLeft : Simulation::InputRight);
+    };
+
+    // Both peers in this process on a clock of their own, one frame per round, over real UDP sockets
+    std::cout << "Lockstep co-op (two peers over UDP on 127.0.0.1, up to " << maxTicks / 60 << " s of play)" << std::endl;
+    for (const Scenario& scenario : scenarios) {
+        LockstepSession::Config config;
+        config.inputDelay = LockstepSession::getStallFreeInputDelay(config.sendInterval, scenario.link.latencyMs + scenario.link.jitterMs);
+        config.link = scenario.link;
+        LockstepSession peers[2];
+        Simulation simulations[2];
+        bool running[2] = { false, false };
+        if (!peers[0].host(0, config) || !peers[1].join("127.0.0.1", peers[0].getLocalPort(), config)) {
+            std::cout << "  could not open UDP sockets on 127.0.0.1" << std::endl;
+            return;
         }
-        
-        window.display();
-    }
-    
-    void renderMainMenu() {
-        window.draw(titleText);
-        window.draw(startText);
-        window.draw(controlsText);
+
+        double now = 0.0;
+        double accumulators[2] = { 0.0, 0.0 };
+        std::uint64_t frames = 0;
+        auto isRunning = [&](int i) {
+            GameState state = simulations[i].getState();
+            return !peers[i].isStarted() || (simulations[i].getTick() < maxTicks && (state == GameState::Playing || state == GameState::BossFight));
+        };
+        while ((isRunning(0) || isRunning(1)) && now < maxTicks * frameMs * 4) {
+            for (int i = 0; i < 2; ++i) {
+                peers[i].poll(now);
+                if (peers[i].isStarted() && !running[i]) {
+                    simulations[i].reset(peers[i].getSeed(), 2);
+                    running[i] = true;
+                }
+                // The same catching up as Game::updateSimulation, which drops the time spent stalled
+                accumulators[i] += running[i] ? frameMs : 0.0;
+                for (int ticks = 0; accumulators[i] >= frameMs && isRunning(i) && ticks < 8; ++ticks) {
+                    if (!peers[i].advance(simulations[i], inputAt(peers[i].getLocalPlayer(), simulations[i].getTick()), now)) {
+                        accumulators[i] = std::min(accumulators[i], frameMs);
+                        break;
+                    }
+                    accumulators[i] -= frameMs;
+                }
+            }
+            now += frameMs;
+            ++frames;
+        }
+
+        bool inSync = simulations[0].getTick() == simulations[1].getTick() && simulations[0].getStateHash() == simulations[1].getStateHash();
+        std::uint64_t bytes = 0, datagrams = 0, stalls = 0, samples = 0, dropped = 0;
+        double latencySum = 0.0, latencyMax = 0.0;
+        for (const LockstepSession& peer : peers) {
+            const LockstepSession::Stats& stats = peer.getStats();
+            bytes += stats.bytesSent;
+            datagrams += stats.datagramsSent;
+            stalls += stats.stalls;
+            samples += stats.latencySamples;
+            latencySum += stats.latencySum;
+            latencyMax = std::max(latencyMax, stats.latencyMax);
+            dropped += peer.getDroppedCount();
+        }
+        double seconds = now / 1000.0;
+        std::cout << "  " << std::left << std::setw(28) << scenario.name << std::right << " delay " << std::setw(2) << config.inputDelay
+                  << ": " << std::setw(4) << simulations[0].getTick() << " ticks " << (inSync ? "in sync" : "OUT OF SYNC") << std::fixed
+                  << std::setprecision(1) << ", added latency avg " << std::setw(5) << latencySum / std::max<std::uint64_t>(samples, 1)
+                  << " ms, max " << std::setw(5) << latencyMax << " ms, stalled " << std::setw(4) << 100.0 * stalls / (2.0 * frames)
+                  << "% of frames, " << std::setprecision(0) << std::setw(4) << bytes / 2.0 / seconds << " B/s per player ("
+                  << std::setprecision(1) << datagrams / 2.0 / seconds << " datagrams/s, " << dropped << " dropped)" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
     }
-    
-    void renderGame() {
-        // Draw player
-        player.draw(window);
-        
-        // Draw player shield
-        player.drawShield(window);
-        
-        // Draw bullets
-        for (const auto& bullet : bullets) {
-            bullet->draw(window);
+}
+
+// Rollback co-op: how deep rollbacks go and what re-simulating costs a frame, for two peers over
+// loopback with latency and jitter injected, then the worst case of a full window re-simulated
+// in a crowded game
+void benchmarkRollback() {
+    struct Scenario {
+        const char* name;
+        LinkConditions link;
+    };
+    const Scenario scenarios[] = {
+        { "loopback", { 0.0f, 0.0f, 0.0f } },
+        { "20 ms +5 jitter, 1% loss", { 20.0f, 5.0f, 0.01f } },
+        { "50 ms +15 jitter, 5% loss", { 50.0f, 15.0f, 0.05f } },
+        { "100 ms +30 jitter, 5% loss", { 100.0f, 30.0f, 0.05f } },
+    };
+    const int maxRollback = 8;
+    const std::uint64_t maxTicks = 3600;
+    const double frameMs = 1000.0 / 60.0;
+    // Changes direction and fire often, so predictions keep going wrong
+    auto inputAt = [](int player, std::uint64_t tick) -> std::uint8_t {
+        tick += player * 37;
+        return ((tick / 29) % 3 ? Simulation::InputFire : 0) | (tick / 20 % 2 ? Simulation::InputLeft : Simulation::InputRight);
+    };
+
+    std::cout << "Rollback co-op (two peers over UDP on 127.0.0.1, window " << maxRollback << " ticks, input delay 1, up to "
+              << maxTicks / 60 << " s of play)" << std::endl;
+    for (const Scenario& scenario : scenarios) {
+        LockstepSession::Config config;
+        config.inputDelay = 1;
+        config.maxRollback = maxRollback;
+        config.link = scenario.link;
+        LockstepSession peers[2];
+        Simulation simulations[2];
+        bool running[2] = { false, false };
+        if (!peers[0].host(0, config) || !peers[1].join("127.0.0.1", peers[0].getLocalPort(), config)) {
+            std::cout << "  could not open UDP sockets on 127.0.0.1" << std::endl;
+            return;
         }
-        
-        // Draw enemy bullets
-        for (const auto& bullet : enemyBullets) {
-            bullet->draw(window);
+
+        double now = 0.0;
+        double accumulators[2] = { 0.0, 0.0 };
+        std::uint64_t frames = 0;
+        auto isRunning = [&](int i) {
+            GameState state = simulations[i].getState();
+            return !peers[i].isStarted() || (simulations[i].getTick() < maxTicks && (state == GameState::Playing || state == GameState::BossFight));
+        };
+        // Done once neither game can still be corrected
+        auto isSettled = [&](int i) { return !isRunning(i) && peers[i].getConfirmedTick() >= simulations[i].getTick(); };
+        while ((!isSettled(0) || !isSettled(1)) && now < maxTicks * frameMs * 4) {
+            for (int i = 0; i < 2; ++i) {
+                peers[i].poll(now);
+                if (peers[i].isStarted() && !running[i]) {
+                    simulations[i].reset(peers[i].getSeed(), 2);
+                    running[i] = true;
+                }
+                if (running[i] && !isRunning(i)) {
+                    peers[i].reconcile(simulations[i]);
+                }
+                accumulators[i] += running[i] ? frameMs : 0.0;
+                for (int ticks = 0; accumulators[i] >= frameMs && isRunning(i) && ticks < 8; ++ticks) {
+                    if (!peers[i].advance(simulations[i], inputAt(peers[i].getLocalPlayer(), simulations[i].getTick()), now)) {
+                        accumulators[i] = std::min(accumulators[i], frameMs);
+                        break;
+                    }
+                    accumulators[i] -= frameMs;
+                }
+            }
+            now += frameMs;
+            ++frames;
         }
-        
-        // Draw lasers
-        for (const auto& laser : lasers) {
-            laser->draw(window);
+
+        bool inSync = simulations[0].getTick() == simulations[1].getTick() && simulations[0].getStateHash() == simulations[1].getStateHash();
+        std::array<std::uint64_t, LockstepSession::maxRollbackLimit + 1> depths = {};
+        std::uint64_t stalls = 0, samples = 0, rollbacks = 0, resimulated = 0;
+        double latencySum = 0.0, rollbackSeconds = 0.0, rollbackMax = 0.0;
+        for (const LockstepSession& peer : peers) {
+            const LockstepSession::Stats& stats = peer.getStats();
+            for (std::size_t depth = 0; depth < depths.size(); ++depth) {
+                depths[depth] += stats.rollbackDepths[depth];
+            }
+            stalls += stats.stalls;
+            samples += stats.latencySamples;
+            latencySum += stats.latencySum;
+            rollbacks += stats.rollbacks;
+            resimulated += stats.resimulatedTicks;
+            rollbackSeconds += stats.rollbackSecondsSum;
+            rollbackMax = std::max(rollbackMax, stats.rollbackSecondsMax);
         }
-        
-        // Draw enemies
-        for (const auto& enemy : enemies) {
-            enemy->draw(window);
+        std::cout << "  " << std::left << std::setw(28) << scenario.name << std::right << ": " << std::setw(4) << simulations[0].getTick()
+                  << " ticks " << (inSync ? "in sync" : "OUT OF SYNC") << std::fixed << std::setprecision(1) << ", added latency avg "
+                  << std::setw(4) << latencySum / std::max<std::uint64_t>(samples, 1) << " ms, stalled " << std::setw(4)
+                  << 100.0 * stalls / (2.0 * frames) << "% of frames, rolled back " << std::setw(4) << 100.0 * rollbacks / (2.0 * frames)
+                  << "% of frames, re-simulation avg " << std::setw(5) << rollbackSeconds / std::max<std::uint64_t>(rollbacks, 1) * 1e6
+                  << " us, max " << std::setw(5) << rollbackMax * 1e6 << " us per frame ("
+                  << static_cast<double>(resimulated) / std::max<std::uint64_t>(rollbacks, 1) << " ticks)" << std::endl;
+        std::cout << "    depth";
+        for (int depth = 1; depth <= maxRollback; ++depth) {
+            std::cout << "  " << depth << ":" << std::setw(4) << depths[depth];
         }
-        
-        // Draw boss
-        if (boss) {
-            boss->draw(window);
+        std::cout << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
+    }
+
+    // A whole window thrown away: restore, then every tick of it simulated again
+    Simulation source;
+    source.reset(5, 2);
+    for (std::uint64_t tick = 0; tick < 600; ++tick) {
+        std::uint8_t inputs[2] = { inputAt(0, tick), inputAt(1, tick) };
+        source.step(inputs);
+    }
+    std::vector<std::uint8_t> snapshot;
+    source.save(snapshot);
+    const int entityCounts[] = { 0, 1000 };
+    const int roundCount = 200;
+    for (int entityCount : entityCounts) {
+        Simulation simulation;
+        std::vector<std::uint8_t> start = entityCount ? makeCrowdedSnapshot(snapshot, entityCount) : snapshot;
+        auto begin = std::chrono::steady_clock::now();
+        for (int round = 0; round < roundCount; ++round) {
+            simulation.restore(start);
+            for (int tick = 0; tick < maxRollback; ++tick) {
+                std::uint8_t inputs[2] = { inputAt(0, simulation.getTick()), inputAt(1, simulation.getTick()) };
+                simulation.step(inputs);
+            }
         }
-        
-        // Draw power-ups
-        for (const auto& powerup : powerups) {
-            powerup->draw(window);
+        double seconds = benchmarkSeconds(begin) / roundCount;
+        std::cout << "  full " << maxRollback << "-tick rollback, " << std::setw(4) << entityCount << (entityCount ? " entities" : " (game)  ")
+                  << std::fixed << std::setprecision(1) << ": " << std::setw(6) << seconds * 1e6 << " us, " << std::setprecision(2)
+                  << 100.0 * seconds / Simulation::tickSeconds << "% of a frame" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
+    }
+}
+
+// Match server: how many 60 Hz matches one worker thread keeps up with, played by stand-in clients
+// over loopback. Matches start spread over their first minute so the load is that of games in
+// progress. Only the worker's own CPU time counts, since the clients share the machine.
+void benchmarkMatchServer() {
+    const int matchCounts[] = { 250, 1000, 2000 };
+    const double runSeconds = 3.0;
+    const double settleSeconds = 0.5;
+
+    std::cout << "Match server (one worker thread, stand-in clients over UDP on 127.0.0.1, " << runSeconds << " s per run)" << std::endl;
+    double matchTickSeconds = 0.0;
+    for (int matchCount : matchCounts) {
+        MatchServer::Config config;
+        config.port = 0;
+        config.matchCount = matchCount;
+        config.threadCount = 1;
+        config.warmupTicks = 3600;
+        MatchServer server;
+        StandInClients clients;
+        if (!server.start(config)) {
+            std::cout << "  could not open UDP sockets" << std::endl;
+            return;
         }
-        
-        // Draw explosions
-        for (const auto& explosion : explosions) {
-            explosion.draw(window);
+        while (!server.isReady()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
-        
-        // Draw UI
-        window.draw(scoreText);
-        window.draw(levelText);
-        window.draw(healthBarBackground);
-        window.draw(healthBar);
-        window.draw(shieldBarBackground);
-        window.draw(shieldBar);
-        window.draw(weaponText);
-        
-        // Draw boss warning
-        if (bossWarningVisible) {
-            window.draw(bossWarningText);
+        if (!clients.open("127.0.0.1", server.getWorkerPorts(), matchCount)) {
+            std::cout << "  could not open UDP sockets on 127.0.0.1" << std::endl;
+            return;
+        }
+
+        // Measured once every match has heard from its clients
+        auto start = std::chrono::steady_clock::now();
+        MatchServer::Stats first;
+        StandInClients::Stats firstClients;
+        bool measuring = false;
+        for (;;) {
+            double now = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (!measuring && now >= settleSeconds * 1000.0) {
+                first = server.getStats();
+                firstClients = clients.getStats();
+                measuring = true;
+            }
+            if (now >= (settleSeconds + runSeconds) * 1000.0) break;
+            clients.update(now);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
+        MatchServer::Stats last = server.getStats();
+        StandInClients::Stats lastClients = clients.getStats();
+        server.stop();
+
+        std::uint64_t ticks = last.ticks - first.ticks;
+        std::uint64_t matchTicks = last.matchTicks - first.matchTicks;
+        double busy = last.busySeconds - first.busySeconds;
+        double expectedStates = matchCount * 2.0 * runSeconds / (config.stateInterval * Simulation::tickSeconds);
+        std::uint64_t samples = lastClients.latencySamples - firstClients.latencySamples;
+        matchTickSeconds = busy / std::max<std::uint64_t>(matchTicks, 1);
+
+        std::cout << "  " << std::setw(4) << matchCount << " matches (" << last.matchBytes / matchCount / 1024 << " KB each): " << std::fixed
+                  << std::setprecision(1) << std::setw(5) << 100.0 * busy / runSeconds << "% of the core busy, " << std::setw(5)
+                  << busy / std::max<std::uint64_t>(ticks, 1) * 1e3 << " ms per tick, " << std::setprecision(2) << std::setw(5)
+                  << matchTickSeconds * 1e6 << " us per match tick, longest tick " << std::setprecision(1) << last.maxTickSeconds * 1e3
+                  << " ms, late ticks " << 100.0 * (last.lateTicks - first.lateTicks) / std::max<std::uint64_t>(ticks, 1) << "%, summaries "
+                  << 100.0 * (lastClients.statesReceived - firstClients.statesReceived) / expectedStates << "% received, input to summary "
+                  << (lastClients.latencySum - firstClients.latencySum) / std::max<std::uint64_t>(samples, 1) << " ms avg" << std::endl;
+        std::cout << std::defaultfloat << std::setprecision(6);
+    }
+    std::cout << "  one core at the last run's cost per match tick: about "
+              << static_cast<int>(Simulation::tickSeconds / std::max(matchTickSeconds, 1e-9)) << " matches at 60 Hz" << std::endl;
+}
+
+void runBenchmarks() {
+    benchmarkCollisionMasks();
+    benchmarkTickRates();
+    benchmarkFiring();
+    benchmarkTimerWheel();
+    benchmarkAudioQueue();
+    benchmarkStartupAssets();
+    benchmarkEnvironment();
+    benchmarkFeatureLayers();
+    benchmarkStateExport();
+    benchmarkSnapshots();
+    benchmarkRewind();
+    benchmarkReplays();
+    benchmarkReplayVerification();
+    benchmarkLockstep();
+    benchmarkRollback();
+    benchmarkMatchServer();
+}
+
+#ifndef SPACE_SHOOTER_LIBRARY
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        runBenchmarks();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--read-state") {
+        return runStateReader();
+    }
+    if (argc > 2 && std::string(argv[1]) == "--verify-replays") {
+        return runReplayVerifier(argv[2], argc > 3 ? argv[3] : "verdicts.tsv");
+    }
+    if (argc > 1 && std::string(argv[1]) == "--server") {
+        return runMatchServer(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "--stand-in-clients") {
+        return runStandInClients(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--pack-assets") {
+        return packAssets(argc > 2 ? argv[2] : assetPackPath, true) ? 0 : 1;
     }
-    
-    // Game window
-    sf::RenderWindow window;
-    
-    // Game state
-    GameState gameState;
-    
-    // Delta time for frame-rate independent movement
-    float deltaTime;
-    
-    // Resources
-    sf::Font font;
-    sf::Texture backgroundTexture;
-    sf::Sprite background;
-    sf::Texture explosionTexture;
-    
-    // Sounds
-    sf::SoundBuffer shootBuffer, explosionBuffer, powerupBuffer, upgradeBuffer, bossBuffer;
-    sf::Sound shootSound, explosionSound, powerupSound, upgradeSound, bossSound;
-    
-    // Game objects
-    Player player;
-    std::vector<std::shared_ptr<Bullet>> bullets;
-    std::vector<std::shared_ptr<Laser>> lasers;
-    std::vector<std::shared_ptr<Enemy>> enemies;
-    std::vector<std::shared_ptr<PowerUp>> powerups;
-    std::vector<std::shared_ptr<Bullet>> enemyBullets;
-    std::shared_ptr<BossEnemy> boss;
-    std::vector<Explosion> explosions;
-    
-    // Level system
-    Level level;
-    
-    // Timers
-    float enemySpawnTimer = 0.0f;
-    float powerupSpawnTimer = 0.0f;
-    
-    // UI elements
-    sf::Text scoreText;
-    sf::Text levelText;
-    sf::RectangleShape healthBarBackground;
-    sf::RectangleShape healthBar;
-    sf::RectangleShape shieldBarBackground;
-    sf::RectangleShape shieldBar;
-    sf::Text weaponText;
-    sf::Text gameOverText;
-    sf::Text victoryText;
-    sf::Text restartText;
-    sf::Text titleText;
-    sf::Text startText;
-    sf::Text controlsText;
-    sf::Text bossWarningText;
-    bool bossWarningVisible;
-    float bossWarningTime;
-};
 
-int main() {
-    // Initialize random seed
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));
-    
     // Create and run the game
     Game game;
+    const char* coopAddress = nullptr;
+    bool coopHost = false;
+    int coopPort = LockstepSession::defaultPort;
+    LockstepSession::Config coopConfig;
+    bool inputDelaySet = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--watch-assets" && !game.enableAssetWatching()) {
+            std::cerr << "Asset watching is not available on this platform" << std::endl;
+        } else if (option == "--export-state" && !game.enableStateExport()) {
+            std::cerr << "Could not create the shared-memory state export " << stateExportName << std::endl;
+        } else if (option == "--record-replays" && i + 1 < argc) {
+            game.enableReplayRecording(argv[++i]);
+        } else if (option == "--replay" && i + 1 < argc) {
+            if (!game.openReplay(argv[++i])) {
+                std::cerr << "Could not open replay " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (option == "--host") {
+            coopHost = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                coopPort = std::atoi(argv[++i]);
+            }
+        } else if (option == "--join" && i + 1 < argc) {
+            coopAddress = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                coopPort = std::atoi(argv[++i]);
+            }
+        } else if (option == "--input-delay" && i + 1 < argc) {
+            coopConfig.inputDelay = std::atoi(argv[++i]);
+            inputDelaySet = true;
+        } else if (option == "--rollback") {
+            coopConfig.maxRollback = 8;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                coopConfig.maxRollback = std::atoi(argv[++i]);
+            }
+        } else if (option == "--simulate-link" && i + 3 < argc) {
+            coopConfig.link.latencyMs = static_cast<float>(std::atof(argv[++i]));
+            coopConfig.link.jitterMs = static_cast<float>(std::atof(argv[++i]));
+            coopConfig.link.loss = static_cast<float>(std::atof(argv[++i])) / 100.0f;
+        } else if (option == "--target-fps" && i + 1 < argc) {
+            int frameRate = std::atoi(argv[++i]);
+            if (frameRate > 0) {
+                game.setTargetFrameRate(static_cast<unsigned>(frameRate));
+            }
+        }
+    }
+    if (coopHost || coopAddress) {
+        // Rollback hides the trip on its own; a tick of delay keeps most rollbacks shallow
+        if (coopConfig.maxRollback > 0 && !inputDelaySet) {
+            coopConfig.inputDelay = 1;
+        }
+        std::uint16_t port = static_cast<std::uint16_t>(coopPort);
+        if (coopHost ? !game.hostCoop(port, coopConfig) : !game.joinCoop(coopAddress, port, coopConfig)) {
+            std::cerr << "Could not open co-op over UDP" << (coopAddress ? std::string(" to ") + coopAddress : std::string()) << std::endl;
+            return 1;
+        }
+        std::cout << (coopHost ? "Hosting co-op on UDP port " : "Joining co-op at ") << (coopAddress ? std::string(coopAddress) + ":" : std::string())
+                  << port << std::endl;
+    }
     game.run();
     
     return 0;
-}
\ No newline at end of file
+}
+#endif